@@ -119,12 +119,12 @@ int
 api_idnode_grid
   ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
 {
-  int i;
+  size_t i, sorted;
   htsmsg_t *list, *e;
   htsmsg_t *flist = api_idnode_flist_conf(args, "list");
   api_idnode_grid_conf_t conf = { 0 };
   idnode_t *in;
-  idnode_set_t ins = { 0 };
+  idnode_set_t ins = { 0 }, rest;
   api_idnode_grid_callback_t cb = opaque;
 
   /* Grid configuration */
@@ -134,13 +134,23 @@ api_idnode_grid
   tvh_mutex_lock(&global_lock);
   cb(perm, &ins, &conf, args);
 
-  /* Sort */
-  if (conf.sort.key)
-    idnode_set_sort(&ins, &conf.sort);
+  /* Sort (only the requested page and the nodes before it) */
+  sorted = ins.is_count;
+  if (conf.sort.key) {
+    sorted = MIN(ins.is_count, (size_t)conf.start + conf.limit);
+    idnode_set_sort_partial(&ins, &conf.sort, sorted);
+  }
 
   /* Paginate */
   list  = htsmsg_create_list();
   for (i = conf.start; i < ins.is_count && conf.limit != 0; i++) {
+    if (i >= sorted) {
+      /* Some nodes were skipped (permissions), sort the next part */
+      rest.is_array = ins.is_array + sorted;
+      rest.is_count = ins.is_count - sorted;
+      idnode_set_sort_partial(&rest, &conf.sort, conf.limit);
+      sorted += MIN(rest.is_count, conf.limit);
+    }
     in = ins.is_array[i];
     if (idnode_perm(in, perm, NULL))
       continue;
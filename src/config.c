@@ -1757,7 +1757,8 @@ static char *config_get_dir ( uid_t uid )
 
 void
 config_boot
-  ( const char *path, gid_t gid, uid_t uid, const char *http_user_agent )
+  ( const char *path, gid_t gid, uid_t uid, const char *http_user_agent,
+    int packed )
 {
   struct stat st;
   htsmsg_t *config2;
@@ -1839,6 +1840,9 @@ config_boot
   if (chown(config_lock, uid, gid))
     tvhwarn(LS_CONFIG, "unable to chown lock file %s UID:%d GID:%d", config_lock, uid, gid);
 
+  /* Packed settings store */
+  hts_settings_pack_init(packed);
+
   /* Load global settings */
   config2 = hts_settings_load("config");
   if (!config2) {
@@ -93,7 +93,8 @@ extern const idclass_t config_class;
 extern config_t config;
 
 void config_boot
-  ( const char *path, gid_t gid, uid_t uid, const char *http_user_agent );
+  ( const char *path, gid_t gid, uid_t uid, const char *http_user_agent,
+    int packed );
 void config_init( int backup );
 void config_done( void );
 
@@ -345,6 +345,7 @@ descrambler_init ( void )
   TAILQ_INIT(&ca_hints);
   ca_hints_quickecm = 0;
 
+  tvhcsa_pool_init();
   caclient_init();
 
   if ((c = hts_settings_load("descrambler")) != NULL) {
@@ -361,6 +362,7 @@ descrambler_done ( void )
   th_descrambler_hint_t *hint;
 
   caclient_done();
+  tvhcsa_pool_done();
   while ((hint = TAILQ_FIRST(&ca_hints)) != NULL) {
     TAILQ_REMOVE(&ca_hints, hint, dh_link);
     free(hint);
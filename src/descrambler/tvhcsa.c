@@ -77,28 +77,273 @@ tvhcsa_des_ncb_descramble
   ts_recv_packet2(s, tsb, len);
 }
 
+#if ENABLE_DVBCSA
+
+/*
+ * CSA clusters are decrypted on a small worker pool shared by all
+ * descramblers. The input thread keeps filling the next cluster while
+ * the previous ones are decrypted and delivers the finished clusters
+ * in the submission order. The threads are started with the first
+ * CSA descrambler, so a server without scrambled services runs none.
+ */
+
+#define TVHCSA_POOL_MAX    8  /* worker threads */
+#define TVHCSA_JOBS_MAX    4  /* clusters in flight per descrambler */
+
+typedef enum {
+  TVHCSA_JOB_IDLE,
+  TVHCSA_JOB_QUEUED,
+  TVHCSA_JOB_RUNNING,
+  TVHCSA_JOB_DONE
+} tvhcsa_job_state_t;
+
+typedef struct tvhcsa_job {
+  TAILQ_ENTRY(tvhcsa_job) cj_link;      /* pool queue */
+  TAILQ_ENTRY(tvhcsa_job) cj_csa_link;  /* csa_jobs or csa_jobs_spare */
+  tvhcsa_t *cj_csa;
+  tvhcsa_job_state_t cj_state;
+  uint8_t *cj_cluster;
+  int cj_fill;
+  struct dvbcsa_bs_batch_s *cj_even;
+  struct dvbcsa_bs_batch_s *cj_odd;
+  int cj_fill_even;
+  int cj_fill_odd;
+} tvhcsa_job_t;
+
+static tvh_mutex_t tvhcsa_pool_lock;
+static tvh_cond_t tvhcsa_pool_cond;
+static tvh_cond_t tvhcsa_pool_done_cond;
+static TAILQ_HEAD(, tvhcsa_job) tvhcsa_pool_queue;
+static pthread_t *tvhcsa_pool_threads;
+static int tvhcsa_pool_count;
+static int tvhcsa_pool_running;
+static int tvhcsa_pool_started;
+
+static tvhcsa_job_t *
+tvhcsa_job_alloc ( tvhcsa_t *csa )
+{
+  tvhcsa_job_t *job;
+  size_t bsize = (csa->csa_cluster_size + 1) * sizeof(struct dvbcsa_bs_batch_s);
+
+  job = calloc(1, sizeof(*job) + 2 * bsize + csa->csa_fill_size * 188);
+  job->cj_csa     = csa;
+  job->cj_even    = (struct dvbcsa_bs_batch_s *)(job + 1);
+  job->cj_odd     = (struct dvbcsa_bs_batch_s *)((uint8_t *)job->cj_even + bsize);
+  job->cj_cluster = (uint8_t *)job->cj_odd + bsize;
+  return job;
+}
+
 static void
-tvhcsa_csa_cbc_flush
+tvhcsa_job_decrypt ( tvhcsa_job_t *job )
+{
+  tvhcsa_t *csa = job->cj_csa;
+
+  if (job->cj_fill_even)
+    dvbcsa_bs_decrypt(csa->csa_key_even, job->cj_even, 184);
+  if (job->cj_fill_odd)
+    dvbcsa_bs_decrypt(csa->csa_key_odd, job->cj_odd, 184);
+}
+
+static void *
+tvhcsa_pool_thread ( void *aux )
+{
+  tvhcsa_job_t *job;
+
+  tvh_mutex_lock(&tvhcsa_pool_lock);
+  while (tvhcsa_pool_running) {
+    job = TAILQ_FIRST(&tvhcsa_pool_queue);
+    if (job == NULL) {
+      tvh_cond_wait(&tvhcsa_pool_cond, &tvhcsa_pool_lock);
+      continue;
+    }
+    TAILQ_REMOVE(&tvhcsa_pool_queue, job, cj_link);
+    job->cj_state = TVHCSA_JOB_RUNNING;
+    tvh_mutex_unlock(&tvhcsa_pool_lock);
+    tvhcsa_job_decrypt(job);
+    tvh_mutex_lock(&tvhcsa_pool_lock);
+    job->cj_state = TVHCSA_JOB_DONE;
+    tvh_cond_signal(&tvhcsa_pool_done_cond, 1);
+  }
+  tvh_mutex_unlock(&tvhcsa_pool_lock);
+  return NULL;
+}
+
+/*
+ * Start the worker threads on the first use
+ */
+static void
+tvhcsa_pool_start ( void )
+{
+  long cpus;
+  int i;
+
+  tvh_mutex_lock(&tvhcsa_pool_lock);
+  if (tvhcsa_pool_started) {
+    tvh_mutex_unlock(&tvhcsa_pool_lock);
+    return;
+  }
+  tvhcsa_pool_started = 1;
+  /* one CPU is kept for the input thread which fills the clusters */
+  cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  tvhcsa_pool_count = MINMAX(cpus - 1, 0, TVHCSA_POOL_MAX);
+  if (tvhcsa_pool_count > 0) {
+    tvhcsa_pool_running = 1;
+    tvhcsa_pool_threads = calloc(tvhcsa_pool_count, sizeof(pthread_t));
+    for (i = 0; i < tvhcsa_pool_count; i++)
+      tvh_thread_create(&tvhcsa_pool_threads[i], NULL,
+                        tvhcsa_pool_thread, NULL, "tvhcsa");
+  }
+  tvh_mutex_unlock(&tvhcsa_pool_lock);
+  tvhinfo(LS_CSA, "using %d threads for CSA decryption (batch size %d)",
+          tvhcsa_pool_count, dvbcsa_bs_batch_size());
+}
+
+/*
+ * Check (wait == 0) or wait for the job completion. A job which was
+ * not picked by a worker yet is decrypted by the caller.
+ */
+static int
+tvhcsa_job_complete ( tvhcsa_job_t *job, int wait )
+{
+  int r;
+
+  tvh_mutex_lock(&tvhcsa_pool_lock);
+  if (wait && job->cj_state == TVHCSA_JOB_QUEUED) {
+    TAILQ_REMOVE(&tvhcsa_pool_queue, job, cj_link);
+    job->cj_state = TVHCSA_JOB_RUNNING;
+    tvh_mutex_unlock(&tvhcsa_pool_lock);
+    tvhcsa_job_decrypt(job);
+    tvh_mutex_lock(&tvhcsa_pool_lock);
+    job->cj_state = TVHCSA_JOB_DONE;
+  }
+  while (wait && job->cj_state != TVHCSA_JOB_DONE)
+    tvh_cond_wait(&tvhcsa_pool_done_cond, &tvhcsa_pool_lock);
+  r = job->cj_state == TVHCSA_JOB_DONE;
+  tvh_mutex_unlock(&tvhcsa_pool_lock);
+  return r;
+}
+
+static void
+tvhcsa_job_submit ( tvhcsa_job_t *job )
+{
+  if (job->cj_fill_even)
+    job->cj_even[job->cj_fill_even].data = NULL;
+  if (job->cj_fill_odd)
+    job->cj_odd[job->cj_fill_odd].data = NULL;
+
+  tvh_mutex_lock(&tvhcsa_pool_lock);
+  if (tvhcsa_pool_running) {
+    job->cj_state = TVHCSA_JOB_QUEUED;
+    TAILQ_INSERT_TAIL(&tvhcsa_pool_queue, job, cj_link);
+    tvh_cond_signal(&tvhcsa_pool_cond, 0);
+    tvh_mutex_unlock(&tvhcsa_pool_lock);
+  } else {
+    tvh_mutex_unlock(&tvhcsa_pool_lock);
+    tvhcsa_job_decrypt(job);
+    job->cj_state = TVHCSA_JOB_DONE;
+  }
+}
+
+/*
+ * Wait until all submitted clusters are decrypted (keys may change)
+ */
+static void
+tvhcsa_csa_cbc_sync ( tvhcsa_t *csa )
+{
+  tvhcsa_job_t *job;
+
+  TAILQ_FOREACH(job, &csa->csa_jobs, cj_csa_link)
+    tvhcsa_job_complete(job, 1);
+}
+
+/*
+ * Pass the decrypted clusters in order, keep at most 'keep' in flight
+ */
+static void
+tvhcsa_csa_cbc_deliver
+  ( tvhcsa_t *csa, struct mpegts_service *s, int keep )
+{
+  tvhcsa_job_t *job;
+
+  while ((job = TAILQ_FIRST(&csa->csa_jobs)) != NULL) {
+    if (!tvhcsa_job_complete(job, csa->csa_jobs_count > keep))
+      break;
+    TAILQ_REMOVE(&csa->csa_jobs, job, cj_csa_link);
+    csa->csa_jobs_count--;
+    ts_recv_packet2(s, job->cj_cluster, job->cj_fill * 188);
+    job->cj_state     = TVHCSA_JOB_IDLE;
+    job->cj_fill      = 0;
+    job->cj_fill_even = 0;
+    job->cj_fill_odd  = 0;
+    TAILQ_INSERT_TAIL(&csa->csa_jobs_spare, job, cj_csa_link);
+  }
+}
+
+static void
+tvhcsa_csa_cbc_submit
   ( tvhcsa_t *csa, struct mpegts_service *s )
 {
-#if ENABLE_DVBCSA
-  tvhtrace(LS_CSA, "%p: CSA flush - descramble packets for service \"%s\" MAX=%d even=%d odd=%d fill=%d",
-           csa,((mpegts_service_t *)s)->s_dvb_svcname, csa->csa_cluster_size,csa->csa_fill_even,csa->csa_fill_odd,csa->csa_fill);
+  tvhcsa_job_t *job = csa->csa_job;
+
+  csa->csa_job = NULL;
+  tvhcsa_job_submit(job);
+  TAILQ_INSERT_TAIL(&csa->csa_jobs, job, cj_csa_link);
+  csa->csa_jobs_count++;
+  tvhcsa_csa_cbc_deliver(csa, s, TVHCSA_JOBS_MAX);
+}
 
-  if(csa->csa_fill_even) {
-    csa->csa_tsbbatch_even[csa->csa_fill_even].data = NULL;
-    dvbcsa_bs_decrypt(csa->csa_key_even, csa->csa_tsbbatch_even, 184);
-    csa->csa_fill_even = 0;
+static tvhcsa_job_t *
+tvhcsa_csa_cbc_job ( tvhcsa_t *csa )
+{
+  tvhcsa_job_t *job = csa->csa_job;
+
+  if (job == NULL) {
+    job = TAILQ_FIRST(&csa->csa_jobs_spare);
+    if (job)
+      TAILQ_REMOVE(&csa->csa_jobs_spare, job, cj_csa_link);
+    else
+      job = tvhcsa_job_alloc(csa);
+    csa->csa_job = job;
   }
-  if(csa->csa_fill_odd) {
-    csa->csa_tsbbatch_odd[csa->csa_fill_odd].data = NULL;
-    dvbcsa_bs_decrypt(csa->csa_key_odd, csa->csa_tsbbatch_odd, 184);
-    csa->csa_fill_odd = 0;
+  return job;
+}
+
+static void
+tvhcsa_csa_cbc_free ( tvhcsa_t *csa )
+{
+  tvhcsa_job_t *job;
+
+  tvhcsa_csa_cbc_sync(csa);
+  while ((job = TAILQ_FIRST(&csa->csa_jobs)) != NULL) {
+    TAILQ_REMOVE(&csa->csa_jobs, job, cj_csa_link);
+    free(job);
   }
+  while ((job = TAILQ_FIRST(&csa->csa_jobs_spare)) != NULL) {
+    TAILQ_REMOVE(&csa->csa_jobs_spare, job, cj_csa_link);
+    free(job);
+  }
+  free(csa->csa_job);
+  csa->csa_job = NULL;
+  csa->csa_jobs_count = 0;
+}
+
+#endif
+
+static void
+tvhcsa_csa_cbc_flush
+  ( tvhcsa_t *csa, struct mpegts_service *s )
+{
+#if ENABLE_DVBCSA
+  tvhcsa_job_t *job = csa->csa_job;
 
-  ts_recv_packet2(s, csa->csa_tsbcluster, csa->csa_fill * 188);
+  tvhtrace(LS_CSA, "%p: CSA flush - descramble packets for service \"%s\" MAX=%d even=%d odd=%d fill=%d queued=%d",
+           csa,((mpegts_service_t *)s)->s_dvb_svcname, csa->csa_cluster_size,
+           job ? job->cj_fill_even : 0, job ? job->cj_fill_odd : 0,
+           job ? job->cj_fill : 0, csa->csa_jobs_count);
 
-  csa->csa_fill = 0;
+  if (job && job->cj_fill)
+    tvhcsa_csa_cbc_submit(csa, s);
+  tvhcsa_csa_cbc_deliver(csa, s, 0);
 
 #else
 #error "Unknown CSA descrambler"
@@ -111,9 +356,8 @@ tvhcsa_csa_cbc_descramble
 {
   const uint8_t *tsb_end = tsb + tsb_len;
 
-  assert(csa->csa_fill >= 0 && csa->csa_fill < csa->csa_fill_size);
-
 #if ENABLE_DVBCSA
+  tvhcsa_job_t *job;
   uint8_t *pkt;
   int_fast8_t ev_od;
   int_fast16_t len;
@@ -121,9 +365,12 @@ tvhcsa_csa_cbc_descramble
 
   for ( ; tsb < tsb_end; tsb += 188) {
 
-   pkt = csa->csa_tsbcluster + csa->csa_fill * 188;
+   job = tvhcsa_csa_cbc_job(csa);
+   assert(job->cj_fill >= 0 && job->cj_fill < csa->csa_fill_size);
+
+   pkt = job->cj_cluster + job->cj_fill * 188;
    memcpy(pkt, tsb, 188);
-   csa->csa_fill++;
+   job->cj_fill++;
 
    do { 			// handle this packet
      if((pkt[3] & 0x80) == 0)	// clear or reserved (0x40)
@@ -146,25 +393,32 @@ tvhcsa_csa_cbc_descramble
        offset = 4;
      }
      if(ev_od == 0) {
-       csa->csa_tsbbatch_even[csa->csa_fill_even].data = pkt + offset;
-       csa->csa_tsbbatch_even[csa->csa_fill_even].len = len;
-       csa->csa_fill_even++;
-       if(csa->csa_fill_even == csa->csa_cluster_size)
-         tvhcsa_csa_cbc_flush(csa, s);
+       job->cj_even[job->cj_fill_even].data = pkt + offset;
+       job->cj_even[job->cj_fill_even].len = len;
+       job->cj_fill_even++;
+       if(job->cj_fill_even == csa->csa_cluster_size) {
+         tvhcsa_csa_cbc_submit(csa, s);
+         job = NULL;
+       }
      } else {
-       csa->csa_tsbbatch_odd[csa->csa_fill_odd].data = pkt + offset;
-       csa->csa_tsbbatch_odd[csa->csa_fill_odd].len = len;
-       csa->csa_fill_odd++;
-       if(csa->csa_fill_odd == csa->csa_cluster_size)
-         tvhcsa_csa_cbc_flush(csa, s);
+       job->cj_odd[job->cj_fill_odd].data = pkt + offset;
+       job->cj_odd[job->cj_fill_odd].len = len;
+       job->cj_fill_odd++;
+       if(job->cj_fill_odd == csa->csa_cluster_size) {
+         tvhcsa_csa_cbc_submit(csa, s);
+         job = NULL;
+       }
      }
    } while(0);
 
-   if(csa->csa_fill == csa->csa_fill_size )
-     tvhcsa_csa_cbc_flush(csa, s);
+   if(job && job->cj_fill == csa->csa_fill_size)
+     tvhcsa_csa_cbc_submit(csa, s);
 
   }
 
+  /* pass the clusters finished meanwhile */
+  tvhcsa_csa_cbc_deliver(csa, s, TVHCSA_JOBS_MAX);
+
 #else
 #error "Unknown CSA descrambler"
 #endif
@@ -191,14 +445,10 @@ tvhcsa_set_type( tvhcsa_t *csa, struct mpegts_service *s, int type )
     tvhtrace(LS_CSA, "%p: service \"%s\" using CSA batch size = %d for decryption",
              csa, ((mpegts_service_t *)s)->s_dvb_svcname, csa->csa_cluster_size );
 
-    csa->csa_tsbcluster    = malloc(csa->csa_fill_size * 188);
 #if ENABLE_DVBCSA
-    csa->csa_tsbbatch_even = malloc((csa->csa_cluster_size + 1) *
-                                    sizeof(struct dvbcsa_bs_batch_s));
-    csa->csa_tsbbatch_odd  = malloc((csa->csa_cluster_size + 1) *
-                                    sizeof(struct dvbcsa_bs_batch_s));
     csa->csa_key_even      = dvbcsa_bs_key_alloc();
     csa->csa_key_odd       = dvbcsa_bs_key_alloc();
+    tvhcsa_pool_start();
 #endif
     break;
   case DESCRAMBLER_DES_NCB:
@@ -232,6 +482,7 @@ void tvhcsa_set_key_even( tvhcsa_t *csa, const uint8_t *even )
   switch (csa->csa_type) {
   case DESCRAMBLER_CSA_CBC:
 #if ENABLE_DVBCSA
+    tvhcsa_csa_cbc_sync(csa);
     dvbcsa_bs_key_set_wrap(csa->csa_ecm, even, csa->csa_key_even);
 #endif
     break;
@@ -254,6 +505,7 @@ void tvhcsa_set_key_odd( tvhcsa_t *csa, const uint8_t *odd )
   switch (csa->csa_type) {
   case DESCRAMBLER_CSA_CBC:
 #if ENABLE_DVBCSA
+    tvhcsa_csa_cbc_sync(csa);
     dvbcsa_bs_key_set_wrap(csa->csa_ecm, odd, csa->csa_key_odd);
 #endif
     break;
@@ -286,6 +538,8 @@ tvhcsa_init ( tvhcsa_t *csa )
     tvhinfo(LS_DESCRAMBLER, "can not detect dvbcsa_bs_key_set_ecm() function: RTLD_DEFAULT not defined on this system");
 #endif
   }
+  TAILQ_INIT(&csa->csa_jobs);
+  TAILQ_INIT(&csa->csa_jobs_spare);
 #endif
   csa->csa_type          = 0;
   csa->csa_keylen        = 0;
@@ -295,17 +549,13 @@ void
 tvhcsa_destroy ( tvhcsa_t *csa )
 {
 #if ENABLE_DVBCSA
+  if (csa->csa_type == DESCRAMBLER_CSA_CBC)
+    tvhcsa_csa_cbc_free(csa);
   if (csa->csa_key_odd)
     dvbcsa_bs_key_free(csa->csa_key_odd);
   if (csa->csa_key_even)
     dvbcsa_bs_key_free(csa->csa_key_even);
-  if (csa->csa_tsbbatch_odd)
-    free(csa->csa_tsbbatch_odd);
-  if (csa->csa_tsbbatch_even)
-    free(csa->csa_tsbbatch_even);
 #endif
-  if (csa->csa_tsbcluster)
-    free(csa->csa_tsbcluster);
   if (csa->csa_priv) {
     switch (csa->csa_type) {
     case DESCRAMBLER_CSA_CBC:
@@ -326,6 +576,41 @@ tvhcsa_destroy ( tvhcsa_t *csa )
   memset(csa, 0, sizeof(*csa));
 }
 
+void
+tvhcsa_pool_init ( void )
+{
+#if ENABLE_DVBCSA
+  tvh_mutex_init(&tvhcsa_pool_lock, NULL);
+  tvh_cond_init(&tvhcsa_pool_cond, 1);
+  tvh_cond_init(&tvhcsa_pool_done_cond, 1);
+  TAILQ_INIT(&tvhcsa_pool_queue);
+#endif
+}
+
+void
+tvhcsa_pool_done ( void )
+{
+#if ENABLE_DVBCSA
+  int i;
+
+  tvh_mutex_lock(&tvhcsa_pool_lock);
+  /* no new start after the shutdown */
+  tvhcsa_pool_started = 1;
+  if (tvhcsa_pool_count == 0) {
+    tvh_mutex_unlock(&tvhcsa_pool_lock);
+    return;
+  }
+  tvhcsa_pool_running = 0;
+  tvh_cond_signal(&tvhcsa_pool_cond, 1);
+  tvh_mutex_unlock(&tvhcsa_pool_lock);
+  for (i = 0; i < tvhcsa_pool_count; i++)
+    pthread_join(tvhcsa_pool_threads[i], NULL);
+  free(tvhcsa_pool_threads);
+  tvhcsa_pool_threads = NULL;
+  tvhcsa_pool_count = 0;
+#endif
+}
+
 #if ENABLE_DVBCSA
 void
 dvbcsa_bs_key_set_wrap(const unsigned char ecm, const dvbcsa_cw_t cw, struct dvbcsa_bs_key_s *key)
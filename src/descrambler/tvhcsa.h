@@ -28,6 +28,7 @@ struct elementary_stream;
 #include <dvbcsa/dvbcsa.h>
 #endif
 #include "tvhlog.h"
+#include "queue.h"
 
 typedef struct tvhcsa
 {
@@ -44,16 +45,14 @@ typedef struct tvhcsa
               ( struct tvhcsa *csa, struct mpegts_service *s );
 
   int      csa_cluster_size;
-  uint8_t *csa_tsbcluster;
-  int      csa_fill;
   int      csa_fill_size;
   uint8_t  csa_ecm;
 
 #if ENABLE_DVBCSA
-  struct dvbcsa_bs_batch_s *csa_tsbbatch_even;
-  struct dvbcsa_bs_batch_s *csa_tsbbatch_odd;
-  int csa_fill_even;
-  int csa_fill_odd;
+  struct tvhcsa_job *csa_job;                      /* cluster being filled */
+  TAILQ_HEAD(, tvhcsa_job) csa_jobs;               /* submitted, in order */
+  TAILQ_HEAD(, tvhcsa_job) csa_jobs_spare;
+  int csa_jobs_count;
 
   struct dvbcsa_bs_key_s *csa_key_even;
   struct dvbcsa_bs_key_s *csa_key_odd;
@@ -73,6 +72,9 @@ void tvhcsa_set_key_odd ( tvhcsa_t *csa, const uint8_t *odd );
 void tvhcsa_init    ( tvhcsa_t *csa );
 void tvhcsa_destroy ( tvhcsa_t *csa );
 
+void tvhcsa_pool_init ( void );
+void tvhcsa_pool_done ( void );
+
 #else
 
 static inline int tvhcsa_set_type( tvhcsa_t *csa, struct mpegts_service *s, int type ) { return -1; }
@@ -83,6 +85,9 @@ static inline void tvhcsa_set_key_odd ( tvhcsa_t *csa, const uint8_t *odd ) { };
 static inline void tvhcsa_init ( tvhcsa_t *csa ) { };
 static inline void tvhcsa_destroy ( tvhcsa_t *csa ) { };
 
+static inline void tvhcsa_pool_init ( void ) { };
+static inline void tvhcsa_pool_done ( void ) { };
+
 #endif
 
 #if ENABLE_DVBCSA
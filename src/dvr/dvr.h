@@ -378,6 +378,7 @@ typedef struct dvr_autorec_entry {
   idnode_t dae_id;
 
   TAILQ_ENTRY(dvr_autorec_entry) dae_link;
+  uint32_t dae_seq;     /* Position in autorec_entries */
 
   char *dae_name;
   char *dae_directory;
@@ -392,6 +393,7 @@ typedef struct dvr_autorec_entry {
 
   char *dae_title;
   tvh_regex_t dae_title_regex;
+  int dae_title_literal; /* Title is a plain ASCII string */
   int dae_fulltext;
   int dae_mergetext;
 
@@ -27,6 +27,40 @@
 
 struct dvr_autorec_entry_queue autorec_entries;
 
+/*
+ * Candidate index for the EPG updates. The rules bound to a channel
+ * are reached through ch_autorecs and the rules bound to a channel tag
+ * through ct_autorecs of the event channel tags. Each remaining enabled
+ * rule is put to one of these:
+ *
+ * - a plain ASCII title (not fulltext, not merged text) is keyed by one
+ *   of its trigrams, the events look up the buckets of their title
+ *   trigrams (the buckets are hashed, the collisions only add
+ *   candidates)
+ * - a start window is keyed by the hours it covers (one hour more on
+ *   each side for the DST changes), the events look up their local
+ *   start hour
+ * - the others are kept in buckets by the genre major code, the last
+ *   bucket holds the rules without a genre
+ *
+ * The buckets are rebuilt lazily after any rule change.
+ */
+#define AUTOREC_BUCKET_NOGENRE 16
+#define AUTOREC_TITLE_HASH     1024
+
+typedef struct dvr_autorec_bucket {
+  dvr_autorec_entry_t **entries;
+  int count;
+  int allocated;
+} dvr_autorec_bucket_t;
+
+static dvr_autorec_bucket_t autorec_unbound[AUTOREC_BUCKET_NOGENRE + 1];
+static dvr_autorec_bucket_t autorec_title[AUTOREC_TITLE_HASH];
+static dvr_autorec_bucket_t autorec_hour[24];
+static int autorec_title_count;
+static int autorec_index_dirty = 1;
+static uint32_t autorec_seq;
+
 static void autorec_regfree(dvr_autorec_entry_t *dae)
 {
   if (dae->dae_title) {
@@ -34,6 +68,202 @@ static void autorec_regfree(dvr_autorec_entry_t *dae)
     free(dae->dae_title);
     dae->dae_title = NULL;
   }
+  dae->dae_title_literal = 0;
+}
+
+/*
+ *
+ */
+static void
+dvr_autorec_bucket_add(dvr_autorec_bucket_t *b, dvr_autorec_entry_t *dae)
+{
+  if (b->count == b->allocated) {
+    b->allocated = MAX(16, b->allocated * 2);
+    b->entries = realloc(b->entries, b->allocated * sizeof(*b->entries));
+  }
+  b->entries[b->count++] = dae;
+}
+
+static inline uint8_t
+dvr_autorec_fold(uint8_t c)
+{
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static inline uint32_t
+dvr_autorec_title_hash(uint32_t gram)
+{
+  return (gram * 2654435761U) >> 22;
+}
+
+/*
+ * Put the literal title to the least used bucket of its trigrams
+ */
+static int
+dvr_autorec_index_title(dvr_autorec_entry_t *dae)
+{
+  const uint8_t *s = (const uint8_t *)dae->dae_title;
+  uint32_t g, h;
+  int best = -1;
+
+  if (!dae->dae_title_literal || dae->dae_fulltext || dae->dae_mergetext)
+    return 0;
+  if (s[0] == '\0' || s[1] == '\0')
+    return 0;
+  g = (dvr_autorec_fold(s[0]) << 8) | dvr_autorec_fold(s[1]);
+  for (s += 2; *s; s++) {
+    g = ((g << 8) | dvr_autorec_fold(*s)) & 0xffffff;
+    h = dvr_autorec_title_hash(g);
+    if (best < 0 || autorec_title[h].count < autorec_title[best].count)
+      best = h;
+  }
+  if (best < 0)
+    return 0;
+  dvr_autorec_bucket_add(&autorec_title[best], dae);
+  autorec_title_count++;
+  return 1;
+}
+
+static int
+dvr_autorec_index_hours(dvr_autorec_entry_t *dae)
+{
+  int h, first, last;
+
+  if (dae->dae_start < 0 || dae->dae_start_window < 0 ||
+      dae->dae_start >= 24*60 || dae->dae_start_window >= 24*60)
+    return 0;
+  first = dae->dae_start / 60 - 1;
+  last = dae->dae_start_window / 60 + 1;
+  if (dae->dae_start > dae->dae_start_window)
+    last += 24;
+  if (last - first >= 23)
+    return 0;
+  for (h = first; h <= last; h++)
+    dvr_autorec_bucket_add(&autorec_hour[(h + 24) % 24], dae);
+  return 1;
+}
+
+static void
+dvr_autorec_index_rebuild(void)
+{
+  dvr_autorec_entry_t *dae;
+  int i;
+
+  for (i = 0; i <= AUTOREC_BUCKET_NOGENRE; i++)
+    autorec_unbound[i].count = 0;
+  for (i = 0; i < AUTOREC_TITLE_HASH; i++)
+    autorec_title[i].count = 0;
+  for (i = 0; i < 24; i++)
+    autorec_hour[i].count = 0;
+  autorec_title_count = 0;
+  TAILQ_FOREACH(dae, &autorec_entries, dae_link) {
+    if (dae->dae_channel || dae->dae_channel_tag)
+      continue;
+    if (!dae->dae_enabled || !dae->dae_weekdays)
+      continue;
+    if (dvr_autorec_index_title(dae) || dvr_autorec_index_hours(dae))
+      continue;
+    i = dae->dae_content_type ? (dae->dae_content_type >> 4) & 0x0f :
+                                AUTOREC_BUCKET_NOGENRE;
+    dvr_autorec_bucket_add(&autorec_unbound[i], dae);
+  }
+  autorec_index_dirty = 0;
+}
+
+static void
+dvr_autorec_index_done(void)
+{
+  int i;
+
+  for (i = 0; i <= AUTOREC_BUCKET_NOGENRE; i++) {
+    free(autorec_unbound[i].entries);
+    memset(&autorec_unbound[i], 0, sizeof(autorec_unbound[i]));
+  }
+  for (i = 0; i < AUTOREC_TITLE_HASH; i++) {
+    free(autorec_title[i].entries);
+    memset(&autorec_title[i], 0, sizeof(autorec_title[i]));
+  }
+  for (i = 0; i < 24; i++) {
+    free(autorec_hour[i].entries);
+    memset(&autorec_hour[i], 0, sizeof(autorec_hour[i]));
+  }
+  autorec_title_count = 0;
+  autorec_index_dirty = 1;
+}
+
+/*
+ * Mark the title buckets of the event trigrams, returns -1 when all
+ * buckets must be checked (the literal match is exact for ASCII only)
+ */
+static int
+dvr_autorec_title_buckets(epg_broadcast_t *e, uint32_t *map)
+{
+  lang_str_ele_t *ls;
+  const uint8_t *s;
+  uint32_t g, h;
+
+  if (e->title == NULL)
+    return 0;
+  RB_FOREACH(ls, e->title, link) {
+    s = (const uint8_t *)ls->str;
+    if (s[0] == '\0' || s[1] == '\0')
+      continue;
+    if (s[0] >= 0x80 || s[1] >= 0x80)
+      return -1;
+    g = (dvr_autorec_fold(s[0]) << 8) | dvr_autorec_fold(s[1]);
+    for (s += 2; *s; s++) {
+      if (*s >= 0x80)
+        return -1;
+      g = ((g << 8) | dvr_autorec_fold(*s)) & 0xffffff;
+      h = dvr_autorec_title_hash(g);
+      map[h >> 5] |= 1 << (h & 31);
+    }
+  }
+  return 0;
+}
+
+static int
+dvr_autorec_seq_cmp(const void *a, const void *b)
+{
+  uint32_t x = (*(dvr_autorec_entry_t **)a)->dae_seq;
+  uint32_t y = (*(dvr_autorec_entry_t **)b)->dae_seq;
+  return (x > y) - (x < y);
+}
+
+/*
+ * Match the plain title without the regex engine. It is exact only
+ * for the ASCII strings (the caseless regex match may fold some
+ * other characters to the ASCII ones), so -1 is returned otherwise.
+ */
+static int
+dvr_autorec_literal_match(const char *lit, const char *str)
+{
+  const uint8_t *s, *p, *q;
+
+  for (s = (const uint8_t *)str; *s; s++)
+    if (*s >= 0x80)
+      return -1;
+  for (s = (const uint8_t *)str; *s; s++) {
+    for (p = (const uint8_t *)lit, q = s;
+         *p && dvr_autorec_fold(*p) == dvr_autorec_fold(*q); p++, q++);
+    if (*p == '\0')
+      return 1;
+  }
+  return 0;
+}
+
+/*
+ * Returns zero when the title matches (regex_match() convention)
+ */
+static int
+dvr_autorec_title_match(dvr_autorec_entry_t *dae, const char *str)
+{
+  int r;
+
+  if (dae->dae_title_literal &&
+      (r = dvr_autorec_literal_match(dae->dae_title, str)) >= 0)
+    return !r;
+  return regex_match(&dae->dae_title_regex, str);
 }
 
 /*
@@ -186,9 +416,12 @@ dvr_autorec_completed(dvr_autorec_entry_t *dae, int error_code)
 
 /**
  * return 1 if the event 'e' is matched by the autorec rule 'dae'
+ *
+ * 'etm' caches the local start time of the event for the checks
+ * against several rules, tm_mday is zero until it is filled
  */
-int
-dvr_autorec_cmp(dvr_autorec_entry_t *dae, epg_broadcast_t *e)
+static int
+dvr_autorec_cmp_tm(dvr_autorec_entry_t *dae, epg_broadcast_t *e, struct tm *etm)
 {
   idnode_list_mapping_t *ilm;
   dvr_config_t *cfg;
@@ -280,8 +513,9 @@ dvr_autorec_cmp(dvr_autorec_entry_t *dae, epg_broadcast_t *e)
      dae->dae_start < 24*60 && dae->dae_start_window < 24*60) {
     struct tm a_time, ev_time;
     time_t ta, te, tad;
-    localtime_r(&e->start, &a_time);
-    ev_time = a_time;
+    if (etm->tm_mday == 0)
+      localtime_r(&e->start, etm);
+    a_time = ev_time = *etm;
     a_time.tm_min = dae->dae_start % 60;
     a_time.tm_hour = dae->dae_start / 60;
     ta = mktime(&a_time);
@@ -333,9 +567,9 @@ dvr_autorec_cmp(dvr_autorec_entry_t *dae, epg_broadcast_t *e)
   }
 
   if(dae->dae_weekdays != 0x7f) {
-    struct tm tm;
-    localtime_r(&e->start, &tm);
-    if(!((1 << ((tm.tm_wday ?: 7) - 1)) & dae->dae_weekdays))
+    if (etm->tm_mday == 0)
+      localtime_r(&e->start, etm);
+    if(!((1 << ((etm->tm_wday ?: 7) - 1)) & dae->dae_weekdays))
       return 0;
   }
 
@@ -362,27 +596,27 @@ dvr_autorec_cmp(dvr_autorec_entry_t *dae, epg_broadcast_t *e)
       if (!dae->dae_fulltext) {
         if(!e->title) return 0;
         RB_FOREACH(ls, e->title, link)
-          if (!regex_match(&dae->dae_title_regex, ls->str)) break;
+          if (!dvr_autorec_title_match(dae, ls->str)) break;
       } else {
         ls = NULL;
         if (e->title)
           RB_FOREACH(ls, e->title, link)
-            if (!regex_match(&dae->dae_title_regex, ls->str)) break;
+            if (!dvr_autorec_title_match(dae, ls->str)) break;
         if (!ls && e->subtitle)
           RB_FOREACH(ls, e->subtitle, link)
-            if (!regex_match(&dae->dae_title_regex, ls->str)) break;
+            if (!dvr_autorec_title_match(dae, ls->str)) break;
         if (!ls && e->summary)
           RB_FOREACH(ls, e->summary, link)
-            if (!regex_match(&dae->dae_title_regex, ls->str)) break;
+            if (!dvr_autorec_title_match(dae, ls->str)) break;
         if (!ls && e->description)
           RB_FOREACH(ls, e->description, link)
-            if (!regex_match(&dae->dae_title_regex, ls->str)) break;
+            if (!dvr_autorec_title_match(dae, ls->str)) break;
         if (!ls && e->credits_cached)
           RB_FOREACH(ls, e->credits_cached, link)
-            if (!regex_match(&dae->dae_title_regex, ls->str)) break;
+            if (!dvr_autorec_title_match(dae, ls->str)) break;
         if (!ls && e->keyword_cached)
           RB_FOREACH(ls, e->keyword_cached, link)
-            if (!regex_match(&dae->dae_title_regex, ls->str)) break;
+            if (!dvr_autorec_title_match(dae, ls->str)) break;
       }//END fulltext block
     }
     else
@@ -391,7 +625,7 @@ dvr_autorec_cmp(dvr_autorec_entry_t *dae, epg_broadcast_t *e)
       mergedtext = epg_broadcast_get_merged_text(e);  //'e' is the EPG record being merged.
       if(mergedtext)
       {
-        mergedtextResult = regex_match(&dae->dae_title_regex, mergedtext);
+        mergedtextResult = dvr_autorec_title_match(dae, mergedtext);
         free(mergedtext);
         if(!mergedtextResult)
         {
@@ -410,6 +644,15 @@ dvr_autorec_cmp(dvr_autorec_entry_t *dae, epg_broadcast_t *e)
   return 1;
 }
 
+int
+dvr_autorec_cmp(dvr_autorec_entry_t *dae, epg_broadcast_t *e)
+{
+  struct tm etm;
+
+  etm.tm_mday = 0;
+  return dvr_autorec_cmp_tm(dae, e, &etm);
+}
+
 /**
  *
  */
@@ -438,7 +681,9 @@ dvr_autorec_create(const char *uuid, htsmsg_t *conf)
   dae->dae_config = dvr_config_find_by_name_default(NULL);
   LIST_INSERT_HEAD(&dae->dae_config->dvr_autorec_entries, dae, dae_config_link);
 
+  dae->dae_seq = ++autorec_seq;
   TAILQ_INSERT_TAIL(&autorec_entries, dae, dae_link);
+  autorec_index_dirty = 1;
 
   idnode_load(&dae->dae_id, conf);
 
@@ -534,6 +779,7 @@ autorec_entry_destroy(dvr_autorec_entry_t *dae, int delconf)
   htsp_autorec_entry_delete(dae);
 
   TAILQ_REMOVE(&autorec_entries, dae, dae_link);
+  autorec_index_dirty = 1;
   idnode_unlink(&dae->dae_id);
 
   if(dae->dae_config)
@@ -570,6 +816,7 @@ dvr_autorec_entry_class_changed(idnode_t *self)
 
   if (dae->dae_error)
     dae->dae_enabled = 0;
+  autorec_index_dirty = 1;
   dvr_autorec_changed(dae, 1);
   dvr_autorec_completed(dae, 0);
   htsp_autorec_entry_update(dae);
@@ -630,6 +877,7 @@ dvr_autorec_entry_class_channel_set(void *o, const void *v)
     if (dae->dae_channel) {
       LIST_REMOVE(dae, dae_channel_link);
       dae->dae_channel = NULL;
+      autorec_index_dirty = 1;
       return 1;
     }
   } else if (dae->dae_channel != ch) {
@@ -640,6 +888,7 @@ dvr_autorec_entry_class_channel_set(void *o, const void *v)
       LIST_REMOVE(dae, dae_channel_link);
     dae->dae_channel = ch;
     LIST_INSERT_HEAD(&ch->ch_autorecs, dae, dae_channel_link);
+    autorec_index_dirty = 1;
     return 1;
   }
   return 0;
@@ -674,9 +923,15 @@ dvr_autorec_entry_class_title_set(void *o, const void *v)
     if (dae->dae_title)
       autorec_regfree(dae);
     dae->dae_error = 0;
-    if (!regex_compile(&dae->dae_title_regex, title, TVHREGEX_CASELESS, LS_DVR))
+    if (!regex_compile(&dae->dae_title_regex, title, TVHREGEX_CASELESS, LS_DVR)) {
       dae->dae_title = strdup(title);
-    else
+      dae->dae_title_literal = 1;
+      for (; *title; title++)
+        if ((uint8_t)*title >= 0x80 || strchr(".^$*+?()[]{}|\\#", *title)) {
+          dae->dae_title_literal = 0;
+          break;
+        }
+    } else
       dae->dae_error = 1;
     return 1;
   }
@@ -692,12 +947,14 @@ dvr_autorec_entry_class_tag_set(void *o, const void *v)
   if (tag == NULL && dae->dae_channel_tag) {
     LIST_REMOVE(dae, dae_channel_tag_link);
     dae->dae_channel_tag = NULL;
+    autorec_index_dirty = 1;
     return 1;
   } else if (dae->dae_channel_tag != tag) {
     if (dae->dae_channel_tag)
       LIST_REMOVE(dae, dae_channel_tag_link);
     dae->dae_channel_tag = tag;
     LIST_INSERT_HEAD(&tag->ct_autorecs, dae, dae_channel_tag_link);
+    autorec_index_dirty = 1;
     return 1;
   }
   return 0;
@@ -1521,6 +1778,7 @@ dvr_autorec_done(void)
   tvh_mutex_lock(&global_lock);
   while ((dae = TAILQ_FIRST(&autorec_entries)) != NULL)
     autorec_entry_destroy(dae, 0);
+  dvr_autorec_index_done();
   tvh_mutex_unlock(&global_lock);
 }
 
@@ -1563,15 +1821,109 @@ dvr_autorec_async_reschedule(void)
 void
 dvr_autorec_check_event(epg_broadcast_t *e)
 {
-  dvr_autorec_entry_t *dae;
-
-  if (e->channel && !e->channel->ch_enabled)
+  dvr_autorec_entry_t *dae, *stack[32], **cand = stack;
+  idnode_list_mapping_t *ilm;
+  channel_tag_t *ct;
+  channel_t *ch = e->channel;
+  epg_genre_t *g;
+  dvr_autorec_bucket_t *b;
+  struct tm etm;
+  uint32_t tmap[AUTOREC_TITLE_HASH / 32];
+  int i, j, pass, tall = 0, count = 0, size = ARRAY_SIZE(stack);
+  uint32_t majors = 1 << AUTOREC_BUCKET_NOGENRE;
+
+  if (ch == NULL || !ch->ch_enabled)
     return;
-  TAILQ_FOREACH(dae, &autorec_entries, dae_link)
-    if(dvr_autorec_cmp(dae, e))
-      dvr_entry_create_by_autorec(1, e, dae);
+  if (TAILQ_EMPTY(&autorec_entries))
+    return;
+  if (autorec_index_dirty)
+    dvr_autorec_index_rebuild();
+
+  LIST_FOREACH(g, &e->genre, link)
+    majors |= 1 << (g->code >> 4);
+  memset(tmap, 0, sizeof(tmap));
+  if (autorec_title_count)
+    tall = dvr_autorec_title_buckets(e, tmap) < 0;
+  localtime_r(&e->start, &etm);
+
+  /*
+   * Collect only the rules which may match this channel, title, start
+   * hour and genre, the second pass is used when the stack array is
+   * too small
+   */
+  for (pass = 0; pass < 2; pass++) {
+    count = 0;
+    LIST_FOREACH(dae, &ch->ch_autorecs, dae_channel_link) {
+      if (count < size) cand[count] = dae;
+      count++;
+    }
+    LIST_FOREACH(ilm, &ch->ch_ctms, ilm_in2_link) {
+      ct = (channel_tag_t *)ilm->ilm_in1;
+      LIST_FOREACH(dae, &ct->ct_autorecs, dae_channel_tag_link)
+        if (dae->dae_channel == NULL) {
+          if (count < size) cand[count] = dae;
+          count++;
+        }
+    }
+    for (i = 0; autorec_title_count && i < AUTOREC_TITLE_HASH; i++) {
+      if (!tall && (tmap[i >> 5] & (1 << (i & 31))) == 0)
+        continue;
+      b = &autorec_title[i];
+      for (j = 0; j < b->count; j++, count++)
+        if (count < size) cand[count] = b->entries[j];
+    }
+    b = &autorec_hour[etm.tm_hour];
+    for (j = 0; j < b->count; j++, count++)
+      if (count < size) cand[count] = b->entries[j];
+    for (i = 0; i <= AUTOREC_BUCKET_NOGENRE; i++) {
+      if ((majors & (1 << i)) == 0)
+        continue;
+      b = &autorec_unbound[i];
+      for (j = 0; j < b->count; j++, count++)
+        if (count < size) cand[count] = b->entries[j];
+    }
+    if (count <= size)
+      break;
+    size = count;
+    cand = malloc(size * sizeof(*cand));
+  }
+
+  /* Keep the rule order from autorec_entries */
+  if (count > 1)
+    qsort(cand, count, sizeof(*cand), dvr_autorec_seq_cmp);
+
+  for (i = 0; i < count; i++)
+    if (dvr_autorec_cmp_tm(cand[i], e, &etm))
+      dvr_entry_create_by_autorec(1, e, cand[i]);
   // Note: no longer updating event here as it will be done from EPG
   //       anyway
+
+  if (cand != stack)
+    free(cand);
+}
+
+/**
+ *
+ */
+static void
+dvr_autorec_changed_channel
+  (dvr_autorec_entry_t *dae, channel_t *ch, epg_broadcast_t **disabled)
+{
+  epg_broadcast_t *e, **p;
+  struct tm etm;
+  int enabled;
+
+  RB_FOREACH(e, &ch->ch_epg_schedule, sched_link) {
+    etm.tm_mday = 0;
+    if(dvr_autorec_cmp_tm(dae, e, &etm)) {
+      enabled = 1;
+      if (disabled) {
+        for (p = disabled; *p && *p != e; p++);
+        enabled = *p == NULL;
+      }
+      dvr_entry_create_by_autorec(enabled, e, dae);
+    }
+  }
 }
 
 /**
@@ -1580,24 +1932,28 @@ dvr_autorec_check_event(epg_broadcast_t *e)
 void
 dvr_autorec_changed(dvr_autorec_entry_t *dae, int purge)
 {
+  idnode_list_mapping_t *ilm;
   channel_t *ch;
-  epg_broadcast_t *e, **disabled = NULL, **p;
-  int enabled;
+  epg_broadcast_t **disabled = NULL;
 
   if (purge)
     disabled = dvr_autorec_purge_spawns(dae, 1, 1);
 
-  CHANNEL_FOREACH(ch) {
-    if (!ch->ch_enabled) continue;
-    RB_FOREACH(e, &ch->ch_epg_schedule, sched_link) {
-      if(dvr_autorec_cmp(dae, e)) {
-        enabled = 1;
-        if (disabled) {
-          for (p = disabled; *p && *p != e; p++);
-          enabled = *p == NULL;
-        }
-        dvr_entry_create_by_autorec(enabled, e, dae);
+  if (!dae->dae_enabled || !dae->dae_weekdays) {
+    /* Nothing can match */
+  } else if (dae->dae_channel) {
+    if (dae->dae_channel->ch_enabled)
+      dvr_autorec_changed_channel(dae, dae->dae_channel, disabled);
+  } else {
+    CHANNEL_FOREACH(ch) {
+      if (!ch->ch_enabled) continue;
+      if (dae->dae_channel_tag) {
+        LIST_FOREACH(ilm, &ch->ch_ctms, ilm_in2_link)
+          if ((channel_tag_t *)ilm->ilm_in1 == dae->dae_channel_tag)
+            break;
+        if (ilm == NULL) continue;
       }
+      dvr_autorec_changed_channel(dae, ch, disabled);
     }
   }
 
@@ -1628,6 +1984,7 @@ autorec_destroy_by_channel_tag(channel_tag_t *ct, int delconf)
   while((dae = LIST_FIRST(&ct->ct_autorecs)) != NULL) {
     LIST_REMOVE(dae, dae_channel_tag_link);
     dae->dae_channel_tag = NULL;
+    autorec_index_dirty = 1;
     idnode_notify_changed(&dae->dae_id);
     if (delconf)
       idnode_changed(&dae->dae_id);
@@ -1760,7 +1760,7 @@ dvr_thread(void *aux)
 
   tvh_mutex_lock(&sq->sq_mutex);
   while(run) {
-    sm = TAILQ_FIRST(&sq->sq_queue);
+    sm = streaming_queue_first(sq);
     if(sm == NULL) {
       tvh_cond_wait(&sq->sq_cond, &sq->sq_mutex);
       continue;
@@ -2010,6 +2010,7 @@ fin:
     case SMT_SIGNAL_STATUS:
     case SMT_TIMESHIFT_STATUS:
     case SMT_DESCRAMBLE_INFO:
+    case SMT_PACKET_BATCH:
       break;
 
     case SMT_EXIT:
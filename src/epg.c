@@ -170,8 +170,13 @@ static void _epg_object_set_updated0 ( void *o )
 
 static inline void _epg_object_set_updated ( void *o )
 {
-  if (!((epg_object_t *)o)->_updated)
+  epg_object_t *eo = o;
+  if (!eo->_updated)
     _epg_object_set_updated0(o);
+  /* skeletons have no reference */
+  if (eo->type == EPG_BROADCAST && eo->refcount > 0 &&
+      !((epg_broadcast_t *)eo)->db_dirty)
+    epgdb_broadcast_changed((epg_broadcast_t *)eo);
 }
 
 static int _epg_object_can_remove ( void *_old, void *_new )
@@ -495,6 +500,7 @@ static void _epg_channel_rem_broadcast
   ( channel_t *ch, epg_broadcast_t *ebc, epg_broadcast_t *ebc_new )
 {
   RB_REMOVE(&ch->ch_epg_schedule, ebc, sched_link);
+  epgdb_broadcast_removed(ebc);
   if (ch->ch_epg_now  == ebc) ch->ch_epg_now  = NULL;
   if (ch->ch_epg_next == ebc) ch->ch_epg_next = NULL;
   if (ebc_new) {
@@ -624,6 +630,7 @@ static epg_broadcast_t *_epg_channel_add_broadcast
       _epg_object_create(ret);
       // Note: sets updated
       _epg_object_getref(ret);
+      epgdb_broadcast_changed(ret);
       ret->grabber = src;
       tvhtrace(LS_EPG, "added event %u (%s) on %s @ %s to %s (grabber %s)",
                ret->id, epg_broadcast_get_title(ret, NULL),
@@ -878,6 +885,8 @@ static void _epg_broadcast_destroy ( void *eo )
     snprintf(id, sizeof(id), "%u", ebc->id);
     notify_delayed(id, "epg", "delete");
   }
+  epg_index_title_remove(ebc);
+  epgdb_broadcast_removed(ebc);
   if (ebc->title)       lang_str_destroy(ebc->title);
   if (ebc->subtitle)    lang_str_destroy(ebc->subtitle);
   if (ebc->summary)     lang_str_destroy(ebc->summary);
@@ -1145,6 +1154,12 @@ epg_broadcast_t *epg_broadcast_clone
   return ebc;
 }
 
+void epg_broadcast_remove ( epg_broadcast_t *ebc )
+{
+  if (ebc->channel)
+    _epg_channel_rem_broadcast(ebc->channel, ebc, NULL);
+}
+
 epg_broadcast_t *epg_broadcast_find_by_id ( uint32_t id )
 {
   return (epg_broadcast_t*)epg_object_find_by_id(id, EPG_BROADCAST);
@@ -1314,9 +1329,13 @@ int epg_broadcast_set_star_rating
 int epg_broadcast_set_title
   ( epg_broadcast_t *b, const lang_str_t *title, epg_changes_t *changed )
 {
+  int save;
   if (!b) return 0;
-  return _epg_object_set_lang_str(b, &b->title, title,
+  save = _epg_object_set_lang_str(b, &b->title, title,
                                   changed, EPG_CHANGED_TITLE);
+  if (save)
+    epg_index_title_update(b);
+  return save;
 }
 
 int epg_broadcast_set_subtitle
@@ -1537,6 +1556,30 @@ int epg_broadcast_set_rating_label
   return 0;
 }
 
+int epg_broadcast_set_start
+  ( epg_broadcast_t *b, time_t start )
+{
+  if (!b) return 0;
+  if (b->start != start) {
+    b->start = start;
+    _epg_object_set_updated(b);
+    return 1;
+  }
+  return 0;
+}
+
+int epg_broadcast_set_stop
+  ( epg_broadcast_t *b, time_t stop )
+{
+  if (!b) return 0;
+  if (b->stop != stop) {
+    b->stop = stop;
+    _epg_object_set_updated(b);
+    return 1;
+  }
+  return 0;
+}
+
 int epg_broadcast_set_first_aired
   ( epg_broadcast_t *b, time_t aired, epg_changes_t *changed )
 {
@@ -1778,20 +1821,90 @@ htsmsg_t *epg_broadcast_serialize ( epg_broadcast_t *broadcast )
   return m;
 }
 
-epg_broadcast_t *epg_broadcast_deserialize
-  ( htsmsg_t *m, int create, int *save )
+/*
+ * Build the allocated record fields, no global state is used
+ */
+void epg_broadcast_prep ( epg_broadcast_prep_t *p, htsmsg_t *m )
+{
+  htsmsg_t *hm;
+  htsmsg_field_t *f;
+  epg_genre_t genre;
+
+  memset(p, 0, sizeof(*p));
+  p->ready = 1;
+
+  if ((hm = htsmsg_get_list(m, "genre"))) {
+    p->genre = calloc(1, sizeof(epg_genre_list_t));
+    HTSMSG_FOREACH(f, hm) {
+      genre.code = (uint8_t)f->hmf_s64;
+      epg_genre_list_add(p->genre, &genre);
+    }
+  }
+
+  p->title       = lang_str_deserialize(m, "tit");
+  p->subtitle    = lang_str_deserialize(m, "sti");
+  p->summary     = lang_str_deserialize(m, "sum");
+  p->description = lang_str_deserialize(m, "des");
+
+  if ((hm = htsmsg_get_map(m, "epn"))) {
+    epg_episode_epnum_deserialize(hm, &p->epnum);
+    p->has_epnum = 1;
+  }
+
+  p->keyword  = string_list_deserialize(m, "key");
+  p->category = string_list_deserialize(m, "cat");
+}
+
+void epg_broadcast_prep_done ( epg_broadcast_prep_t *p )
+{
+  if (!p->ready)
+    return;
+  if (p->genre)
+    epg_genre_list_destroy(p->genre);
+  if (p->title)
+    lang_str_destroy(p->title);
+  if (p->subtitle)
+    lang_str_destroy(p->subtitle);
+  if (p->summary)
+    lang_str_destroy(p->summary);
+  if (p->description)
+    lang_str_destroy(p->description);
+  free(p->epnum.text);
+  if (p->keyword)
+    string_list_destroy(p->keyword);
+  if (p->category)
+    string_list_destroy(p->category);
+  memset(p, 0, sizeof(*p));
+}
+
+/*
+ * Move a prepared string to an empty field of a new broadcast,
+ * an existing broadcast is updated (and the string copied) as usual
+ */
+static int
+_epg_broadcast_take_lang_str
+  ( epg_broadcast_t *b, lang_str_t **old, lang_str_t **nval,
+    epg_changes_t *changed, epg_changes_t cflag )
+{
+  if (*nval == NULL || *old != NULL)
+    return _epg_object_set_lang_str(b, old, *nval, changed, cflag);
+  if (changed) *changed |= cflag;
+  *old = *nval;
+  *nval = NULL;
+  _epg_object_set_updated(b);
+  return 1;
+}
+
+epg_broadcast_t *epg_broadcast_deserialize_prep
+  ( htsmsg_t *m, epg_broadcast_prep_t *p, int create, int *save )
 {
   channel_t *ch = NULL;
   epg_broadcast_t *ebc, **skel = _epg_broadcast_skel();
-  lang_str_t *ls;
   htsmsg_t *hm;
-  htsmsg_field_t *f;
-  string_list_t *sl;
   const char *str;
   uint32_t eid, u32;
   epg_changes_t changes = 0;
   int64_t start, stop, s64;
-  epg_episode_num_t num;
 
   if (htsmsg_get_s64(m, "start", &start)) return NULL;
   if (htsmsg_get_s64(m, "stop", &stop)) return NULL;
@@ -1853,39 +1966,28 @@ epg_broadcast_t *epg_broadcast_deserialize
   if ((str = htsmsg_get_str(m, "img")))
     *save |= epg_broadcast_set_image(ebc, str, &changes);
 
-  if ((hm = htsmsg_get_list(m, "genre"))) {
-    epg_genre_list_t *egl = calloc(1, sizeof(epg_genre_list_t));
-    HTSMSG_FOREACH(f, hm) {
-      epg_genre_t genre;
-      genre.code = (uint8_t)f->hmf_s64;
-      epg_genre_list_add(egl, &genre);
-    }
-    *save |= epg_broadcast_set_genre(ebc, egl, &changes);
-    epg_genre_list_destroy(egl);
-  }
+  if (p->genre)
+    *save |= epg_broadcast_set_genre(ebc, p->genre, &changes);
 
-  if ((ls = lang_str_deserialize(m, "tit"))) {
-    *save |= epg_broadcast_set_title(ebc, ls, &changes);
-    lang_str_destroy(ls);
-  }
-  if ((ls = lang_str_deserialize(m, "sti"))) {
-    *save |= epg_broadcast_set_subtitle(ebc, ls, &changes);
-    lang_str_destroy(ls);
-  }
-  if ((ls = lang_str_deserialize(m, "sum"))) {
-    *save |= epg_broadcast_set_summary(ebc, ls, &changes);
-    lang_str_destroy(ls);
-  }
-  if ((ls = lang_str_deserialize(m, "des"))) {
-    *save |= epg_broadcast_set_description(ebc, ls, &changes);
-    lang_str_destroy(ls);
+  if (p->title) {
+    if (_epg_broadcast_take_lang_str(ebc, &ebc->title, &p->title,
+                                     &changes, EPG_CHANGED_TITLE)) {
+      epg_index_title_update(ebc);
+      *save = 1;
+    }
   }
+  if (p->subtitle)
+    *save |= _epg_broadcast_take_lang_str(ebc, &ebc->subtitle, &p->subtitle,
+                                          &changes, EPG_CHANGED_SUBTITLE);
+  if (p->summary)
+    *save |= _epg_broadcast_take_lang_str(ebc, &ebc->summary, &p->summary,
+                                          &changes, EPG_CHANGED_SUMMARY);
+  if (p->description)
+    *save |= _epg_broadcast_take_lang_str(ebc, &ebc->description, &p->description,
+                                          &changes, EPG_CHANGED_DESCRIPTION);
 
-  if ((hm = htsmsg_get_map(m, "epn"))) {
-    epg_episode_epnum_deserialize(hm, &num);
-    *save |= epg_broadcast_set_epnum(ebc, &num, &changes);
-    if (num.text) free(num.text);
-  }
+  if (p->has_epnum)
+    *save |= epg_broadcast_set_epnum(ebc, &p->epnum, &changes);
 
   if (!htsmsg_get_u32(m, "cyear", &u32))
     *save |= epg_broadcast_set_copyright_year(ebc, u32, &changes);
@@ -1895,14 +1997,10 @@ epg_broadcast_t *epg_broadcast_deserialize
   if ((hm = htsmsg_get_map(m, "cred")))
     *save |= epg_broadcast_set_credits(ebc, hm, &changes);
 
-  if ((sl = string_list_deserialize(m, "key"))) {
-    *save |= epg_broadcast_set_keyword(ebc, sl, &changes);
-    string_list_destroy(sl);
-  }
-  if ((sl = string_list_deserialize(m, "cat"))) {
-    *save |= epg_broadcast_set_category(ebc, sl, &changes);
-    string_list_destroy(sl);
-  }
+  if (p->keyword)
+    *save |= epg_broadcast_set_keyword(ebc, p->keyword, &changes);
+  if (p->category)
+    *save |= epg_broadcast_set_category(ebc, p->category, &changes);
 
   /* Series link */
   if ((str = htsmsg_get_str(m, "slink")))
@@ -1915,6 +2013,18 @@ epg_broadcast_t *epg_broadcast_deserialize
   return ebc;
 }
 
+epg_broadcast_t *epg_broadcast_deserialize
+  ( htsmsg_t *m, int create, int *save )
+{
+  epg_broadcast_prep_t p;
+  epg_broadcast_t *ebc;
+
+  epg_broadcast_prep(&p, m);
+  ebc = epg_broadcast_deserialize_prep(m, &p, create, save);
+  epg_broadcast_prep_done(&p);
+  return ebc;
+}
+
 /* **************************************************************************
  * Genre
  * *************************************************************************/
@@ -2451,14 +2561,105 @@ _eq_add ( epg_query_t *eq, epg_broadcast_t *e )
   eq->result[eq->entries++] = e;
 }
 
+/*
+ * Start time window implied by the start/stop filters
+ */
+static void
+_eq_start_window ( epg_query_t *eq, int64_t *lo, int64_t *hi )
+{
+  *lo = INT64_MIN;
+  *hi = INT64_MAX;
+  switch (eq->start.comp) {
+    case EC_EQ: *lo = *hi = eq->start.val1; break;
+    case EC_GT: *lo = eq->start.val1; break;
+    case EC_LT: *hi = eq->start.val1; break;
+    case EC_RG: *lo = eq->start.val1; *hi = eq->start.val2; break;
+    default: break;
+  }
+  /* start < stop */
+  switch (eq->stop.comp) {
+    case EC_EQ:
+    case EC_LT: *hi = MIN(*hi, eq->stop.val1); break;
+    case EC_RG: *hi = MIN(*hi, eq->stop.val2); break;
+    default: break;
+  }
+}
+
 static void
 _eq_add_channel ( epg_query_t *eq, channel_t *ch )
 {
-  epg_broadcast_t *ebc;
-  RB_FOREACH(ebc, &ch->ch_epg_schedule, sched_link)
+  epg_broadcast_t *ebc, skel;
+  int64_t lo, hi;
+
+  /* the schedule is ordered by the start time */
+  _eq_start_window(eq, &lo, &hi);
+  if (lo > 0) {
+    skel.start = lo;
+    ebc = RB_FIND_GE(&ch->ch_epg_schedule, &skel, sched_link, _ebc_start_cmp);
+  } else {
+    ebc = RB_FIRST(&ch->ch_epg_schedule);
+  }
+  for ( ; ebc && ebc->start <= hi; ebc = RB_NEXT(ebc, sched_link))
     _eq_add(eq, ebc);
 }
 
+static int
+_eq_channel_match
+  ( channel_t *ch, channel_t *channel, channel_tag_t *tag, access_t *perm )
+{
+  idnode_list_mapping_t *ilm;
+
+  if (channel && ch != channel)
+    return 0;
+  if (tag) {
+    LIST_FOREACH(ilm, &ch->ch_ctms, ilm_in2_link)
+      if ((channel_tag_t *)ilm->ilm_in1 == tag)
+        break;
+    if (ilm == NULL)
+      return 0;
+  }
+  return channel_access(ch, perm, 0);
+}
+
+/*
+ * Title searches are answered from the title index, only the
+ * broadcasts with matching trigrams are checked
+ */
+static int
+_eq_add_indexed
+  ( epg_query_t *eq, channel_t *channel, channel_tag_t *tag, access_t *perm )
+{
+  epg_broadcast_t *ebc;
+  channel_t *ch, *last = NULL;
+  const char *str = NULL;
+  uint32_t *ids, count, i;
+  int regex = 0, ok = 0;
+
+  if (eq->stitle && !eq->fulltext && !eq->mergetext) {
+    str = eq->stitle;
+    regex = 1;
+  } else if (eq->title.comp == EC_EQ || eq->title.comp == EC_RE) {
+    str = eq->title.str;
+    regex = eq->title.comp == EC_RE;
+  }
+  if (epg_index_title_find(str, regex, &ids, &count))
+    return 0;
+
+  for (i = 0; i < count; i++) {
+    ebc = epg_broadcast_find_by_id(ids[i]);
+    if (ebc == NULL || (ch = ebc->channel) == NULL)
+      continue;
+    if (ch != last) {
+      last = ch;
+      ok = _eq_channel_match(ch, channel, tag, perm);
+    }
+    if (ok)
+      _eq_add(eq, ebc);
+  }
+  free(ids);
+  return 1;
+}
+
 static int
 _eq_init_str( epg_filter_str_t *f )
 {
@@ -2693,8 +2894,11 @@ epg_query ( epg_query_t *eq, access_t *perm )
   tag = channel_tag_find_by_uuid(eq->channel_tag) ?:
         channel_tag_find_by_name(eq->channel_tag, 0);
 
+  /* Title search */
+  if ((channel == NULL || tag) && _eq_add_indexed(eq, channel, tag, perm)) {
+
   /* Single channel */
-  if (channel && tag == NULL) {
+  } else if (channel && tag == NULL) {
     if (channel_access(channel, perm, 0))
       _eq_add_channel(eq, channel);
 
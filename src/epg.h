@@ -311,6 +311,13 @@ struct epg_broadcast
                                                ///< sound too similar to dvr recorded functionality. We'll only store the
                                                ///< year since we only get year not month and day.
   char                       *xmltv_eid;       ///< XMLTV (or other) unique event identifier
+
+  uint16_t                   idx_grams;        ///< Title index: number of trigrams
+  uint8_t                    idx_title;        ///< Title index: the title is indexed
+
+  LIST_ENTRY(epg_broadcast)  db_link;          ///< Database: changed since last save
+  uint8_t                    db_dirty;         ///< Database: 1 = changed, 2 = removed
+  uint8_t                    db_stored;        ///< Database: present in the file
 };
 
 /* Lookup */
@@ -331,6 +338,7 @@ int epg_broadcast_change_finish( epg_broadcast_t *b, epg_changes_t changed, int
 /* Special */
 epg_broadcast_t *epg_broadcast_clone
   ( struct channel *channel, epg_broadcast_t *src, int *save );
+void epg_broadcast_remove ( epg_broadcast_t *b );
 
 /* Mutators */
 int epg_broadcast_set_dvb_eid
@@ -414,6 +422,12 @@ int epg_broadcast_set_image
 int epg_broadcast_set_is_bw
   ( epg_broadcast_t *b, uint8_t bw, epg_changes_t *changed )
   __attribute__((warn_unused_result));
+int epg_broadcast_set_start
+  ( epg_broadcast_t *b, time_t start )
+  __attribute__((warn_unused_result));
+int epg_broadcast_set_stop
+  ( epg_broadcast_t *b, time_t stop )
+  __attribute__((warn_unused_result));
 int epg_broadcast_set_first_aired
   ( epg_broadcast_t *b, time_t aired, epg_changes_t *changed )
   __attribute__((warn_unused_result));
@@ -473,6 +487,26 @@ htsmsg_t        *epg_broadcast_serialize   ( epg_broadcast_t *b );
 epg_broadcast_t *epg_broadcast_deserialize
   ( htsmsg_t *m, int create, int *save );
 
+/* Deserialization in two steps: the record fields are built without
+ * any lock (epgdb load workers), then linked under global_lock */
+typedef struct epg_broadcast_prep {
+  uint8_t            ready;
+  uint8_t            has_epnum;
+  lang_str_t        *title;
+  lang_str_t        *subtitle;
+  lang_str_t        *summary;
+  lang_str_t        *description;
+  epg_genre_list_t  *genre;
+  string_list_t     *keyword;
+  string_list_t     *category;
+  epg_episode_num_t  epnum;
+} epg_broadcast_prep_t;
+
+void epg_broadcast_prep ( epg_broadcast_prep_t *p, htsmsg_t *m );
+void epg_broadcast_prep_done ( epg_broadcast_prep_t *p );
+epg_broadcast_t *epg_broadcast_deserialize_prep
+  ( htsmsg_t *m, epg_broadcast_prep_t *p, int create, int *save );
+
 /* ************************************************************************
  * Channel - provides mapping from EPG channels to real channels
  * ***********************************************************************/
@@ -576,6 +610,18 @@ typedef struct epg_query {
 epg_broadcast_t  **epg_query(epg_query_t *eq, access_t *perm);
 void epg_query_free(epg_query_t *eq);
 
+/* ************************************************************************
+ * Title index
+ * ***********************************************************************/
+
+void epg_index_title_update ( epg_broadcast_t *ebc );
+void epg_index_title_remove ( epg_broadcast_t *ebc );
+int  epg_index_title_find
+  ( const char *str, int regex, uint32_t **ids, uint32_t *count );
+
+void epg_index_init ( void );
+void epg_index_done ( void );
+
 /* ************************************************************************
  * Setup/Shutdown
  * ***********************************************************************/
@@ -585,6 +631,8 @@ void epg_done    (void);
 void epg_skel_done (void);
 void epg_save    (void);
 void epg_save_callback (void *p);
+void epgdb_broadcast_changed ( epg_broadcast_t *ebc );
+void epgdb_broadcast_removed ( epg_broadcast_t *ebc );
 void epg_updated (void);
 
 #endif /* EPG_H */
@@ -0,0 +1,326 @@
+/*
+ *  Electronic Program Guide - title index
+ *  Copyright (C) 2026 Tvheadend
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "tvheadend.h"
+#include "channels.h"
+#include "epg.h"
+#include "memoryinfo.h"
+
+/*
+ * Trigram inverted index of the broadcast titles (all languages,
+ * ASCII letters folded to lower case). The posting lists hold the
+ * broadcast IDs. Entries are never removed from the lists, the stale
+ * ones (title changed, broadcast deleted) are filtered out by the
+ * caller which matches the title anyway. The whole index is rebuilt
+ * when the stale entries outnumber the live ones.
+ *
+ * At most EPG_INDEX_MAX_GRAMS trigrams are taken from a title (all
+ * languages together, about 1kB of text). The broadcasts with a longer
+ * title are also put to the EPG_INDEX_GRAM_LONG list which is returned
+ * with every query, so the text after the limit is still found. The
+ * trigrams of a longer query string are truncated the same way, the
+ * result is then a superset of the matches.
+ */
+
+#define EPG_INDEX_HASH      16384
+#define EPG_INDEX_MAX_GRAMS 1024
+#define EPG_INDEX_GRAM_LONG 0   /* no real trigram, the strings end with NUL */
+#define EPG_INDEX_MIN_STALE (256*1024)
+
+typedef struct epg_index_gram {
+  LIST_ENTRY(epg_index_gram) link;
+  uint32_t  gram;
+  uint32_t  count;
+  uint32_t  allocated;
+  uint32_t *ids;
+} epg_index_gram_t;
+
+static LIST_HEAD(, epg_index_gram) epg_index_hash[EPG_INDEX_HASH];
+static int64_t epg_index_live;
+static int64_t epg_index_stale;
+static int     epg_index_rebuild_pending;
+
+static memoryinfo_t epg_index_memoryinfo = {
+  .my_name = "EPG Title index",
+};
+
+/*
+ *
+ */
+static inline uint32_t
+_epg_index_hash ( uint32_t gram )
+{
+  return (gram * 2654435761U) >> 18;
+}
+
+static inline uint8_t
+_epg_index_fold ( uint8_t c )
+{
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static int
+_epg_index_gram_cmp ( const void *a, const void *b )
+{
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+/*
+ * Collect the trigrams of the string (up to 'max'), return the new count,
+ * 'truncated' is set when some trigrams did not fit
+ */
+static int
+_epg_index_grams
+  ( const char *str, uint32_t *grams, int count, int max, int *truncated )
+{
+  const uint8_t *s = (const uint8_t *)str;
+  uint32_t g;
+
+  if (s[0] == '\0' || s[1] == '\0')
+    return count;
+  g = (_epg_index_fold(s[0]) << 8) | _epg_index_fold(s[1]);
+  for (s += 2; *s && count < max; s++) {
+    g = ((g << 8) | _epg_index_fold(*s)) & 0xffffff;
+    grams[count++] = g;
+  }
+  if (*s)
+    *truncated = 1;
+  return count;
+}
+
+static int
+_epg_index_title_grams ( epg_broadcast_t *ebc, uint32_t *grams )
+{
+  lang_str_ele_t *ls;
+  int i, j, count = 0, truncated = 0;
+
+  if (ebc->title) {
+    RB_FOREACH(ls, ebc->title, link) {
+      /* keep one slot for EPG_INDEX_GRAM_LONG */
+      count = _epg_index_grams(ls->str, grams, count,
+                               EPG_INDEX_MAX_GRAMS - 1, &truncated);
+    }
+  }
+  if (truncated)
+    grams[count++] = EPG_INDEX_GRAM_LONG;
+  if (count < 2)
+    return count;
+  qsort(grams, count, sizeof(uint32_t), _epg_index_gram_cmp);
+  for (i = j = 1; i < count; i++)
+    if (grams[i] != grams[j-1])
+      grams[j++] = grams[i];
+  return j;
+}
+
+static epg_index_gram_t *
+_epg_index_find ( uint32_t gram, int create )
+{
+  epg_index_gram_t *ig;
+  uint32_t h = _epg_index_hash(gram);
+
+  LIST_FOREACH(ig, &epg_index_hash[h], link)
+    if (ig->gram == gram)
+      return ig;
+  if (!create)
+    return NULL;
+  ig = calloc(1, sizeof(*ig));
+  ig->gram = gram;
+  LIST_INSERT_HEAD(&epg_index_hash[h], ig, link);
+  memoryinfo_alloc(&epg_index_memoryinfo, sizeof(*ig));
+  return ig;
+}
+
+static void
+_epg_index_add ( epg_broadcast_t *ebc )
+{
+  epg_index_gram_t *ig;
+  uint32_t grams[EPG_INDEX_MAX_GRAMS];
+  int i, count;
+
+  count = _epg_index_title_grams(ebc, grams);
+  for (i = 0; i < count; i++) {
+    ig = _epg_index_find(grams[i], 1);
+    if (ig->count == ig->allocated) {
+      memoryinfo_remove(&epg_index_memoryinfo, ig->allocated * sizeof(uint32_t));
+      ig->allocated = MAX(4, ig->allocated * 2);
+      ig->ids = realloc(ig->ids, ig->allocated * sizeof(uint32_t));
+      memoryinfo_append(&epg_index_memoryinfo, ig->allocated * sizeof(uint32_t));
+    }
+    ig->ids[ig->count++] = ebc->id;
+  }
+  ebc->idx_title = 1;
+  ebc->idx_grams = count;
+  epg_index_live += count;
+}
+
+static void
+_epg_index_clear ( void )
+{
+  epg_index_gram_t *ig;
+  int i;
+
+  for (i = 0; i < EPG_INDEX_HASH; i++)
+    while ((ig = LIST_FIRST(&epg_index_hash[i])) != NULL) {
+      LIST_REMOVE(ig, link);
+      free(ig->ids);
+      free(ig);
+    }
+  memoryinfo_update(&epg_index_memoryinfo, 0, 0);
+  epg_index_live = epg_index_stale = 0;
+}
+
+static void
+_epg_index_rebuild ( void )
+{
+  channel_t *ch;
+  epg_broadcast_t *ebc;
+
+  _epg_index_clear();
+  CHANNEL_FOREACH(ch)
+    RB_FOREACH(ebc, &ch->ch_epg_schedule, sched_link)
+      if (ebc->idx_title)
+        _epg_index_add(ebc);
+  epg_index_rebuild_pending = 0;
+  tvhtrace(LS_EPG, "title index rebuilt (%"PRId64" entries)", epg_index_live);
+}
+
+static void
+_epg_index_drop ( epg_broadcast_t *ebc )
+{
+  epg_index_live  -= ebc->idx_grams;
+  epg_index_stale += ebc->idx_grams;
+  ebc->idx_grams = 0;
+  if (epg_index_stale > EPG_INDEX_MIN_STALE &&
+      epg_index_stale > epg_index_live)
+    epg_index_rebuild_pending = 1;
+}
+
+/* **************************************************************************
+ * Public
+ * *************************************************************************/
+
+/*
+ * The broadcast title was changed, the old trigrams are left stale
+ */
+void
+epg_index_title_update ( epg_broadcast_t *ebc )
+{
+  if (ebc->id == 0)
+    return;
+  if (ebc->idx_title)
+    _epg_index_drop(ebc);
+  _epg_index_add(ebc);
+}
+
+/*
+ * The broadcast is being destroyed
+ */
+void
+epg_index_title_remove ( epg_broadcast_t *ebc )
+{
+  if (ebc->idx_title) {
+    _epg_index_drop(ebc);
+    ebc->idx_title = 0;
+  }
+}
+
+/*
+ * Return the IDs of broadcasts which may have 'str' in the title
+ * (sorted, unique, possibly stale). The string is matched caseless
+ * for the ASCII letters. If 'regex' is set, the string must not
+ * contain the regular expression meta characters. Returns -1 when
+ * the index cannot answer the query.
+ */
+int
+epg_index_title_find
+  ( const char *str, int regex, uint32_t **ids, uint32_t *count )
+{
+  epg_index_gram_t *ig, *best = NULL, *tlong;
+  uint32_t grams[EPG_INDEX_MAX_GRAMS], *r, total;
+  const char *s;
+  int i, n, truncated = 0;
+
+  lock_assert(&global_lock);
+
+  if (str == NULL || strlen(str) < 3)
+    return -1;
+  for (s = str; *s; s++) {
+    if ((uint8_t)*s >= 0x80)
+      return -1;
+    if (regex && strchr(".^$*+?()[]{}|\\", *s))
+      return -1;
+  }
+
+  if (epg_index_rebuild_pending)
+    _epg_index_rebuild();
+
+  n = _epg_index_grams(str, grams, 0, EPG_INDEX_MAX_GRAMS, &truncated);
+  for (i = 0; i < n; i++) {
+    ig = _epg_index_find(grams[i], 0);
+    if (ig == NULL) {
+      best = NULL;
+      break;
+    }
+    if (best == NULL || ig->count < best->count)
+      best = ig;
+  }
+
+  /* the long titles are not fully indexed */
+  tlong = _epg_index_find(EPG_INDEX_GRAM_LONG, 0);
+
+  *ids = NULL;
+  *count = 0;
+  total = (best ? best->count : 0) + (tlong ? tlong->count : 0);
+  if (total == 0)
+    return 0;
+
+  r = malloc(total * sizeof(uint32_t));
+  n = 0;
+  if (best) {
+    memcpy(r, best->ids, best->count * sizeof(uint32_t));
+    n = best->count;
+  }
+  if (tlong && tlong != best)
+    memcpy(r + n, tlong->ids, tlong->count * sizeof(uint32_t));
+  else
+    total = n;
+  qsort(r, total, sizeof(uint32_t), _epg_index_gram_cmp);
+  for (i = n = 1; i < total; i++)
+    if (r[i] != r[n-1])
+      r[n++] = r[i];
+  *ids = r;
+  *count = n;
+  return 0;
+}
+
+void
+epg_index_init ( void )
+{
+  memoryinfo_register(&epg_index_memoryinfo);
+}
+
+void
+epg_index_done ( void )
+{
+  _epg_index_clear();
+  memoryinfo_unregister(&epg_index_memoryinfo);
+}
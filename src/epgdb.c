@@ -34,24 +34,99 @@
 #include "epggrab.h"
 #include "config.h"
 #include "memoryinfo.h"
+#include "lang_codes.h"
 
 #define EPG_DB_VERSION 3
 #define EPG_DB_ALLOC_STEP (1024*1024)
 
+/*
+ * The database is a full snapshot (epgdb.v3) followed by a journal
+ * (epgdb.v3.log) with the changed and removed broadcasts appended on
+ * each save. Each journal record starts with the config section which
+ * carries the snapshot generation; records from another generation are
+ * ignored. The snapshot is rewritten (and the journal truncated) when
+ * the journal grows over the half of the snapshot size.
+ */
+#define EPG_DB_JOURNAL_MIN (1024*1024)
+
+typedef struct epgdb_save {
+  sbuf_t sb;
+  int    journal;
+} epgdb_save_t;
+
 extern epg_object_tree_t epg_episodes;
 
+static LIST_HEAD(, epg_broadcast) epgdb_dirty;
+static uint32_t *epgdb_removed;
+static int       epgdb_removed_count;
+static int       epgdb_removed_size;
+static int       epgdb_track;
+static uint32_t  epgdb_jgen;
+static int64_t   epgdb_snapshot_size;
+static int64_t   epgdb_journal_size;
+static int       epgdb_snapshot_valid;
+
+/* **************************************************************************
+ * Change tracking
+ * *************************************************************************/
+
+void epgdb_broadcast_changed ( epg_broadcast_t *ebc )
+{
+  if (!epgdb_track || ebc->db_dirty)
+    return;
+  LIST_INSERT_HEAD(&epgdb_dirty, ebc, db_link);
+  ebc->db_dirty = 1;
+}
+
+void epgdb_broadcast_removed ( epg_broadcast_t *ebc )
+{
+  int stored = ebc->db_stored;
+
+  /* The broadcast may stay referenced, never track it again */
+  if (ebc->db_dirty == 1)
+    LIST_REMOVE(ebc, db_link);
+  ebc->db_dirty = 2;
+  ebc->db_stored = 0;
+  if (!epgdb_track || !stored)
+    return;
+  if (epgdb_removed_count == epgdb_removed_size) {
+    epgdb_removed_size = MAX(1024, epgdb_removed_size * 2);
+    epgdb_removed = realloc(epgdb_removed, epgdb_removed_size * sizeof(uint32_t));
+  }
+  epgdb_removed[epgdb_removed_count++] = ebc->id;
+}
+
+static void epgdb_changes_clear ( void )
+{
+  epg_broadcast_t *ebc;
+
+  while ((ebc = LIST_FIRST(&epgdb_dirty)) != NULL) {
+    LIST_REMOVE(ebc, db_link);
+    ebc->db_dirty = 0;
+  }
+  free(epgdb_removed);
+  epgdb_removed = NULL;
+  epgdb_removed_count = epgdb_removed_size = 0;
+}
+
 /* **************************************************************************
  * Load
  * *************************************************************************/
 
 /*
- * Process v3 data
+ * Process v3 data, returns -1 when the journal does not belong
+ * to the loaded snapshot
  */
-static void
-_epgdb_v3_process( char **sect, htsmsg_t *m, epggrab_stats_t *stats )
+static int
+_epgdb_v3_process( char **sect, htsmsg_t *m, epg_broadcast_prep_t *prep,
+                   int journal, epggrab_stats_t *stats )
 {
   int save = 0;
   const char *s;
+  uint32_t u32;
+  epg_broadcast_t *ebc;
+  htsmsg_t *l;
+  htsmsg_field_t *f;
 
   /* New section */
   if ( (s = htsmsg_get_str(m, "__section__")) ) {
@@ -60,10 +135,34 @@ _epgdb_v3_process( char **sect, htsmsg_t *m, epggrab_stats_t *stats )
   
   /* Broadcasts */
   } else if ( !strcmp(*sect, "broadcasts") ) {
-    if (epg_broadcast_deserialize(m, 1, &save)) stats->broadcasts.total++;
+    /* The journal holds the complete broadcast, replace the old one */
+    if (journal && !htsmsg_get_u32(m, "id", &u32) &&
+        (ebc = epg_broadcast_find_by_id(u32)) != NULL)
+      epg_broadcast_remove(ebc);
+    if (prep && prep->ready)
+      ebc = epg_broadcast_deserialize_prep(m, prep, 1, &save);
+    else
+      ebc = epg_broadcast_deserialize(m, 1, &save);
+    if (ebc != NULL) {
+      ebc->db_stored = 1;
+      stats->broadcasts.total++;
+    }
+
+  /* Removed broadcasts (journal) */
+  } else if ( !strcmp(*sect, "removed") ) {
+    if ((l = htsmsg_get_list(m, "ids")) != NULL)
+      HTSMSG_FOREACH(f, l)
+        if (!htsmsg_field_get_u32(f, &u32) &&
+            (ebc = epg_broadcast_find_by_id(u32)) != NULL)
+          epg_broadcast_remove(ebc);
 
   /* Global config */
   } else if ( !strcmp(*sect, "config") ) {
+    if (htsmsg_get_u32(m, "jgen", &u32))
+      u32 = 0;
+    if (journal && u32 != epgdb_jgen)
+      return -1;
+    epgdb_jgen = u32;
     if (epg_config_deserialize(m)) stats->config.total++;
 
   /* Unknown */
@@ -71,6 +170,7 @@ _epgdb_v3_process( char **sect, htsmsg_t *m, epggrab_stats_t *stats )
     tvhdebug(LS_EPGDB, "malformed database section [%s]", *sect);
     //htsmsg_print(m);
   }
+  return 0;
 }
 
 /*
@@ -115,64 +215,285 @@ static void epg_mmap_sigbus (int sig, siginfo_t *siginfo, void *ptr)
 }
 
 /*
- * Load data
+ * Parallel decoder
+ *
+ * The message boundaries are found first (only the length prefixes are
+ * read). The worker threads then decode the chunks of messages to
+ * htsmsg and build the broadcast strings, genres and lists, while the
+ * calling thread links the decoded chunks to the EPG in the file order
+ * (the snapshot is already grouped per channel and sorted by the start
+ * time). The workers do not get more than
+ * EPG_DB_LOAD_AHEAD chunks ahead of the linking to limit the memory.
+ * Without the worker threads, the messages are decoded and linked
+ * one by one as before.
  */
-void epg_init ( void )
+#define EPG_DB_LOAD_CHUNK   512
+#define EPG_DB_LOAD_AHEAD   64
+#define EPG_DB_LOAD_THREADS 8
+#define EPG_DB_LOAD_MIN     (4*EPG_DB_LOAD_CHUNK)
+
+typedef struct epgdb_load {
+  const uint8_t *data;
+  size_t        *offs;      /* message offsets, count + 1 entries */
+  htsmsg_t     **msgs;
+  epg_broadcast_prep_t *preps;
+  int           *bad;       /* first invalid message in chunk or -1 */
+  uint8_t       *decoded;
+  int            count;
+  int            chunks;
+  int            next;      /* next chunk to decode */
+  int            linked;    /* linked chunks */
+  int            stop;
+  tvh_mutex_t    lock;
+  tvh_cond_t     cond;
+} epgdb_load_t;
+
+static void
+_epgdb_load_decode ( epgdb_load_t *el, int c )
 {
-  int fd = -1, r;
-  struct stat st;
-  size_t remain;
-  uint8_t *mem, *rp, *zlib_mem = NULL;
-  epggrab_stats_t stats;
-  int ver = EPG_DB_VERSION;
-  struct sigaction act, oldact;
-  char *sect = NULL;
+  int i = c * EPG_DB_LOAD_CHUNK;
+  int last = MIN(el->count, i + EPG_DB_LOAD_CHUNK);
+  size_t msglen;
+  htsmsg_t *m;
+
+  el->bad[c] = -1;
+  for ( ; i < last; i++) {
+    msglen = el->offs[i+1] - el->offs[i];
+    if (htsmsg_binary2_deserialize(&el->msgs[i], el->data + el->offs[i],
+                                   &msglen, NULL)) {
+      el->bad[c] = i;
+      break;
+    }
+    /* Broadcast record (the section is known only when linking) */
+    m = el->msgs[i];
+    if (el->preps && m && htsmsg_get_str(m, "__section__") == NULL &&
+        htsmsg_get_str(m, "ch") && htsmsg_field_find(m, "start"))
+      epg_broadcast_prep(&el->preps[i], m);
+  }
+}
 
-  memoryinfo_register(&epg_memoryinfo_broadcasts);
+static void
+_epgdb_load_free ( epgdb_load_t *el, int c )
+{
+  int i = c * EPG_DB_LOAD_CHUNK;
+  int last = MIN(el->count, i + EPG_DB_LOAD_CHUNK);
+
+  for ( ; i < last; i++) {
+    if (el->msgs[i])
+      htsmsg_destroy(el->msgs[i]);
+    if (el->preps)
+      epg_broadcast_prep_done(&el->preps[i]);
+  }
+}
 
-  /* Find the right file (and version) */
-  while (fd < 0 && ver > 0) {
-    fd = hts_settings_open_file(0, "epgdb.v%d", ver);
-    if (fd > 0) break;
-    ver--;
+static void *
+_epgdb_load_thread ( void *aux )
+{
+  epgdb_load_t *el = aux;
+  int c;
+
+  tvh_mutex_lock(&el->lock);
+  while (!el->stop && el->next < el->chunks) {
+    if (el->next >= el->linked + EPG_DB_LOAD_AHEAD) {
+      tvh_cond_wait(&el->cond, &el->lock);
+      continue;
+    }
+    c = el->next++;
+    tvh_mutex_unlock(&el->lock);
+    _epgdb_load_decode(el, c);
+    tvh_mutex_lock(&el->lock);
+    el->decoded[c] = 1;
+    tvh_cond_signal(&el->cond, 1);
   }
-  if ( fd < 0 )
-    fd = hts_settings_open_file(0, "epgdb");
-  if ( fd < 0 ) {
-    tvhdebug(LS_EPGDB, "database does not exist");
-    return;
+  tvh_mutex_unlock(&el->lock);
+  return NULL;
+}
+
+/*
+ * Find the message boundaries, the pages are touched here,
+ * so the SIGBUS (truncated file) is raised in this thread
+ */
+static int
+_epgdb_load_scan ( epgdb_load_t *el, const uint8_t *rp, size_t remain )
+{
+  size_t pos = 0, msglen, size = 0, p;
+  volatile uint8_t touch;
+
+  el->count = 0;
+  while (remain - pos > 4) {
+    if (htsmsg_binary2_message_size(rp + pos, remain - pos, &msglen))
+      break;
+    for (p = 4096; p < msglen; p += 4096)
+      touch = rp[pos + p];
+    if (el->count + 1 >= size) {
+      size = MAX(1024, size * 2);
+      el->offs = realloc(el->offs, size * sizeof(size_t));
+    }
+    el->offs[el->count++] = pos;
+    pos += msglen;
   }
+  (void)touch;
+  if (el->offs == NULL)
+    el->offs = malloc(sizeof(size_t));
+  el->offs[el->count] = pos;
+  return pos < remain && remain - pos > 4;
+}
 
-  memset (&act, 0, sizeof(act));
-  act.sa_sigaction = epg_mmap_sigbus;
-  act.sa_flags = SA_SIGINFO;
-  if (sigaction(SIGBUS, &act, &oldact)) {
-    tvherror(LS_EPGDB, "failed to install SIGBUS handler");
-    close(fd);
-    return;
+/*
+ * Process the messages, returns the size of the valid data
+ */
+static size_t
+_epgdb_parse ( uint8_t *rp, size_t remain, int ver, int journal,
+               epggrab_stats_t *stats )
+{
+  epgdb_load_t el;
+  pthread_t tids[EPG_DB_LOAD_THREADS];
+  int64_t mono, mono_scan, mono_link = 0, t;
+  int i, c, last, r = 0, threads = 0, corrupt;
+  size_t done;
+  char *sect = NULL;
+
+  memset(&el, 0, sizeof(el));
+  el.data = rp;
+  mono = getmonoclock();
+  corrupt = _epgdb_load_scan(&el, rp, remain);
+  mono_scan = getmonoclock() - mono;
+  done = el.offs[el.count];
+  el.chunks = (el.count + EPG_DB_LOAD_CHUNK - 1) / EPG_DB_LOAD_CHUNK;
+  el.msgs = calloc(MAX(1, el.count), sizeof(htsmsg_t *));
+  el.bad = calloc(MAX(1, el.chunks), sizeof(int));
+  el.decoded = calloc(MAX(1, el.chunks), 1);
+  tvh_mutex_init(&el.lock, NULL);
+  tvh_cond_init(&el.cond, 1);
+
+  if (el.count >= EPG_DB_LOAD_MIN)
+    threads = MAX(0, MIN(EPG_DB_LOAD_THREADS,
+                         sysconf(_SC_NPROCESSORS_ONLN) - 1));
+  if (threads > 0) {
+    /* The broadcasts are prepared only by the decoder threads */
+    el.preps = calloc(el.count, sizeof(epg_broadcast_prep_t));
+    /* Initialize the language tables before the threads use them */
+    lang_code_get("und");
+    for (i = 0; i < threads; i++)
+      tvh_thread_create(&tids[i], NULL, _epgdb_load_thread, &el, "epgdbload");
   }
-  
+
+  for (c = 0; c < el.chunks && !r; c++) {
+
+    /* Wait for the decoded chunk (or decode it here) */
+    if (threads) {
+      tvh_mutex_lock(&el.lock);
+      while (!el.decoded[c])
+        tvh_cond_wait(&el.cond, &el.lock);
+      tvh_mutex_unlock(&el.lock);
+    } else {
+      _epgdb_load_decode(&el, c);
+    }
+
+    /* Link */
+    t = getmonoclock();
+    i = c * EPG_DB_LOAD_CHUNK;
+    last = el.bad[c] >= 0 ? el.bad[c] : MIN(el.count, i + EPG_DB_LOAD_CHUNK);
+    for ( ; i < last; i++) {
+      if (el.msgs[i] == NULL) continue;
+      if (ver == 3)
+        r = _epgdb_v3_process(&sect, el.msgs[i],
+                              el.preps ? &el.preps[i] : NULL, journal, stats);
+      if (r) {
+        tvhinfo(LS_EPGDB, "journal does not match the database, ignored");
+        break;
+      }
+    }
+    if (el.bad[c] >= 0 && !r) {
+      tvherror(LS_EPGDB, "corruption detected, some/all data lost");
+      r = 1;
+      corrupt = 0;
+    }
+    if (r)
+      done = el.offs[i];
+    _epgdb_load_free(&el, c);
+    mono_link += getmonoclock() - t;
+
+    if (threads) {
+      tvh_mutex_lock(&el.lock);
+      el.linked = c + 1;
+      tvh_cond_signal(&el.cond, 1);
+      tvh_mutex_unlock(&el.lock);
+    }
+  }
+
+  /* Cleanup (the decoded chunks after an error) */
+  if (threads) {
+    tvh_mutex_lock(&el.lock);
+    el.stop = 1;
+    tvh_cond_signal(&el.cond, 1);
+    tvh_mutex_unlock(&el.lock);
+    for (i = 0; i < threads; i++)
+      pthread_join(tids[i], NULL);
+  }
+  for ( ; c < el.chunks; c++) {
+    if (el.decoded[c])
+      _epgdb_load_free(&el, c);
+  }
+  if (corrupt)
+    tvherror(LS_EPGDB, "corruption detected, some/all data lost");
+
+  mono = getmonoclock() - mono;
+  tvhinfo(LS_EPGDB, "%s%d records in %"PRId64"ms (scan %"PRId64"ms, "
+                    "link %"PRId64"ms, %d decoder threads)",
+                    journal ? "journal: " : "", el.count, mono / 1000,
+                    mono_scan / 1000, mono_link / 1000, threads);
+
+  tvh_cond_destroy(&el.cond);
+  tvh_mutex_destroy(&el.lock);
+  free(el.decoded);
+  free(el.bad);
+  free(el.preps);
+  free(el.msgs);
+  free(el.offs);
+  free(sect);
+  return done;
+}
+
+/*
+ * Map and process the file, returns the size of the valid data
+ * or -1 on error, 'size' is set to the (inflated) data size
+ */
+static ssize_t
+_epgdb_load ( int fd, int ver, int journal, epggrab_stats_t *stats,
+              size_t *size )
+{
+  struct stat st;
+  size_t remain;
+  ssize_t done;
+  uint8_t *mem, *rp, *zlib_mem = NULL;
+#if ENABLE_ZLIB
+  int64_t mono;
+#endif
+
+  *size = 0;
+
   /* Map file to memory */
   if ( fstat(fd, &st) != 0 ) {
     tvherror(LS_EPGDB, "failed to detect database size");
-    goto end;
+    return -1;
   }
   if ( !st.st_size ) {
-    tvhdebug(LS_EPGDB, "database is empty");
-    goto end;
+    tvhdebug(LS_EPGDB, "database%s is empty", journal ? " journal" : "");
+    return 0;
   }
   remain   = st.st_size;
   rp = mem = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
   if ( mem == MAP_FAILED ) {
     tvherror(LS_EPGDB, "failed to mmap database");
-    goto end;
+    return -1;
   }
 
   if (sigsetjmp(epg_mmap_env, 1)) {
     tvherror(LS_EPGDB, "failed to read from mapped file");
     if (mem)
       munmap(mem, st.st_size);
-    goto end;
+    return -1;
   }
 
 #if ENABLE_ZLIB
@@ -181,49 +502,109 @@ void epg_init ( void )
     uint32_t orig = (rp[8] << 24) | (rp[9] << 16) | (rp[10] << 8) | rp[11];
     tvhinfo(LS_EPGDB, "gzip format detected, inflating (ratio %.1f%% deflated size %zd)",
             ((remain * 100.0) / orig), remain);
+    mono = getmonoclock();
     rp = zlib_mem = tvh_gzip_inflate(rp + 12, remain - 12, orig);
     remain = rp ? orig : 0;
+    tvhinfo(LS_EPGDB, "inflated in %"PRId64"ms", (getmonoclock() - mono) / 1000);
   }
 #endif
 
-  tvhinfo(LS_EPGDB, "parsing %zd bytes", remain);
+  tvhinfo(LS_EPGDB, "parsing %zd bytes%s", remain, journal ? " (journal)" : "");
 
   /* Process */
-  memset(&stats, 0, sizeof(stats));
-  while ( remain > 4 ) {
+  *size = remain;
+  done = _epgdb_parse(rp, remain, ver, journal, stats);
 
-    /* Get message length */
-    size_t msglen = remain;
-    htsmsg_t *m;
-    r = htsmsg_binary2_deserialize(&m, rp, &msglen, NULL);
+  /* Close file */
+  munmap(mem, st.st_size);
+  free(zlib_mem);
+  return done;
+}
 
-    /* Safety check */
-    if (r) {
-      tvherror(LS_EPGDB, "corruption detected, some/all data lost");
-      break;
+/*
+ * Replay the journal, drop the invalid tail
+ */
+static void
+_epgdb_load_journal ( epggrab_stats_t *stats )
+{
+  char path[PATH_MAX];
+  ssize_t r = 0;
+  size_t size;
+  int fd;
+
+  if (hts_settings_buildpath(path, sizeof(path), "epgdb.v%d.log", EPG_DB_VERSION))
+    return;
+  fd = tvh_open(path, O_RDWR, 0);
+  if (fd < 0)
+    return;
+  if (epgdb_snapshot_valid) {
+    r = _epgdb_load(fd, EPG_DB_VERSION, 1, stats, &size);
+    if (r < 0) {
+      epgdb_snapshot_valid = 0;
+      r = 0;
+    } else if (r == size) {
+      epgdb_journal_size = r;
+      close(fd);
+      return;
     }
+  }
+  tvhwarn(LS_EPGDB, "journal truncated to %zd bytes", r);
+  if (ftruncate(fd, r)) {
+    tvherror(LS_EPGDB, "unable to truncate journal %s", path);
+    epgdb_snapshot_valid = 0;
+  }
+  epgdb_journal_size = r;
+  close(fd);
+}
 
-    /* Next */
-    rp     += msglen;
-    remain -= msglen;
+/*
+ * Load data
+ */
+void epg_init ( void )
+{
+  int fd = -1;
+  ssize_t r;
+  size_t size;
+  int64_t mono = getmonoclock();
+  epggrab_stats_t stats;
+  int ver = EPG_DB_VERSION;
+  struct sigaction act, oldact;
 
-    /* Skip */
-    if (!m) continue;
+  memoryinfo_register(&epg_memoryinfo_broadcasts);
+  epg_index_init();
 
-    /* Process */
-    switch (ver) {
-      case 3:
-        _epgdb_v3_process(&sect, m, &stats);
-        break;
-      default:
-        break;
-    }
+  /* Find the right file (and version) */
+  while (fd < 0 && ver > 0) {
+    fd = hts_settings_open_file(0, "epgdb.v%d", ver);
+    if (fd > 0) break;
+    ver--;
+  }
+  if ( fd < 0 )
+    fd = hts_settings_open_file(0, "epgdb");
+  if ( fd < 0 ) {
+    tvhdebug(LS_EPGDB, "database does not exist");
+    goto done;
+  }
 
-    /* Cleanup */
-    htsmsg_destroy(m);
+  memset (&act, 0, sizeof(act));
+  act.sa_sigaction = epg_mmap_sigbus;
+  act.sa_flags = SA_SIGINFO;
+  if (sigaction(SIGBUS, &act, &oldact)) {
+    tvherror(LS_EPGDB, "failed to install SIGBUS handler");
+    close(fd);
+    goto done;
   }
 
-  free(sect);
+  memset(&stats, 0, sizeof(stats));
+  r = _epgdb_load(fd, ver, 0, &stats, &size);
+  close(fd);
+  if (r < 0)
+    goto end;
+  if (r == size && ver == EPG_DB_VERSION && stats.config.total) {
+    epgdb_snapshot_valid = 1;
+    epgdb_snapshot_size = size;
+    _epgdb_load_journal(&stats);
+  }
 
   if (!stats.config.total) {
     htsmsg_t *m = htsmsg_create_map();
@@ -238,13 +619,12 @@ void epg_init ( void )
   tvhinfo(LS_EPGDB, "loaded v%d", ver);
   tvhinfo(LS_EPGDB, "  config     %d", stats.config.total);
   tvhinfo(LS_EPGDB, "  broadcasts %d", stats.broadcasts.total);
+  tvhinfo(LS_EPGDB, "  time       %"PRId64"ms", (getmonoclock() - mono) / 1000);
 
-  /* Close file */
-  munmap(mem, st.st_size);
-  free(zlib_mem);
 end:
   sigaction(SIGBUS, &oldact, NULL);
-  close(fd);
+done:
+  epgdb_track = 1;
 }
 
 void epg_done ( void )
@@ -252,9 +632,12 @@ void epg_done ( void )
   channel_t *ch;
 
   tvh_mutex_lock(&global_lock);
+  epgdb_track = 0;
   CHANNEL_FOREACH(ch)
     epg_channel_unlink(ch);
+  epgdb_changes_clear();
   epg_skel_done();
+  epg_index_done();
   memoryinfo_unregister(&epg_memoryinfo_broadcasts);
   tvh_mutex_unlock(&global_lock);
 }
@@ -293,14 +676,53 @@ static int _epg_write_sect ( sbuf_t *sb, const char *sect )
   return _epg_write(sb, m);
 }
 
+static int _epg_write_config ( sbuf_t *sb )
+{
+  htsmsg_t *m = epg_config_serialize();
+  htsmsg_add_u32(m, "jgen", epgdb_jgen);
+  if (_epg_write_sect(sb, "config")) return 1;
+  return _epg_write(sb, m);
+}
+
+static void epg_save_journal ( epgdb_save_t *es )
+{
+  char path[PATH_MAX];
+  int fd, r;
+
+  if (hts_settings_buildpath(path, sizeof(path), "epgdb.v%d.log", EPG_DB_VERSION)) {
+    tvhinfo(LS_EPGDB, "No config dir, not saving EPG");
+    return;
+  }
+  fd = tvh_open(path, O_CREAT | O_APPEND | O_WRONLY, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    tvherror(LS_EPGDB, "unable to open epgdb journal");
+    atomic_set(&epgdb_snapshot_valid, 0);
+    return;
+  }
+  r = tvh_write(fd, es->sb.sb_data, es->sb.sb_ptr);
+  close(fd);
+  if (r) {
+    tvherror(LS_EPGDB, "journal write error (size %d)", es->sb.sb_ptr);
+    atomic_set(&epgdb_snapshot_valid, 0);
+  } else {
+    tvhinfo(LS_EPGDB, "journal stored (size %d)", es->sb.sb_ptr);
+  }
+}
+
 static void epg_save_tsk_callback ( void *p, int dearmed )
 {
   char tmppath[PATH_MAX+4];
   char path[PATH_MAX];
-  sbuf_t *sb = p;
+  epgdb_save_t *es = p;
+  sbuf_t *sb = &es->sb;
   size_t size = sb->sb_ptr, orig;
   int fd, r;
 
+  if (es->journal) {
+    epg_save_journal(es);
+    goto done;
+  }
+
   tvhinfo(LS_EPGDB, "save start");
   if(hts_settings_buildpath(tmppath, sizeof(tmppath), "epgdb.v%d", EPG_DB_VERSION)) {
     tvhinfo(LS_EPGDB, "No config dir, not saving EPG");
@@ -312,12 +734,14 @@ static void epg_save_tsk_callback ( void *p, int dearmed )
   snprintf(tmppath, sizeof(tmppath), "%s.tmp", path);
   if (hts_settings_makedirs(tmppath)) {
     tvherror(LS_EPGDB, "Failed to create tmp directories for %s", tmppath);
+    atomic_set(&epgdb_snapshot_valid, 0);
     goto done;
   }
 
   fd = tvh_open(tmppath, O_CREAT | O_TRUNC | O_WRONLY, S_IRUSR | S_IWUSR);
   if (fd < 0) {
     tvherror(LS_EPGDB, "unable to open epgdb file");
+    atomic_set(&epgdb_snapshot_valid, 0);
     goto done;
   }
   
@@ -333,15 +757,21 @@ static void epg_save_tsk_callback ( void *p, int dearmed )
     tvherror(LS_EPGDB, "write error (size %zd)", orig);
     if (remove(tmppath))
       tvherror(LS_EPGDB, "unable to remove file %s", tmppath);
+    atomic_set(&epgdb_snapshot_valid, 0);
   } else {
     tvhinfo(LS_EPGDB, "stored (size %zd)", orig);
-    if (rename(tmppath, path))
+    if (rename(tmppath, path)) {
       tvherror(LS_EPGDB, "unable to rename file %s to %s", tmppath, path);
+      atomic_set(&epgdb_snapshot_valid, 0);
+    } else {
+      /* The journal belongs to the previous generation */
+      hts_settings_remove("epgdb.v%d.log", EPG_DB_VERSION);
+    }
   }
 
 done:
   sbuf_free(sb);
-  free(sb);
+  free(es);
 }
 
 void epg_save_callback ( void *p )
@@ -349,48 +779,114 @@ void epg_save_callback ( void *p )
   epg_save();
 }
 
-void epg_save ( void )
+/*
+ * Write the whole EPG
+ */
+static int epg_save_snapshot ( sbuf_t *sb, epggrab_stats_t *stats )
 {
-  sbuf_t *sb = malloc(sizeof(*sb));
   epg_broadcast_t *ebc;
   channel_t *ch;
+
+  epgdb_jgen++;
+  if (_epg_write_config(sb)) return 1;
+  if ( _epg_write_sect(sb, "broadcasts") ) return 1;
+  CHANNEL_FOREACH(ch) {
+    if (ch->ch_epg_parent) continue;
+    RB_FOREACH(ebc, &ch->ch_epg_schedule, sched_link) {
+      if (_epg_write(sb, epg_broadcast_serialize(ebc))) return 1;
+      ebc->db_stored = 1;
+      stats->broadcasts.total++;
+    }
+  }
+  epgdb_snapshot_size = sb->sb_ptr;
+  epgdb_journal_size = 0;
+  return 0;
+}
+
+/*
+ * Append the changes since the last save
+ */
+static int epg_save_changes ( sbuf_t *sb, epggrab_stats_t *stats )
+{
+  epg_broadcast_t *ebc;
+  htsmsg_t *m, *l;
+  int i;
+
+  if (_epg_write_config(sb)) return 1;
+  if ( _epg_write_sect(sb, "broadcasts") ) return 1;
+  LIST_FOREACH(ebc, &epgdb_dirty, db_link) {
+    if (ebc->channel == NULL || ebc->channel->ch_epg_parent) continue;
+    if (_epg_write(sb, epg_broadcast_serialize(ebc))) return 1;
+    ebc->db_stored = 1;
+    stats->broadcasts.total++;
+  }
+  if (epgdb_removed_count > 0) {
+    if ( _epg_write_sect(sb, "removed") ) return 1;
+    m = htsmsg_create_map();
+    l = htsmsg_create_list();
+    for (i = 0; i < epgdb_removed_count; i++)
+      htsmsg_add_u32(l, NULL, epgdb_removed[i]);
+    htsmsg_add_msg(m, "ids", l);
+    if (_epg_write(sb, m)) return 1;
+  }
+  epgdb_journal_size += sb->sb_ptr;
+  return 0;
+}
+
+void epg_save ( void )
+{
+  epgdb_save_t *es = malloc(sizeof(*es));
   epggrab_stats_t stats;
   extern gtimer_t epggrab_save_timer;
+  int r, removed = epgdb_removed_count;
 
-  if (!sb)
+  if (!es)
     return;
 
-  tvhinfo(LS_EPGDB, "snapshot start");
-
-  sbuf_init_fixed(sb, EPG_DB_ALLOC_STEP);
-
   if (epggrab_conf.epgdb_periodicsave)
     gtimer_arm_rel(&epggrab_save_timer, epg_save_callback, NULL,
                    epggrab_conf.epgdb_periodicsave * 3600);
 
-  memset(&stats, 0, sizeof(stats));
-  if ( _epg_write_sect(sb, "config") ) goto error;
-  if (_epg_write(sb, epg_config_serialize())) goto error;
-  if ( _epg_write_sect(sb, "broadcasts") ) goto error;
-  CHANNEL_FOREACH(ch) {
-    if (ch->ch_epg_parent) continue;
-    RB_FOREACH(ebc, &ch->ch_epg_schedule, sched_link) {
-      if (_epg_write(sb, epg_broadcast_serialize(ebc))) goto error;
-      stats.broadcasts.total++;
-    }
+  /* Only the changes, until the journal is too big */
+  es->journal = atomic_get(&epgdb_snapshot_valid) &&
+                (epgdb_journal_size < EPG_DB_JOURNAL_MIN ||
+                 epgdb_journal_size < epgdb_snapshot_size / 2);
+
+  if (es->journal && LIST_EMPTY(&epgdb_dirty) && epgdb_removed_count == 0) {
+    tvhdebug(LS_EPGDB, "no changes to save");
+    free(es);
+    return;
   }
 
-  tasklet_arm_alloc(epg_save_tsk_callback, sb);
+  tvhinfo(LS_EPGDB, "%s start", es->journal ? "journal" : "snapshot");
+
+  sbuf_init_fixed(&es->sb, EPG_DB_ALLOC_STEP);
+
+  memset(&stats, 0, sizeof(stats));
+  if (es->journal)
+    r = epg_save_changes(&es->sb, &stats);
+  else
+    r = epg_save_snapshot(&es->sb, &stats);
+  if (r) goto error;
+  epgdb_changes_clear();
+  if (!es->journal)
+    atomic_set(&epgdb_snapshot_valid, 1);
+
+  tasklet_arm_alloc(epg_save_tsk_callback, es);
 
   /* Stats */
-  tvhinfo(LS_EPGDB, "queued to save (size %d)", sb->sb_ptr);
+  tvhinfo(LS_EPGDB, "queued to save (size %d)", es->sb.sb_ptr);
   tvhinfo(LS_EPGDB, "  broadcasts %d", stats.broadcasts.total);
+  if (es->journal)
+    tvhinfo(LS_EPGDB, "  removed    %d", removed);
 
   return;
 
 error:
   tvherror(LS_EPGDB, "failed to store epg to disk");
   hts_settings_remove("epgdb.v%d", EPG_DB_VERSION);
-  sbuf_free(sb);
-  free(sb);
+  hts_settings_remove("epgdb.v%d.log", EPG_DB_VERSION);
+  atomic_set(&epgdb_snapshot_valid, 0);
+  sbuf_free(&es->sb);
+  free(es);
 }
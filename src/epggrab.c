@@ -73,6 +73,12 @@ static void _epggrab_module_grab ( epggrab_module_int_t *mod )
   if (!mod->enabled)
     return;
 
+  /* Parse the grabber output as it arrives */
+  if (mod->stream && mod->grab == epggrab_module_grab_spawn) {
+    epggrab_module_grab_stream(mod);
+    return;
+  }
+
   /* Grab */
   tm1 = getfastmonoclock();
   data = mod->trans(mod, mod->grab(mod));
@@ -207,10 +207,19 @@ struct epggrab_module_int
   int                           xmltv_xpath_series_use_standard; ///< If the XPath node is not found, use the standard TVH routine.
   int                           xmltv_xpath_episode_use_standard; ///< If the XPath node is not found, use the standard TVH routine.
 
+  /* Last import timing (ms) */
+  int64_t                       import_read;     ///< Reading the grabber output
+  int64_t                       import_parse;    ///< XML parsing
+  int64_t                       import_prepare;  ///< Off-lock conversions
+  int64_t                       import_merge;    ///< Merging under global lock
+  int64_t                       import_lock_max; ///< Longest global lock hold
+  int64_t                       import_elements; ///< Imported elements
+
   /* Handle data */
   char*     (*grab)   ( void *mod );
   htsmsg_t* (*trans)  ( void *mod, char *data );
   int       (*parse)  ( void *mod, htsmsg_t *data, epggrab_stats_t *stat );
+  int       (*stream) ( void *mod, int fd, epggrab_stats_t *stat );
 };
 
 /*
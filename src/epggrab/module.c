@@ -190,6 +190,37 @@ const idclass_t epggrab_mod_class = {
   }
 };
 
+/*
+ * Timing of the last import, shared by the internal and external grabbers
+ */
+#define EPGGRAB_MOD_IMPORT_PROP(_id, _name, _desc, _field) { \
+      .type   = PT_S64, \
+      .id     = _id, \
+      .name   = _name, \
+      .desc   = _desc, \
+      .off    = offsetof(epggrab_module_int_t, _field), \
+      .opts   = PO_RDONLY | PO_NOSAVE | PO_EXPERT, \
+      .group  = 1 \
+    }
+
+#define EPGGRAB_MOD_IMPORT_PROPS \
+    EPGGRAB_MOD_IMPORT_PROP("import_read", N_("Last import: read (ms)"), \
+      N_("Time spent waiting for the grabber data."), import_read), \
+    EPGGRAB_MOD_IMPORT_PROP("import_parse", N_("Last import: parse (ms)"), \
+      N_("Time spent in the XML parser."), import_parse), \
+    EPGGRAB_MOD_IMPORT_PROP("import_prepare", N_("Last import: prepare (ms)"), \
+      N_("Time spent converting the programme data without the global lock."), \
+      import_prepare), \
+    EPGGRAB_MOD_IMPORT_PROP("import_merge", N_("Last import: merge (ms)"), \
+      N_("Time spent merging the data into the EPG under the global lock."), \
+      import_merge), \
+    EPGGRAB_MOD_IMPORT_PROP("import_lock_max", N_("Last import: longest lock (ms)"), \
+      N_("The longest single global lock hold during the merge."), \
+      import_lock_max), \
+    EPGGRAB_MOD_IMPORT_PROP("import_elements", N_("Last import: elements"), \
+      N_("Number of channel and programme elements imported."), \
+      import_elements)
+
 const idclass_t epggrab_mod_int_class = {
   .ic_super      = &epggrab_mod_class,
   .ic_class      = "epggrab_mod_int",
@@ -213,6 +244,7 @@ const idclass_t epggrab_mod_int_class = {
       .opts   = PO_ADVANCED,
       .group  = 1
     },
+    EPGGRAB_MOD_IMPORT_PROPS,
     {}
   }
 };
@@ -231,6 +263,7 @@ const idclass_t epggrab_mod_ext_class = {
       .opts   = PO_RDONLY | PO_NOSAVE,
       .group  = 1
     },
+    EPGGRAB_MOD_IMPORT_PROPS,
     {}
   }
 };
@@ -370,39 +403,27 @@ epggrab_module_t *epggrab_module_create
 }
 
 /*
- * Run the parse
+ * Report the parse results
  */
-void epggrab_module_parse( void *m, htsmsg_t *data )
+static void epggrab_module_parse_done
+  ( epggrab_module_int_t *mod, int save, epggrab_stats_t *stats )
 {
-  int64_t tm1, tm2;
-  int save = 0;
-  epggrab_stats_t stats;
-  epggrab_module_int_t *mod = m;
-
-  /* Parse */
-  memset(&stats, 0, sizeof(stats));
-  tm1 = getfastmonoclock();
-  save |= mod->parse(mod, data, &stats);
-  tm2 = getfastmonoclock();
-  htsmsg_destroy(data);
-
   /* Debug stats */
-  tvhinfo(mod->subsys, "%s: parse took %"PRId64" seconds", mod->id, mono2sec(tm2 - tm1));
   tvhinfo(mod->subsys, "%s:  channels   tot=%5d new=%5d mod=%5d",
-          mod->id, stats.channels.total, stats.channels.created,
-          stats.channels.modified);
+          mod->id, stats->channels.total, stats->channels.created,
+          stats->channels.modified);
   tvhinfo(mod->subsys, "%s:  brands     tot=%5d new=%5d mod=%5d",
-          mod->id, stats.brands.total, stats.brands.created,
-          stats.brands.modified);
+          mod->id, stats->brands.total, stats->brands.created,
+          stats->brands.modified);
   tvhinfo(mod->subsys, "%s:  seasons    tot=%5d new=%5d mod=%5d",
-          mod->id, stats.seasons.total, stats.seasons.created,
-          stats.seasons.modified);
+          mod->id, stats->seasons.total, stats->seasons.created,
+          stats->seasons.modified);
   tvhinfo(mod->subsys, "%s:  episodes   tot=%5d new=%5d mod=%5d",
-          mod->id, stats.episodes.total, stats.episodes.created,
-          stats.episodes.modified);
+          mod->id, stats->episodes.total, stats->episodes.created,
+          stats->episodes.modified);
   tvhinfo(mod->subsys, "%s:  broadcasts tot=%5d new=%5d mod=%5d",
-          mod->id, stats.broadcasts.total, stats.broadcasts.created,
-          stats.broadcasts.modified);
+          mod->id, stats->broadcasts.total, stats->broadcasts.created,
+          stats->broadcasts.modified);
 
   /* Now we've parsed, do we need to save? */
   if (save && epggrab_conf.epgdb_saveafterimport) {
@@ -424,6 +445,46 @@ void epggrab_module_parse( void *m, htsmsg_t *data )
   }
 }
 
+/*
+ * Run the parse
+ */
+void epggrab_module_parse( void *m, htsmsg_t *data )
+{
+  int64_t tm1, tm2;
+  int save = 0;
+  epggrab_stats_t stats;
+  epggrab_module_int_t *mod = m;
+
+  /* Parse */
+  memset(&stats, 0, sizeof(stats));
+  tm1 = getfastmonoclock();
+  save |= mod->parse(mod, data, &stats);
+  tm2 = getfastmonoclock();
+  htsmsg_destroy(data);
+
+  tvhinfo(mod->subsys, "%s: parse took %"PRId64" seconds", mod->id, mono2sec(tm2 - tm1));
+  epggrab_module_parse_done(mod, save, &stats);
+}
+
+/*
+ * Run the streaming parse (data are read from fd)
+ */
+void epggrab_module_stream( void *m, int fd )
+{
+  int64_t tm1, tm2;
+  int save;
+  epggrab_stats_t stats;
+  epggrab_module_int_t *mod = m;
+
+  memset(&stats, 0, sizeof(stats));
+  tm1 = getfastmonoclock();
+  save = mod->stream(mod, fd, &stats);
+  tm2 = getfastmonoclock();
+
+  tvhinfo(mod->subsys, "%s: grab and parse took %"PRId64" seconds", mod->id, mono2sec(tm2 - tm1));
+  epggrab_module_parse_done(mod, save, &stats);
+}
+
 /* **************************************************************************
  * Module channel routines
  * *************************************************************************/
@@ -471,6 +532,7 @@ epggrab_module_int_t *epggrab_module_int_create
     const char *path,
     char* (*grab) (void*m),
     int (*parse) (void *m, htsmsg_t *data, epggrab_stats_t *sta),
+    int (*stream) (void *m, int fd, epggrab_stats_t *sta),
     htsmsg_t* (*trans) (void *mod, char *data) )
 {
   /* Allocate data */
@@ -488,16 +550,18 @@ epggrab_module_int_t *epggrab_module_int_create
   skel->grab     = grab  ?: epggrab_module_grab_spawn;
   skel->trans    = trans ?: epggrab_module_trans_xml;
   skel->parse    = parse;
+  skel->stream   = stream;
   skel->done     = epggrab_module_int_done;
 
   return skel;
 }
 
-char *epggrab_module_grab_spawn ( void *m )
+/*
+ * Spawn the grabber, returns the descriptor for its output
+ */
+static int epggrab_module_spawn ( epggrab_module_int_t *mod )
 {
   int        rd = -1, outlen;
-  char       *outbuf;
-  epggrab_module_int_t *mod = m;
   char      **argv = NULL;
   char       *path;
 
@@ -517,7 +581,7 @@ char *epggrab_module_grab_spawn ( void *m )
   /* Arguments */
   if (spawn_parse_args(&argv, 64, path, NULL)) {
     tvherror(mod->subsys, "%s: unable to parse arguments", mod->id);
-    return NULL;
+    return -1;
   }
 
   /* Grab */
@@ -525,24 +589,51 @@ char *epggrab_module_grab_spawn ( void *m )
 
   spawn_free_args(argv);
 
-  if (outlen < 0)
+  if (outlen < 0) {
+    if (rd >= 0)
+      close(rd);
+    return -1;
+  }
+  return rd;
+}
+
+char *epggrab_module_grab_spawn ( void *m )
+{
+  int        rd, outlen;
+  char       *outbuf;
+  epggrab_module_int_t *mod = m;
+
+  if ((rd = epggrab_module_spawn(mod)) < 0)
     goto error;
 
   outlen = file_readall(rd, &outbuf);
+  close(rd);
   if (outlen < 1)
     goto error;
 
-  close(rd);
-
   return outbuf;
 
 error:
-  if (rd >= 0)
-    close(rd);
   tvherror(mod->subsys, "%s: no output detected", mod->id);
   return NULL;
 }
 
+/*
+ * Spawn the grabber and parse its output as it arrives
+ */
+void epggrab_module_grab_stream ( void *m )
+{
+  int rd;
+  epggrab_module_int_t *mod = m;
+
+  if ((rd = epggrab_module_spawn(mod)) < 0) {
+    tvherror(mod->subsys, "%s: no output detected", mod->id);
+    return;
+  }
+  epggrab_module_stream(mod, rd);
+  close(rd);
+}
+
 
 
 htsmsg_t *epggrab_module_trans_xml ( void *m,  char *c )
@@ -574,6 +665,12 @@ static void _epggrab_socket_handler ( epggrab_module_ext_t *mod, int s )
   time_t tm1, tm2;
   htsmsg_t *data = NULL;
 
+  /* Parse the data as they arrive */
+  if (mod->stream) {
+    epggrab_module_stream(mod, s);
+    return;
+  }
+
   /* Grab/Translate */
   time(&tm1);
   outlen = file_readall(s, &outbuf);
@@ -699,6 +796,7 @@ epggrab_module_ext_t *epggrab_module_ext_create
     const char *id, int subsys, const char *saveid,
     const char *name, int priority, const char *sockid,
     int (*parse) (void *m, htsmsg_t *data, epggrab_stats_t *sta),
+    int (*stream) (void *m, int fd, epggrab_stats_t *sta),
     htsmsg_t* (*trans) (void *mod, char *data) )
 {
   char path[512];
@@ -713,7 +811,7 @@ epggrab_module_ext_t *epggrab_module_ext_create
   epggrab_module_int_create((epggrab_module_int_t*)skel,
                             cls ?: &epggrab_mod_ext_class,
                             id, subsys, saveid, name, priority, path,
-                            NULL, parse, trans);
+                            NULL, parse, stream, trans);
 
   /* Local */
   skel->type     = EPGGRAB_EXT;
@@ -984,19 +984,11 @@ running:
   return 0;
 }
 
-static int _eit_process_event
+static int _eit_decode_event
   ( epggrab_module_t *mod, eit_data_t *ed,
-    const uint8_t *ptr0, int len0,
-    int *save, int lock )
+    const uint8_t *ptr0, int len0, eit_event_t *ev )
 {
   eit_module_t *eit_mod = (eit_module_t *)mod;
-  idnode_list_mapping_t *ilm = NULL;
-  mpegts_service_t *svc;
-  channel_t *ch;
-  eit_event_t ev;
-  const int tableid = ed->tableid;
-  const int sect = ed->sect;
-  const int local = ed->local_time;
   const uint8_t *ptr;
   int r, len;
   uint8_t dtag, dlen;
@@ -1010,9 +1002,9 @@ static int _eit_process_event
 
   if (len < dllen) return -1;
 
-  memset(&ev, 0, sizeof(ev));
+  memset(ev, 0, sizeof(*ev));
   if (ed->charset_len)
-    ev.default_charset = (char *)ed->data + ed->cridauth_len;
+    ev->default_charset = (char *)ed->data + ed->cridauth_len;
   while (dllen > 2) {
     dtag = ptr[0];
     dlen = ptr[1];
@@ -1026,30 +1018,30 @@ static int _eit_process_event
 
     switch (dtag) {
       case DVB_DESC_SHORT_EVENT:
-        r = _eit_desc_short_event(mod, ptr, dlen, &ev);
+        r = _eit_desc_short_event(mod, ptr, dlen, ev);
         break;
       case DVB_DESC_EXT_EVENT:
-        r = _eit_desc_ext_event(mod, ptr, dlen, &ev);
+        r = _eit_desc_ext_event(mod, ptr, dlen, ev);
         break;
       case DVB_DESC_CONTENT:
-        r = _eit_desc_content(mod, ptr, dlen, &ev);
+        r = _eit_desc_content(mod, ptr, dlen, ev);
         break;
       case DVB_DESC_COMPONENT:
-        r = _eit_desc_component(mod, ptr, dlen, &ev);
+        r = _eit_desc_component(mod, ptr, dlen, ev);
         break;
       case DVB_DESC_PARENTAL_RAT:
-        r = _eit_desc_parental(mod, ptr, dlen, &ev);
+        r = _eit_desc_parental(mod, ptr, dlen, ev);
         if(epggrab_conf.epgdb_processparentallabels){
-            if(ev.rating_label){
-              tvhtrace(mod->subsys, "RATINGLABEL '%d'  '%s'", ev.parental, ev.rating_label->rl_display_label);
+            if(ev->rating_label){
+              tvhtrace(mod->subsys, "RATINGLABEL '%d'  '%s'", ev->parental, ev->rating_label->rl_display_label);
             } else {
-              tvhtrace(mod->subsys, "RATINGLABEL '%d'  '<NONE>'", ev.parental);
+              tvhtrace(mod->subsys, "RATINGLABEL '%d'  '<NONE>'", ev->parental);
             }
         }
 
         break;
       case DVB_DESC_CRID:
-        r = _eit_desc_crid(mod, ptr, dlen, &ev, ed);
+        r = _eit_desc_crid(mod, ptr, dlen, ev, ed);
         break;
       default:
         r = 0;
@@ -1070,51 +1062,70 @@ static int _eit_process_event
    * then we use the one from the description.
    */
   if (eit_mod->scrape_episode) {
-    if (ev.title)
-      _eit_scrape_episode(ev.title, eit_mod, &ev);
-    if (ev.desc)
-      _eit_scrape_episode(ev.desc, eit_mod, &ev);
-    if (ev.summary)
-      _eit_scrape_episode(ev.summary, eit_mod, &ev);
+    if (ev->title)
+      _eit_scrape_episode(ev->title, eit_mod, ev);
+    if (ev->desc)
+      _eit_scrape_episode(ev->desc, eit_mod, ev);
+    if (ev->summary)
+      _eit_scrape_episode(ev->summary, eit_mod, ev);
   }
 
-  _eit_scrape_text(eit_mod, &ev);
+  _eit_scrape_text(eit_mod, ev);
+
+  return 12 + (((ptr0[10] & 0x0f) << 8) | ptr0[11]);
+}
+
+static void _eit_event_free ( eit_event_t *ev )
+{
+#if TODO_ADD_EXTRA
+  if (ev->extra)    htsmsg_destroy(ev->extra);
+#endif
+  if (ev->genre)    epg_genre_list_destroy(ev->genre);
+  if (ev->title)    lang_str_destroy(ev->title);
+  if (ev->subtitle) lang_str_destroy(ev->subtitle);
+  if (ev->summary)  lang_str_destroy(ev->summary);
+  if (ev->desc)     lang_str_destroy(ev->desc);
+}
+
+static int _eit_merge_event
+  ( epggrab_module_t *mod, eit_data_t *ed, eit_event_t *ev,
+    const uint8_t *ptr0, int len0, int *save )
+{
+  eit_module_t *eit_mod = (eit_module_t *)mod;
+  idnode_list_mapping_t *ilm = NULL;
+  mpegts_service_t *svc;
+  channel_t *ch;
+
+  lock_assert(&global_lock);
 
-  if (lock)
-    tvh_mutex_lock(&global_lock);
   svc = (mpegts_service_t *)service_find_by_uuid0(&ed->svc_uuid);
   if (svc && eit_mod->opaque) {
     LIST_FOREACH(ilm, &svc->s_channels, ilm_in1_link) {
       ch = (channel_t *)ilm->ilm_in2;
       if (!ch->ch_enabled || ch->ch_epg_parent) continue;
-      if (_eit_process_event_one(mod, tableid, sect, svc, ch,
-                                 &ev, ptr0, len0, local, save) < 0)
+      if (_eit_process_event_one(mod, ed->tableid, ed->sect, svc, ch,
+                                 ev, ptr0, len0, ed->local_time, save) < 0)
         break;
     }
   }
-  if (lock)
-    tvh_mutex_unlock(&global_lock);
-
-#if TODO_ADD_EXTRA
-  if (ev.extra)    htsmsg_destroy(ev.extra);
-#endif
-  if (ev.genre)    epg_genre_list_destroy(ev.genre);
-  if (ev.title)    lang_str_destroy(ev.title);
-  if (ev.subtitle) lang_str_destroy(ev.subtitle);
-  if (ev.summary)  lang_str_destroy(ev.summary);
-  if (ev.desc)     lang_str_destroy(ev.desc);
-
-  if (ilm)
-    return -1;
-  return 12 + (((ptr0[10] & 0x0f) << 8) | ptr0[11]);
+  return ilm ? -1 : 0;
 }
 
+/* Decoded events of one queued section, merged under one lock hold */
+typedef struct eit_pending
+{
+  const uint8_t *ptr;
+  int            len;
+  eit_event_t    ev;
+} eit_pending_t;
+
 static void
 _eit_process_data(void *m, void *data, uint32_t len)
 {
-  int save = 0, r;
+  int save = 0, r, i, count = 0, alloc = 0;
   size_t hlen;
   eit_data_t *ed = data;
+  eit_pending_t *pend = NULL, *p;
 
   assert(len >= sizeof(*ed));
   hlen = sizeof(*ed) + ed->cridauth_len + ed->charset_len;
@@ -1122,30 +1133,56 @@ _eit_process_data(void *m, void *data, uint32_t len)
   data += hlen;
   len -= hlen;
 
+  /* Decode (charset conversion, scraping) without the global lock */
   while (len) {
-    if ((r = _eit_process_event(m, ed, data, len, &save, 1)) < 0)
+    if (count == alloc) {
+      alloc = alloc ? alloc * 2 : 8;
+      pend = realloc(pend, alloc * sizeof(*pend));
+    }
+    p = &pend[count];
+    if ((r = _eit_decode_event(m, ed, data, len, &p->ev)) < 0)
       break;
     assert(r > 0);
+    p->ptr = data;
+    p->len = len;
+    count++;
     len -= r;
     data += r;
   }
 
-  if (save) {
-    tvh_mutex_lock(&global_lock);
-    epg_updated();
-    tvh_mutex_unlock(&global_lock);
+  if (count == 0) {
+    free(pend);
+    return;
   }
+
+  tvh_mutex_lock(&global_lock);
+  for (i = 0; i < count; i++)
+    if (_eit_merge_event(m, ed, &pend[i].ev, pend[i].ptr, pend[i].len, &save) < 0)
+      break;
+  if (save)
+    epg_updated();
+  tvh_mutex_unlock(&global_lock);
+
+  for (i = 0; i < count; i++)
+    _eit_event_free(&pend[i].ev);
+  free(pend);
 }
 
 static void
 _eit_process_immediate(void *m, const void *ptr, uint32_t len, eit_data_t *ed)
 {
+  eit_event_t ev;
   int save = 0, r;
 
   while (len) {
-    if ((r = _eit_process_event(m, ed, ptr, len, &save, 0)) < 0)
+    if ((r = _eit_decode_event(m, ed, ptr, len, &ev)) < 0)
       break;
     assert(r > 0);
+    if (_eit_merge_event(m, ed, &ev, ptr, len, &save) < 0)
+      r = -1;
+    _eit_event_free(&ev);
+    if (r < 0)
+      break;
     len -= r;
     ptr += r;
   }
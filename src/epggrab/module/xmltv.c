@@ -54,14 +54,17 @@
 #define XMLTV_GRAB "tv_grab_"
 
 /*
- * Global variables for XPaths
+ * Pre-processed XPaths, one set per parse session (the imports of
+ * several modules may run at the same time)
  */
-htsmsg_t                            *xmltv_xpath_category_code = NULL;
-htsmsg_t                            *xmltv_xpath_unique = NULL;
-htsmsg_t                            *xmltv_xpath_series = NULL;
-htsmsg_t                            *xmltv_xpath_episode = NULL;
-int                                 xmltv_xpath_series_fallback = 0;
-int                                 xmltv_xpath_episode_fallback = 0;
+typedef struct xmltv_xpath {
+  htsmsg_t *category_code;
+  htsmsg_t *unique;
+  htsmsg_t *series;
+  htsmsg_t *episode;
+  int       series_fallback;
+  int       episode_fallback;
+} xmltv_xpath_t;
 
 /* **************************************************************************
  * Parsing
@@ -563,7 +566,7 @@ static int _xmltv_parse_age_rating
  * the 'category' list.
  */
 static epg_genre_list_t
-*_xmltv_parse_categories ( htsmsg_t *tags )
+*_xmltv_parse_categories ( htsmsg_t *tags, const xmltv_xpath_t *xp )
 {
   htsmsg_t *e;
   htsmsg_field_t *f;
@@ -580,9 +583,9 @@ static epg_genre_list_t
 
       cat_etsi = NULL;
       //If we have an XPath expression to search
-      if(xmltv_xpath_category_code)
+      if(xp->category_code)
       {
-        cat_etsi = htsmsg_xml_xpath_search(e, xmltv_xpath_category_code);
+        cat_etsi = htsmsg_xml_xpath_search(e, xp->category_code);
 
         cat_flag = 0;
 
@@ -783,39 +786,187 @@ xmltv_appendit(lang_str_t **_desc, string_list_t *list,
 }
 
 /**
- * Parse tags inside of a programme
+ * Programme data prepared without the global lock
  */
-static int _xmltv_parse_programme_tags
-  (epggrab_module_t *mod, channel_t *ch, htsmsg_t *tags,
-   time_t start, time_t stop, const char *icon,
-   epggrab_stats_t *stats)
+typedef struct xmltv_prog {
+  const char        *chid;
+  const char        *icon;
+  const char        *unique;
+  htsmsg_t          *tags;
+  time_t             start;
+  time_t             stop;
+  int                valid;
+  char              *uri;
+  char              *suri;
+  epg_episode_num_t  epnum;
+  lang_str_t        *title;
+  lang_str_t        *subtitle;
+  lang_str_t        *desc;
+  lang_str_t        *summary;
+  htsmsg_t          *credits;
+  string_list_t     *category;
+  string_list_t     *keyword;
+  epg_genre_list_t  *genre;
+} xmltv_prog_t;
+
+/**
+ * Parse a <programme> tag from xmltv, the global lock is not required.
+ * Returns -1 when the programme has no channel. The strings refer to
+ * 'body' which must be kept until _xmltv_prog_done().
+ */
+static int _xmltv_prog_prepare
+  (epggrab_module_t *mod, const xmltv_xpath_t *xp,
+   htsmsg_t *body, xmltv_prog_t *p)
 {
   const int scrape_extra = ((epggrab_module_int_t *)mod)->xmltv_scrape_extra;
   const int scrape_onto_desc = ((epggrab_module_int_t *)mod)->xmltv_scrape_onto_desc;
   const int use_category_not_genre = ((epggrab_module_int_t *)mod)->xmltv_use_category_not_genre;
+  htsmsg_t *attribs, *tags, *subtag;
+  const char *s, *temp_series = NULL, *temp_episode = NULL;
+
+  memset(p, 0, sizeof(*p));
+
+  if(body == NULL) return -1;
+
+  if((attribs = htsmsg_get_map(body,    "attrib"))  == NULL) return -1;
+  if((tags    = htsmsg_get_map(body,    "tags"))    == NULL) return -1;
+  if((p->chid = htsmsg_get_str(attribs, "channel")) == NULL) return -1;
+  p->tags = tags;
+
+  if((s       = htsmsg_get_str(attribs, "start"))   == NULL) return 0;
+  p->start = _xmltv_str2time(s);
+  if((s       = htsmsg_get_str(attribs, "stop"))    == NULL) return 0;
+  p->stop  = _xmltv_str2time(s);
+
+  if((subtag  = htsmsg_get_map(tags,    "icon"))   != NULL &&
+     (attribs = htsmsg_get_map(subtag,  "attrib")) != NULL)
+    p->icon = htsmsg_get_str(attribs, "src");
+
+  //Search the current programme for XPath matches
+  //(the attributes of the root <programme> node are searched, too)
+  if(xp->unique)
+    p->unique = htsmsg_xml_xpath_search(body, xp->unique);
+  if(xp->series)
+    temp_series = htsmsg_xml_xpath_search(body, xp->series);
+  if(xp->episode)
+    temp_episode = htsmsg_xml_xpath_search(body, xp->episode);
+
+  if(p->stop <= p->start) return 0;
+  p->valid = 1;
+
+  /* Description/summary */
+  _xmltv_parse_lang_str(&p->desc, tags, "desc");
+  _xmltv_parse_lang_str(&p->summary, tags, "summary");
+
+  /* If user has requested it then retrieve additional information
+   * from programme such as credits and keywords.
+   */
+  if (scrape_extra || scrape_onto_desc) {
+    string_list_t *credits_names  = _xmltv_parse_credits(&p->credits, tags);
+    p->category = _xmltv_make_str_list_from_matching(tags, "category");
+    p->keyword  = _xmltv_make_str_list_from_matching(tags, "keyword");
+
+    /* Append the details on to the description, mainly for legacy
+     * clients. This allow you to view the details in the description
+     * on old boxes/tablets that don't parse the newer fields or
+     * don't display them.
+     */
+    if (scrape_onto_desc) {
+      xmltv_appendit(&p->desc, credits_names, N_("Credits: "), p->summary);
+      xmltv_appendit(&p->desc, p->category, N_("Categories: "), p->summary);
+      xmltv_appendit(&p->desc, p->keyword, N_("Keywords: "), p->summary);
+    }
+
+    if (credits_names)    string_list_destroy(credits_names);
+  } /* desc */
+
+  /*
+   * Episode/Series info
+   */
+  get_episode_info(mod, tags, &p->uri, &p->suri, &p->epnum);
+
+  if(temp_series)
+  {
+    free(p->suri);
+    p->suri = strdup(temp_series);
+  }
+  else
+  {
+    //If there was an XPath for series, but nothing was found
+    //AND we are NOT falling back to the standard method,
+    //then erase the crid that TVH manufactured from the module/series/episode.
+    if(xp->series && !xp->series_fallback)
+    {
+      free(p->suri);
+      p->suri = NULL;
+    }
+  }
+
+  if(temp_episode)
+  {
+    free(p->uri);
+    p->uri = strdup(temp_episode);
+  }
+  else
+  {
+    //If there was an XPath for episode, but nothing was found
+    //AND we are NOT falling back to the standard method,
+    //then erase the crid that TVH manufactured from the module/series/episode.
+    if(xp->episode && !xp->episode_fallback)
+    {
+      free(p->uri);
+      p->uri = NULL;
+    }
+  }
+
+  _xmltv_parse_lang_str(&p->title, tags, "title");
+  _xmltv_parse_lang_str(&p->subtitle, tags, "sub-title");
+
+  if (!use_category_not_genre)
+    p->genre = _xmltv_parse_categories(tags, xp);
+
+  return 0;
+}
+
+/**
+ * Free the prepared programme data
+ */
+static void _xmltv_prog_done ( xmltv_prog_t *p )
+{
+  free(p->uri);
+  free(p->suri);
+  if (p->title)    lang_str_destroy(p->title);
+  if (p->subtitle) lang_str_destroy(p->subtitle);
+  if (p->desc)     lang_str_destroy(p->desc);
+  if (p->summary)  lang_str_destroy(p->summary);
+  if (p->credits)  htsmsg_destroy(p->credits);
+  if (p->category) string_list_destroy(p->category);
+  if (p->keyword)  string_list_destroy(p->keyword);
+  if (p->genre)    epg_genre_list_destroy(p->genre);
+}
+
+/**
+ * Merge the prepared programme to the channel schedule
+ */
+static int _xmltv_parse_programme_tags
+  (epggrab_module_t *mod, channel_t *ch, xmltv_prog_t *p,
+   epggrab_stats_t *stats)
+{
+  const int scrape_extra = ((epggrab_module_int_t *)mod)->xmltv_scrape_extra;
+  htsmsg_t *tags = p->tags;
   int save = 0;
   epg_changes_t changes = 0;
   epg_broadcast_t *ebc = NULL;
-  epg_genre_list_t *egl;
-  epg_episode_num_t epnum;
   epg_set_t *set;
-  char *suri = NULL, *uri = NULL;
-  lang_str_t *title = NULL;
-  lang_str_t *desc = NULL;
-  lang_str_t *summary = NULL;
-  lang_str_t *subtitle = NULL;
+  time_t start = p->start, stop = p->stop;
   time_t first_aired = 0;
   int8_t bw = -1;
 
-  const char  *temp_unique = htsmsg_get_str(tags, "@@UNIQUE");
-  const char  *temp_series = htsmsg_get_str(tags, "@@SERIES");
-  const char  *temp_episode = htsmsg_get_str(tags, "@@EPISODE");
+  const char  *temp_unique = p->unique;
 
   if (epg_channel_ignore_broadcast(ch, start))
     return 0;
 
-  memset(&epnum, 0, sizeof(epnum));
-
   /*
    * Broadcast
    */
@@ -830,8 +981,8 @@ static int _xmltv_parse_programme_tags
     if(ebc)
     {
       tvhtrace(LS_XMLTV, "Matched ID '%s' start '%"PRItime_t"/%"PRItime_t"' stop '%"PRItime_t"/%"PRItime_t"'.", temp_unique, ebc->start, start, ebc->stop, stop);
-      ebc->start = start;
-      ebc->stop = stop;
+      save |= epg_broadcast_set_start(ebc, start);
+      save |= epg_broadcast_set_stop(ebc, stop);
     }
     else
     {
@@ -867,53 +1018,20 @@ static int _xmltv_parse_programme_tags
   {
     save |= epg_broadcast_set_xmltv_eid(ebc, temp_unique, &changes);
   }
-  
-  /* Description/summary (wait for episode first) */
-  _xmltv_parse_lang_str(&desc, tags, "desc");
-  _xmltv_parse_lang_str(&summary, tags, "summary");
 
-  /* If user has requested it then retrieve additional information
-   * from programme such as credits and keywords.
-   */
-  if (scrape_extra || scrape_onto_desc) {
-    htsmsg_t      *credits        = NULL;
-    string_list_t *credits_names  = _xmltv_parse_credits(&credits, tags);
-    string_list_t *category       = _xmltv_make_str_list_from_matching(tags, "category");
-    string_list_t *keyword        = _xmltv_make_str_list_from_matching(tags, "keyword");
-
-    if (scrape_extra && credits)
-      save |= epg_broadcast_set_credits(ebc, credits, &changes);
-    if (scrape_extra && category)
-      save |= epg_broadcast_set_category(ebc, category, &changes);
-    if (scrape_extra && keyword)
-      save |= epg_broadcast_set_keyword(ebc, keyword, &changes);
-
-
-    /* Append the details on to the description, mainly for legacy
-     * clients. This allow you to view the details in the description
-     * on old boxes/tablets that don't parse the newer fields or
-     * don't display them.
-     */
-    if (scrape_onto_desc) {
-      xmltv_appendit(&desc, credits_names, N_("Credits: "), summary);
-      xmltv_appendit(&desc, category, N_("Categories: "), summary);
-      xmltv_appendit(&desc, keyword, N_("Keywords: "), summary);
-    }
-
-    if (credits)          htsmsg_destroy(credits);
-    if (credits_names)    string_list_destroy(credits_names);
-    if (category)         string_list_destroy(category);
-    if (keyword)          string_list_destroy(keyword);
-
-#undef APPENDIT
-  } /* desc */
+  if (scrape_extra && p->credits)
+    save |= epg_broadcast_set_credits(ebc, p->credits, &changes);
+  if (scrape_extra && p->category)
+    save |= epg_broadcast_set_category(ebc, p->category, &changes);
+  if (scrape_extra && p->keyword)
+    save |= epg_broadcast_set_keyword(ebc, p->keyword, &changes);
 
-  if (desc)
-    save |= epg_broadcast_set_description(ebc, desc, &changes);
+  if (p->desc)
+    save |= epg_broadcast_set_description(ebc, p->desc, &changes);
 
   /* summary */
-  if (summary)
-    save |= epg_broadcast_set_summary(ebc, summary, &changes);
+  if (p->summary)
+    save |= epg_broadcast_set_summary(ebc, p->summary, &changes);
 
   /* Quality metadata */
   save |= xmltv_parse_vid_quality(ebc, htsmsg_get_map(tags, "video"), &bw, &changes);
@@ -929,65 +1047,12 @@ static int _xmltv_parse_programme_tags
       htsmsg_get_map(tags, "new"))
     save |= epg_broadcast_set_is_new(ebc, 1, &changes);
 
-  /*
-   * Episode/Series info
-   */
-  get_episode_info(mod, tags, &uri, &suri, &epnum);
-
-  if(temp_series)
-  {
-    if(suri)
-    {
-      free(suri);
-    }
-    suri = strdup(temp_series);
-  }
-  else
-  {
-    //If there was an XPath for series, but nothing was found
-    //AND we are NOT falling back to the standard method,
-    //then erase the crid that TVH manufactured from the module/series/episode.
-    if(xmltv_xpath_series && !xmltv_xpath_series_fallback)
-    {
-      if(suri)
-      {
-        free(suri);
-        suri = NULL;
-      }
-    }
-
-  }
-
-  if(temp_episode)
-  {
-    if(uri)
-    {
-      free(uri);
-    }
-    uri = strdup(temp_episode);
-  }
-  else
-  {
-    //If there was an XPath for episode, but nothing was found
-    //AND we are NOT falling back to the standard method,
-    //then erase the crid that TVH manufactured from the module/series/episode.
-    if(xmltv_xpath_episode && !xmltv_xpath_episode_fallback)
-    {
-      if(uri)
-      {
-        free(uri);
-        uri = NULL;
-      }
-    }
-
-  }
   /*
    * Series Link
    */
-  if (suri) {
+  if (p->suri) {
     set = ebc->serieslink;
-    save |= epg_broadcast_set_serieslink_uri(ebc, suri, &changes);
-    free(suri);
+    save |= epg_broadcast_set_serieslink_uri(ebc, p->suri, &changes);
     stats->seasons.total++;
     if (changes & EPG_CHANGED_SERIESLINK) {
       if (set == NULL)
@@ -1000,13 +1065,9 @@ static int _xmltv_parse_programme_tags
   /*
    * Episode
    */
-  if (uri) {
+  if (p->uri) {
     set = ebc->episodelink;
-    save |= epg_broadcast_set_episodelink_uri(ebc, uri, &changes);
-    //DMC 28-Mar-2024.
-    //This free() was added because compared to the series link above
-    //it looked like not having it would lead to a memory leak.
-    free(uri);
+    save |= epg_broadcast_set_episodelink_uri(ebc, p->uri, &changes);
     stats->episodes.total++;
     if (changes & EPG_CHANGED_EPISODE) {
       if (set == NULL)
@@ -1016,23 +1077,18 @@ static int _xmltv_parse_programme_tags
     }
   }
 
-  _xmltv_parse_lang_str(&title, tags, "title");
-  _xmltv_parse_lang_str(&subtitle, tags, "sub-title");
+  if (p->title)
+    save |= epg_broadcast_set_title(ebc, p->title, &changes);
+  if (p->subtitle)
+    save |= epg_broadcast_set_subtitle(ebc, p->subtitle, &changes);
 
-  if (title)
-    save |= epg_broadcast_set_title(ebc, title, &changes);
-  if (subtitle)
-    save |= epg_broadcast_set_subtitle(ebc, subtitle, &changes);
-
-  if (!use_category_not_genre && (egl = _xmltv_parse_categories(tags))) {
-    save |= epg_broadcast_set_genre(ebc, egl, &changes);
-    epg_genre_list_destroy(egl);
-  }
+  if (p->genre)
+    save |= epg_broadcast_set_genre(ebc, p->genre, &changes);
 
   if (bw != -1)
     save |= epg_broadcast_set_is_bw(ebc, (uint8_t)bw, &changes);
 
-  save |= epg_broadcast_set_epnum(ebc, &epnum, &changes);
+  save |= epg_broadcast_set_epnum(ebc, &p->epnum, &changes);
 
   save |= _xmltv_parse_star_rating(ebc, tags, &changes);
 
@@ -1040,8 +1096,8 @@ static int _xmltv_parse_programme_tags
 
   save |= _xmltv_parse_age_rating(ebc, tags, &changes);
 
-  if (icon)
-    save |= epg_broadcast_set_image(ebc, icon, &changes);
+  if (p->icon)
+    save |= epg_broadcast_set_image(ebc, p->icon, &changes);
 
   save |= epg_broadcast_set_first_aired(ebc, first_aired, &changes);
 
@@ -1058,98 +1114,36 @@ static int _xmltv_parse_programme_tags
   if (save && !(changes & EPG_CHANGED_CREATE))
     stats->broadcasts.modified++;
 
-  /* Cleanup */
-  if (title)    lang_str_destroy(title);
-  if (subtitle) lang_str_destroy(subtitle);
-  if (desc)     lang_str_destroy(desc);
-  if (summary)  lang_str_destroy(summary);
   return save;
 }
 
 /**
- * Parse a <programme> tag from xmltv
+ * Merge a prepared <programme> to the EPG
  */
 static int _xmltv_parse_programme
-  (epggrab_module_t *mod, htsmsg_t *body, epggrab_stats_t *stats)
+  (epggrab_module_t *mod, xmltv_prog_t *p, epggrab_stats_t *stats)
 {
   int chsave = 0, save = 0;
-  htsmsg_t *attribs, *tags, *subtag;
-  const char *s, *chid, *icon = NULL;
-  time_t start, stop;
   channel_t *ch;
   epggrab_channel_t *ec;
   idnode_list_mapping_t *ilm;
 
-  if(body == NULL) return 0;
+  lock_assert(&global_lock);
 
-  if((attribs = htsmsg_get_map(body,    "attrib"))  == NULL) return 0;
-  if((tags    = htsmsg_get_map(body,    "tags"))    == NULL) return 0;
-  if((chid    = htsmsg_get_str(attribs, "channel")) == NULL) return 0;
-  if((ec      = epggrab_channel_find(mod, chid, 1, &chsave)) == NULL) return 0;
+  if((ec      = epggrab_channel_find(mod, p->chid, 1, &chsave)) == NULL) return 0;
   if (chsave) {
     stats->channels.created++;
     stats->channels.modified++;
   }
   if (!LIST_FIRST(&ec->channels)) return 0;
 
-  if((s       = htsmsg_get_str(attribs, "start"))   == NULL) return 0;
-  start = _xmltv_str2time(s);
-  if((s       = htsmsg_get_str(attribs, "stop"))    == NULL) return 0;
-  stop  = _xmltv_str2time(s);
-
-  if((subtag  = htsmsg_get_map(tags,    "icon"))   != NULL &&
-     (attribs = htsmsg_get_map(subtag,  "attrib")) != NULL)
-    icon = htsmsg_get_str(attribs, "src");
-
-  const char  *temp_unique;
-  const char  *temp_series;
-  const char  *temp_episode;
-
-  //NOTE - DMC April 2024
-  //The XPath values need to be searched for here, before the rest of the processing,
-  //because the attributes of the root <programme> node are not available past
-  //this point.  Only sub-nodes of <programme> are passed on to the next function.
-  //If XPath values are found here, add them to the htsmsg using special '@@'
-  //field names which can then be passed to the next function for further processing.
-
-  //Search the current programme for XPath matches
-  if(xmltv_xpath_unique)
-  {
-    temp_unique = htsmsg_xml_xpath_search(body, xmltv_xpath_unique);
-    //If an XPath ID has been found, stash it in htsmsg so that it can
-    //be retrieved by the next function.
-    if(temp_unique)
-    {
-      htsmsg_add_str(tags, "@@UNIQUE", temp_unique);
-    }
-  }//END stash the XPath unique ID
-
-  if(xmltv_xpath_series)
-  {
-    temp_series = htsmsg_xml_xpath_search(body, xmltv_xpath_series);
-    if(temp_series)
-    {
-      htsmsg_add_str(tags, "@@SERIES", temp_series);
-    }
-  }
-
-  if(xmltv_xpath_episode)
-  {
-    temp_episode = htsmsg_xml_xpath_search(body, xmltv_xpath_episode);
-    if(temp_episode)
-    {
-      htsmsg_add_str(tags, "@@EPISODE", temp_episode);
-    }
-  }
-
-  if(stop <= start || stop <= gclk()) return 0;
+  if(!p->valid || p->stop <= gclk()) return 0;
 
   ec->laststamp = gclk();
   LIST_FOREACH(ilm, &ec->channels, ilm_in1_link) {
     ch = (channel_t *)ilm->ilm_in2;
     if (!ch->ch_enabled || ch->ch_epg_parent) continue;
-    save |= _xmltv_parse_programme_tags(mod, ch, tags,
-                                        start, stop, icon, stats);
+    save |= _xmltv_parse_programme_tags(mod, ch, p, stats);
   }
   return save;
 }
@@ -1256,24 +1250,21 @@ static int _xmltv_parse_channel
  *  ...multiple programmes
  *</tv>
  */
-static int _xmltv_parse_tv
-  (epggrab_module_t *mod, htsmsg_t *body, epggrab_stats_t *stats)
+/**
+ * Prepare the parse session
+ */
+static void _xmltv_parse_begin ( epggrab_module_t *mod, xmltv_xpath_t *xp )
 {
-  int gsave = 0, save;
-  htsmsg_t *tags;
-  htsmsg_field_t *f;
-
-  if((tags = htsmsg_get_map(body, "tags")) == NULL)
-    return 0;
+  memset(xp, 0, sizeof(*xp));
 
   //Pre-process the XPaths
   //Only done once per XMLTV session.
   if(((epggrab_module_int_t *)mod)->xmltv_xpath_category_code)
   {
     tvhtrace(LS_XMLTV, "Parsing Category Code XPath: '%s'.", ((epggrab_module_int_t *)mod)->xmltv_xpath_category_code);
-    xmltv_xpath_category_code = htsmsg_xml_parse_xpath(((epggrab_module_int_t *)mod)->xmltv_xpath_category_code);
+    xp->category_code = htsmsg_xml_parse_xpath(((epggrab_module_int_t *)mod)->xmltv_xpath_category_code);
 
-    if(htsmsg_is_empty(xmltv_xpath_category_code))
+    if(htsmsg_is_empty(xp->category_code))
     {
       tvhtrace(LS_XMLTV, "Failed to parse Category Code XPath '%s'.", ((epggrab_module_int_t *)mod)->xmltv_xpath_category_code);
     }
@@ -1286,9 +1277,9 @@ static int _xmltv_parse_tv
   if(((epggrab_module_int_t *)mod)->xmltv_xpath_unique_id)
   {
     tvhtrace(LS_XMLTV, "Parsing Unique ID XPath: '%s'.", ((epggrab_module_int_t *)mod)->xmltv_xpath_unique_id);
-    xmltv_xpath_unique = htsmsg_xml_parse_xpath(((epggrab_module_int_t *)mod)->xmltv_xpath_unique_id);
+    xp->unique = htsmsg_xml_parse_xpath(((epggrab_module_int_t *)mod)->xmltv_xpath_unique_id);
 
-    if(htsmsg_is_empty(xmltv_xpath_unique))
+    if(htsmsg_is_empty(xp->unique))
     {
       tvhtrace(LS_XMLTV, "Failed to parse Unique ID XPath '%s'.", ((epggrab_module_int_t *)mod)->xmltv_xpath_unique_id);
     }
@@ -1301,9 +1292,9 @@ static int _xmltv_parse_tv
   if(((epggrab_module_int_t *)mod)->xmltv_xpath_series_link)
   {
     tvhtrace(LS_XMLTV, "Parsing SeriesLink XPath: '%s'.", ((epggrab_module_int_t *)mod)->xmltv_xpath_series_link);
-    xmltv_xpath_series = htsmsg_xml_parse_xpath(((epggrab_module_int_t *)mod)->xmltv_xpath_series_link);
+    xp->series = htsmsg_xml_parse_xpath(((epggrab_module_int_t *)mod)->xmltv_xpath_series_link);
 
-    if(htsmsg_is_empty(xmltv_xpath_series))
+    if(htsmsg_is_empty(xp->series))
     {
       tvhtrace(LS_XMLTV, "Failed to parse SeriesLink XPath '%s'.", ((epggrab_module_int_t *)mod)->xmltv_xpath_series_link);
     }
@@ -1316,9 +1307,9 @@ static int _xmltv_parse_tv
   if(((epggrab_module_int_t *)mod)->xmltv_xpath_episode_link)
   {
     tvhtrace(LS_XMLTV, "Parsing EpisodeLink XPath: '%s'.", ((epggrab_module_int_t *)mod)->xmltv_xpath_episode_link);
-    xmltv_xpath_episode = htsmsg_xml_parse_xpath(((epggrab_module_int_t *)mod)->xmltv_xpath_episode_link);
+    xp->episode = htsmsg_xml_parse_xpath(((epggrab_module_int_t *)mod)->xmltv_xpath_episode_link);
 
-    if(htsmsg_is_empty(xmltv_xpath_episode))
+    if(htsmsg_is_empty(xp->episode))
     {
       tvhtrace(LS_XMLTV, "Failed to parse EpisodeLink XPath '%s'.", ((epggrab_module_int_t *)mod)->xmltv_xpath_episode_link);
     }
@@ -1329,59 +1320,120 @@ static int _xmltv_parse_tv
   }
 
   //Set the fallback flags.
-  xmltv_xpath_series_fallback = 0;
   if(((epggrab_module_int_t *)mod)->xmltv_xpath_series_use_standard)
   {
-    xmltv_xpath_series_fallback = 1;
+    xp->series_fallback = 1;
   }
 
-  xmltv_xpath_episode_fallback = 0;
   if(((epggrab_module_int_t *)mod)->xmltv_xpath_episode_use_standard)
   {
-    xmltv_xpath_episode_fallback = 1;
+    xp->episode_fallback = 1;
   }
   //Finished pre-processing the XPath stuff.
 
   tvh_mutex_lock(&global_lock);
   epggrab_channel_begin_scan(mod);
   tvh_mutex_unlock(&global_lock);
+}
+
+/**
+ * Finish the parse session, the channel names collected by an
+ * incomplete import are not applied (the next scan drops them)
+ */
+static void _xmltv_parse_end
+  ( epggrab_module_t *mod, xmltv_xpath_t *xp, int complete )
+{
+  if (complete) {
+    tvh_mutex_lock(&global_lock);
+    epggrab_channel_end_scan(mod);
+    tvh_mutex_unlock(&global_lock);
+  }
+
+  //If XPaths were used, release the parsed paths.
+  if(xp->unique)
+    htsmsg_destroy(xp->unique);
+  if(xp->series)
+    htsmsg_destroy(xp->series);
+  if(xp->episode)
+    htsmsg_destroy(xp->episode);
+  if(xp->category_code)
+    htsmsg_destroy(xp->category_code);
+  memset(xp, 0, sizeof(*xp));
+}
+
+/*
+ * Store the timing of the last import to the module
+ */
+static void _xmltv_import_stats
+  ( epggrab_module_t *mod, int64_t read, int64_t parse, int64_t prepare,
+    int64_t merge, int64_t lock_max, int64_t elements )
+{
+  epggrab_module_int_t *mi = (epggrab_module_int_t *)mod;
+
+  tvh_mutex_lock(&global_lock);
+  mi->import_read     = read / 1000;
+  mi->import_parse    = parse / 1000;
+  mi->import_prepare  = prepare / 1000;
+  mi->import_merge    = merge / 1000;
+  mi->import_lock_max = lock_max / 1000;
+  mi->import_elements = elements;
+  tvh_mutex_unlock(&global_lock);
+  tvhdebug(mod->subsys, "%s: read %"PRId64"ms parse %"PRId64"ms "
+                        "prepare %"PRId64"ms merge %"PRId64"ms "
+                        "(longest lock %"PRId64"ms)", mod->id,
+                        read / 1000, parse / 1000, prepare / 1000,
+                        merge / 1000, lock_max / 1000);
+}
+
+static int _xmltv_parse_tv
+  (epggrab_module_t *mod, htsmsg_t *body, epggrab_stats_t *stats)
+{
+  int gsave = 0, save;
+  htsmsg_t *tags;
+  htsmsg_field_t *f;
+  xmltv_prog_t prog;
+  xmltv_xpath_t xp;
+  int64_t t0, t1, t2, prepare = 0, merge = 0, lock_max = 0, elements = 0;
+
+  if((tags = htsmsg_get_map(body, "tags")) == NULL)
+    return 0;
+
+  _xmltv_parse_begin(mod, &xp);
 
   HTSMSG_FOREACH(f, tags) {
     save = 0;
+    t0 = getmonoclock();
     if(!strcmp(htsmsg_field_name(f), "channel")) {
+      t1 = t0;
       tvh_mutex_lock(&global_lock);
       save = _xmltv_parse_channel(mod, htsmsg_get_map_by_field(f), stats);
       tvh_mutex_unlock(&global_lock);
     } else if(!strcmp(htsmsg_field_name(f), "programme")) {
+      if (_xmltv_prog_prepare(mod, &xp, htsmsg_get_map_by_field(f), &prog)) {
+        _xmltv_prog_done(&prog);
+        continue;
+      }
+      t1 = getmonoclock();
       tvh_mutex_lock(&global_lock);
-      save = _xmltv_parse_programme(mod, htsmsg_get_map_by_field(f), stats);
+      save = _xmltv_parse_programme(mod, &prog, stats);
       if (save) epg_updated();
       tvh_mutex_unlock(&global_lock);
+      _xmltv_prog_done(&prog);
+    } else {
+      continue;
     }
+    t2 = getmonoclock();
+    prepare += t1 - t0;
+    merge += t2 - t1;
+    lock_max = MAX(lock_max, t2 - t1);
+    elements++;
     gsave |= save;
   }
 
-  tvh_mutex_lock(&global_lock);
-  epggrab_channel_end_scan(mod);
-  tvh_mutex_unlock(&global_lock);
+  _xmltv_parse_end(mod, &xp, 1);
+
+  _xmltv_import_stats(mod, 0, 0, prepare, merge, lock_max, elements);
 
-  //If XPaths were used, release the parsed paths.
-  if(xmltv_xpath_unique)
-  {
-    htsmsg_destroy(xmltv_xpath_unique);
-  }
-  if(xmltv_xpath_series)
-  {
-    htsmsg_destroy(xmltv_xpath_series);
-  }
-  if(xmltv_xpath_episode)
-  {
-    htsmsg_destroy(xmltv_xpath_episode);
-  }
-  if(xmltv_xpath_category_code)
-  {
-    htsmsg_destroy(xmltv_xpath_category_code);
-  }
   return gsave;
 }
 
@@ -1399,6 +1451,268 @@ static int _xmltv_parse
   return _xmltv_parse_tv(mod, tv, stats);
 }
 
+/* ************************************************************************
+ * Streaming parser
+ * ***********************************************************************/
+
+/*
+ * The (single) reading thread parses the elements and prepares the
+ * programme data (charset conversion, language strings, genres, credits)
+ * off the global lock. The complete batches are passed to one merge
+ * thread which commits them to the EPG, one global lock hold per batch.
+ * The queue is bounded, so a slow merge throttles the reader.
+ *
+ * An XML error (or a read error) in the middle of the document stops the
+ * import: the batches merged before the error are kept (like the
+ * programmes of an interrupted OTA scan, the next import updates them),
+ * the pending batch is dropped and the channel scan is not finished,
+ * so the channel name changes and the channels new in this document
+ * are not applied (their programmes are not merged).
+ */
+#define XMLTV_STREAM_BATCH    256
+#define XMLTV_STREAM_QUEUE    4
+#define XMLTV_STREAM_CHUNK    (128*1024)
+#define XMLTV_STREAM_PROGRESS 10
+
+typedef struct xmltv_stream_ele {
+  htsmsg_t     *tag;
+  int           programme;
+  xmltv_prog_t  prog;
+} xmltv_stream_ele_t;
+
+typedef struct xmltv_batch {
+  TAILQ_ENTRY(xmltv_batch) link;
+  int                count;
+  xmltv_stream_ele_t ele[XMLTV_STREAM_BATCH];
+} xmltv_batch_t;
+
+typedef struct xmltv_stream {
+  epggrab_module_t *mod;
+  epggrab_stats_t  *stats;
+  xmltv_xpath_t     xpath;
+  int               save;
+  int64_t           elements;
+  xmltv_batch_t    *batch;
+
+  /* Merge queue */
+  tvh_mutex_t       lock;
+  tvh_cond_t        cond;
+  TAILQ_HEAD(, xmltv_batch) queue;
+  int               queued;
+  int               done;
+  pthread_t         tid;
+
+  /* Timing (us) */
+  int64_t           prepare;
+  int64_t           merge;
+  int64_t           lock_max;
+} xmltv_stream_t;
+
+static void _xmltv_batch_free ( xmltv_batch_t *b )
+{
+  xmltv_stream_ele_t *e;
+  int i;
+
+  for (i = 0; i < b->count; i++) {
+    e = &b->ele[i];
+    if (e->programme)
+      _xmltv_prog_done(&e->prog);
+    htsmsg_destroy(e->tag);
+  }
+  free(b);
+}
+
+static void _xmltv_batch_merge ( xmltv_stream_t *xs, xmltv_batch_t *b )
+{
+  xmltv_stream_ele_t *e;
+  int i, save, updated = 0;
+  int64_t t0, t1;
+
+  t0 = getmonoclock();
+  tvh_mutex_lock(&global_lock);
+  for (i = 0; i < b->count; i++) {
+    e = &b->ele[i];
+    if (e->programme) {
+      save = _xmltv_parse_programme(xs->mod, &e->prog, xs->stats);
+      updated |= save;
+    } else {
+      save = _xmltv_parse_channel(xs->mod, e->tag, xs->stats);
+    }
+    xs->save |= save;
+  }
+  if (updated) epg_updated();
+  tvh_mutex_unlock(&global_lock);
+  t1 = getmonoclock();
+  xs->merge += t1 - t0;
+  xs->lock_max = MAX(xs->lock_max, t1 - t0);
+
+  _xmltv_batch_free(b);
+}
+
+static void *_xmltv_stream_merge_thread ( void *aux )
+{
+  xmltv_stream_t *xs = aux;
+  xmltv_batch_t *b;
+
+  tvh_mutex_lock(&xs->lock);
+  while (1) {
+    b = TAILQ_FIRST(&xs->queue);
+    if (b == NULL) {
+      if (xs->done)
+        break;
+      tvh_cond_wait(&xs->cond, &xs->lock);
+      continue;
+    }
+    TAILQ_REMOVE(&xs->queue, b, link);
+    xs->queued--;
+    tvh_cond_signal(&xs->cond, 1);
+    tvh_mutex_unlock(&xs->lock);
+    _xmltv_batch_merge(xs, b);
+    tvh_mutex_lock(&xs->lock);
+  }
+  tvh_mutex_unlock(&xs->lock);
+  return NULL;
+}
+
+static void _xmltv_stream_flush ( xmltv_stream_t *xs )
+{
+  xmltv_batch_t *b = xs->batch;
+
+  if (b == NULL || b->count == 0)
+    return;
+  xs->batch = NULL;
+  xs->elements += b->count;
+  tvh_mutex_lock(&xs->lock);
+  while (xs->queued >= XMLTV_STREAM_QUEUE)
+    tvh_cond_wait(&xs->cond, &xs->lock);
+  TAILQ_INSERT_TAIL(&xs->queue, b, link);
+  xs->queued++;
+  tvh_cond_signal(&xs->cond, 1);
+  tvh_mutex_unlock(&xs->lock);
+}
+
+static void _xmltv_stream_cb ( void *opaque, const char *name, htsmsg_t *tag )
+{
+  xmltv_stream_t *xs = opaque;
+  xmltv_stream_ele_t *e;
+  int64_t t0;
+
+  if (xs->batch == NULL)
+    xs->batch = calloc(1, sizeof(xmltv_batch_t));
+  e = &xs->batch->ele[xs->batch->count];
+  if (!strcmp(name, "programme")) {
+    t0 = getmonoclock();
+    if (_xmltv_prog_prepare(xs->mod, &xs->xpath, tag, &e->prog)) {
+      _xmltv_prog_done(&e->prog);
+      htsmsg_destroy(tag);
+      return;
+    }
+    xs->prepare += getmonoclock() - t0;
+    e->programme = 1;
+  } else if (!strcmp(name, "channel")) {
+    e->programme = 0;
+  } else {
+    htsmsg_destroy(tag);
+    return;
+  }
+  e->tag = tag;
+  if (++xs->batch->count == XMLTV_STREAM_BATCH)
+    _xmltv_stream_flush(xs);
+}
+
+static int _xmltv_stream
+  ( void *mod, int fd, epggrab_stats_t *stats )
+{
+  epggrab_module_t *m = mod;
+  htsmsg_xml_stream_t *xml;
+  xmltv_stream_t xs;
+  int64_t total = 0, mono_start, mono_progress, mono;
+  int64_t t0, t1, t_read = 0, t_feed = 0;
+  char *buf, errbuf[100];
+  ssize_t r;
+  int err = 0;
+
+  memset(&xs, 0, sizeof(xs));
+  xs.mod = m;
+  xs.stats = stats;
+  tvh_mutex_init(&xs.lock, NULL);
+  tvh_cond_init(&xs.cond, 1);
+  TAILQ_INIT(&xs.queue);
+
+  _xmltv_parse_begin(m, &xs.xpath);
+
+  tvh_thread_create(&xs.tid, NULL, _xmltv_stream_merge_thread, &xs, "xmltvmerge");
+
+  xml = htsmsg_xml_stream_create(_xmltv_stream_cb, &xs);
+  buf = malloc(XMLTV_STREAM_CHUNK);
+  mono_start = mono_progress = getfastmonoclock();
+  while (1) {
+    t0 = getmonoclock();
+    r = read(fd, buf, XMLTV_STREAM_CHUNK);
+    t1 = getmonoclock();
+    t_read += t1 - t0;
+    if (r < 0) {
+      if (ERRNO_AGAIN(errno))
+        continue;
+      tvherror(m->subsys, "%s: read error: %s", m->id, strerror(errno));
+      err = 1;
+      break;
+    }
+    if (r == 0)
+      break;
+    total += r;
+    err = htsmsg_xml_stream_feed(xml, buf, r);
+    t_feed += getmonoclock() - t1;
+    if (err)
+      break;
+    mono = getfastmonoclock();
+    if (mono - mono_progress >= sec2mono(XMLTV_STREAM_PROGRESS)) {
+      mono_progress = mono;
+      tvhinfo(m->subsys, "%s: imported %"PRId64" kB, %"PRId64" elements "
+                         "(%"PRId64" kB/s)", m->id, total / 1024,
+                         xs.elements + (xs.batch ? xs.batch->count : 0),
+                         total / 1024 / MAX(1, mono2sec(mono - mono_start)));
+    }
+  }
+  free(buf);
+
+  t0 = getmonoclock();
+  if (total > 0 && htsmsg_xml_stream_finish(xml, errbuf, sizeof(errbuf))) {
+    tvherror(m->subsys, "%s: htsmsg_xml_stream error %s", m->id, errbuf);
+    err = 1;
+  } else if (total == 0 && !err) {
+    tvherror(m->subsys, "%s: failed to read data", m->id);
+  }
+  htsmsg_xml_stream_destroy(xml);
+  t_feed += getmonoclock() - t0;
+
+  if (!err)
+    _xmltv_stream_flush(&xs);
+  if (xs.batch)
+    _xmltv_batch_free(xs.batch);
+  tvh_mutex_lock(&xs.lock);
+  xs.done = 1;
+  tvh_cond_signal(&xs.cond, 1);
+  tvh_mutex_unlock(&xs.lock);
+  pthread_join(xs.tid, NULL);
+  tvh_cond_destroy(&xs.cond);
+  tvh_mutex_destroy(&xs.lock);
+
+  _xmltv_parse_end(m, &xs.xpath, !err);
+  if (err)
+    tvherror(m->subsys, "%s: import incomplete, %"PRId64" elements before "
+                        "the error were merged", m->id, xs.elements);
+
+  _xmltv_import_stats(m, t_read, t_feed - xs.prepare, xs.prepare,
+                      xs.merge, xs.lock_max, xs.elements);
+
+  mono = getfastmonoclock();
+  tvhinfo(m->subsys, "%s: imported %"PRId64" kB, %"PRId64" elements "
+                     "(%"PRId64" kB/s)", m->id, total / 1024, xs.elements,
+                     total / 1024 / MAX(1, mono2sec(mono - mono_start)));
+  return xs.save;
+}
+
 /* ************************************************************************
  * Module Setup
  * ***********************************************************************/
@@ -1716,7 +2030,7 @@ static void _xmltv_load_grabbers ( void )
         epggrab_module_int_create(NULL, &epggrab_mod_int_xmltv_class,
                                   &outbuf[p], LS_XMLTV, "xmltv",
                                   name, 3, &outbuf[p],
-                                  NULL, _xmltv_parse, NULL);
+                                  NULL, _xmltv_parse, _xmltv_stream, NULL);
         p = n = i + 1;
       } else if ( outbuf[i] == '\\') {
         memmove(outbuf, outbuf + 1, strlen(outbuf));
@@ -1767,7 +2081,7 @@ static void _xmltv_load_grabbers ( void )
             } else {
               epggrab_module_int_create(NULL, &epggrab_mod_int_xmltv_class,
                                         bin, LS_XMLTV, "xmltv", name, 3, bin,
-                                        NULL, _xmltv_parse, NULL);
+                                        NULL, _xmltv_parse, _xmltv_stream, NULL);
             }
             free(outbuf);
           } else {
@@ -1788,7 +2102,7 @@ void xmltv_init ( void )
   /* External module */
   epggrab_module_ext_create(NULL, &epggrab_mod_ext_xmltv_class,
                             "xmltv", LS_XMLTV, "xmltv", "XMLTV", 3, "xmltv",
-                            _xmltv_parse, NULL);
+                            _xmltv_parse, _xmltv_stream, NULL);
 
   /* Standard modules */
   _xmltv_load_grabbers();
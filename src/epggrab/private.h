@@ -32,6 +32,7 @@ epggrab_module_t *epggrab_module_create
 
 char     *epggrab_module_grab_spawn ( void *m );
 htsmsg_t *epggrab_module_trans_xml  ( void *m, char *data );
+void      epggrab_module_grab_stream ( void *m );
 
 void      epggrab_module_ch_add  ( void *m, struct channel *ch );
 void      epggrab_module_ch_rem  ( void *m, struct channel *ch );
@@ -39,6 +40,7 @@ void      epggrab_module_ch_mod  ( void *m, struct channel *ch );
 void      epggrab_module_ch_save ( void *m, epggrab_channel_t *ec );
 
 void      epggrab_module_parse ( void *m, htsmsg_t *data );
+void      epggrab_module_stream ( void *m, int fd );
 
 void      epggrab_module_channels_load ( const char *modid );
 
@@ -80,6 +82,7 @@ epggrab_module_int_t *epggrab_module_int_create
     const char *path,
     char* (*grab) (void*m),
     int (*parse) (void *m, htsmsg_t *data, epggrab_stats_t *sta),
+    int (*stream) (void *m, int fd, epggrab_stats_t *sta),
     htsmsg_t* (*trans) (void *mod, char *data) );
 
 /* **************************************************************************
@@ -92,6 +95,7 @@ epggrab_module_ext_t *epggrab_module_ext_create
     const char *name, int priority,
     const char *sockid,
     int (*parse) (void *m, htsmsg_t *data, epggrab_stats_t *sta),
+    int (*stream) (void *m, int fd, epggrab_stats_t *sta),
     htsmsg_t* (*trans) (void *mod, char *data) );
 
 /* **************************************************************************
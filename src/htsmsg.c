@@ -1389,6 +1389,11 @@ htsmsg_cmp(const htsmsg_t *m1, const htsmsg_t *m2)
       if (f1->hmf_dbl != f2->hmf_dbl)
         return 1;
       break;
+
+    case HMF_UUID:
+      if (memcmp(f1->hmf_uuid, f2->hmf_uuid, UUID_BIN_SIZE))
+        return 1;
+      break;
     }
 
     f2 = TAILQ_NEXT(f2, hmf_link);
@@ -258,10 +258,13 @@ htsmsg_binary_count(htsmsg_t *msg)
 }
 
 /*
- *
+ * The data of the top level binary field pointing to 'ext' is not
+ * written, '*extp' is set to the position where it belongs instead
+ * (the following fields are written from this position).
  */
 static void
-htsmsg_binary_write(htsmsg_t *msg, uint8_t *ptr)
+htsmsg_binary_write(htsmsg_t *msg, uint8_t *ptr,
+                    const void *ext, uint8_t **extp)
 {
   htsmsg_field_t *f;
   uint64_t u64;
@@ -318,10 +321,16 @@ htsmsg_binary_write(htsmsg_t *msg, uint8_t *ptr)
       ptr += namelen;
     }
 
+    if(ext && f->hmf_type == HMF_BIN && f->hmf_bin == ext) {
+      *extp = ptr;
+      ext = NULL;
+      continue;
+    }
+
     switch(f->hmf_type) {
     case HMF_MAP:
     case HMF_LIST:
-      htsmsg_binary_write(f->hmf_msg, ptr);
+      htsmsg_binary_write(f->hmf_msg, ptr, NULL, NULL);
       break;
 
     case HMF_STR:
@@ -368,7 +377,7 @@ htsmsg_binary_serialize0(htsmsg_t *msg, void **datap, size_t *lenp, int maxlen)
 
   data = malloc(len);
 
-  htsmsg_binary_write(msg, data);
+  htsmsg_binary_write(msg, data, NULL, NULL);
   *datap = data;
   *lenp  = len;
   return 0;
@@ -394,8 +403,54 @@ htsmsg_binary_serialize(htsmsg_t *msg, void **datap, size_t *lenp, int maxlen)
   data[2] = len >> 8;
   data[3] = len;
 
-  htsmsg_binary_write(msg, data + 4);
+  htsmsg_binary_write(msg, data + 4, NULL, NULL);
   *datap = data;
   *lenp  = len + 4;
   return 0;
 }
+
+/*
+ *
+ */
+static size_t
+htsmsg_binary_ext_len(htsmsg_t *msg, const void *ext)
+{
+  htsmsg_field_t *f;
+
+  TAILQ_FOREACH(f, &msg->hm_fields, hmf_link)
+    if(f->hmf_type == HMF_BIN && f->hmf_bin == ext)
+      return f->hmf_binsize;
+  return 0;
+}
+
+/*
+ * Append the length prefixed message to the buffer
+ *
+ * If 'ext' is set, the data of the top level binary field pointing
+ * to it is left out, the caller sends it itself. '*extoff' is set to
+ * the buffer offset where it belongs (or -1 if there is no such field).
+ */
+int
+htsmsg_binary_serialize_sbuf(htsmsg_t *msg, sbuf_t *sb, int maxlen,
+                             const void *ext, int *extoff)
+{
+  size_t len;
+  uint8_t *data, *extp = NULL;
+
+  len = htsmsg_binary_count(msg);
+  if(len + 4 > maxlen)
+    return -1;
+
+  sbuf_alloc(sb, len + 4);
+  sbuf_put_be32(sb, len);
+  data = sb->sb_data + sb->sb_ptr;
+  htsmsg_binary_write(msg, data, ext, &extp);
+  if(extp) {
+    len -= htsmsg_binary_ext_len(msg, ext);
+    *extoff = extp - sb->sb_data;
+  } else if(extoff) {
+    *extoff = -1;
+  }
+  sb->sb_ptr += len;
+  return 0;
+}
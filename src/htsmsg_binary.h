@@ -20,6 +20,7 @@
 #define HTSMSG_BINARY_H_
 
 #include "htsmsg.h"
+#include "sbuf.h"
 
 /**
  * htsmsg_binary_deserialize
@@ -36,4 +37,7 @@ int htsmsg_binary_serialize0(htsmsg_t *msg, void **datap, size_t *lenp,
 int htsmsg_binary_serialize(htsmsg_t *msg, void **datap, size_t *lenp,
 			    int maxlen);
 
+int htsmsg_binary_serialize_sbuf(htsmsg_t *msg, sbuf_t *sb, int maxlen,
+                                 const void *ext, int *extoff);
+
 #endif /* HTSMSG_BINARY_H_ */
@@ -274,6 +274,22 @@ htsmsg_binary2_deserialize
   return 0;
 }
 
+/*
+ * Get the size of the next serialized message without decoding it
+ */
+int
+htsmsg_binary2_message_size(const void *data, size_t len, size_t *msglen)
+{
+  const uint8_t *p = data;
+  uint32_t l;
+
+  if (len != (len & 0xffffffff) || len == 0)
+    return -1;
+  l = htsmsg_binary2_get_length(&p, data + len);
+  *msglen = l + (p - (uint8_t *)data);
+  return *msglen > len ? -1 : 0;
+}
+
 /*
  *
  */
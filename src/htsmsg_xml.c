@@ -54,6 +54,7 @@
 
 #include "htsmsg_xml.h"
 #include "htsbuf.h"
+#include "sbuf.h"
 
 TAILQ_HEAD(cdata_content_queue, cdata_content);
 
@@ -858,6 +859,294 @@ htsmsg_xml_deserialize(char *src, char *errbuf, size_t errbufsize)
   return NULL;
 }
 
+/* **************************************************************************
+ * Streaming parser
+ *
+ * The document is fed in chunks, the direct children of the root
+ * element are parsed one by one as soon as they are complete and
+ * passed to the callback. Only the current child element is kept
+ * in memory. The namespaces declared in the root element are not
+ * resolved for the children.
+ * *************************************************************************/
+
+enum {
+  XS_PROLOG,
+  XS_ROOT,
+  XS_DONE,
+  XS_ERROR
+};
+
+struct htsmsg_xml_stream {
+  xmlparser_t xs_xp;
+  sbuf_t xs_buf;
+  int    xs_state;
+  int    xs_depth;
+  int    xs_pos;      /* scan position in xs_buf */
+  int    xs_start;    /* start of the current child element or -1 */
+  htsmsg_xml_stream_cb_t xs_cb;
+  void  *xs_opaque;
+};
+
+/**
+ *
+ */
+htsmsg_xml_stream_t *
+htsmsg_xml_stream_create(htsmsg_xml_stream_cb_t cb, void *opaque)
+{
+  htsmsg_xml_stream_t *xs = calloc(1, sizeof(*xs));
+
+  xs->xs_xp.xp_encoding = XML_ENCODING_UTF8;
+  LIST_INIT(&xs->xs_xp.xp_namespaces);
+  sbuf_init(&xs->xs_buf);
+  xs->xs_state = XS_PROLOG;
+  xs->xs_start = -1;
+  xs->xs_cb = cb;
+  xs->xs_opaque = opaque;
+  return xs;
+}
+
+/**
+ *
+ */
+void
+htsmsg_xml_stream_destroy(htsmsg_xml_stream_t *xs)
+{
+  if (xs == NULL)
+    return;
+  sbuf_free(&xs->xs_buf);
+  free(xs);
+}
+
+/**
+ * Find the end of the pattern, NULL if more data are required
+ */
+static char *
+xml_stream_find(char *s, char *e, const char *pat, int patlen)
+{
+  for (e -= patlen - 1; s < e; s++) {
+    if ((s = memchr(s, pat[0], e - s)) == NULL)
+      return NULL;
+    if (!memcmp(s, pat, patlen))
+      return s + patlen;
+  }
+  return NULL;
+}
+
+/**
+ * Find the end of the tag (after '>'), skip the quoted attribute values
+ */
+static char *
+xml_stream_tag_end(char *s, char *e)
+{
+  char quote = 0;
+
+  for ( ; s < e; s++) {
+    if (quote) {
+      if (*s == quote)
+        quote = 0;
+    } else if (*s == '"' || *s == '\'') {
+      quote = *s;
+    } else if (*s == '>') {
+      return s + 1;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Find the end of <!DOCTYPE ...> including the internal subset
+ */
+static char *
+xml_stream_decl_end(char *s, char *e)
+{
+  int depth = 0;
+
+  for ( ; s < e; s++) {
+    if (*s == '[')
+      depth++;
+    else if (*s == ']')
+      depth--;
+    else if (*s == '>' && depth <= 0)
+      return s + 1;
+  }
+  return NULL;
+}
+
+/**
+ * Pick the encoding from the prolog
+ */
+static void
+xml_stream_prolog(htsmsg_xml_stream_t *xs, const char *src, int len)
+{
+  char *s = malloc(len + 1), *p = s;
+
+  memcpy(s, src, len);
+  s[len] = '\0';
+  if ((uint8_t)p[0] == 0xef && (uint8_t)p[1] == 0xbb && (uint8_t)p[2] == 0xbf)
+    p += 3;
+  htsmsg_parse_prolog(&xs->xs_xp, p);
+  xs->xs_xp.xp_srcdataused = 0;
+  free(s);
+}
+
+/**
+ * Parse one complete child element and pass it to the callback
+ */
+static int
+xml_stream_element(htsmsg_xml_stream_t *xs, const char *start, const char *end)
+{
+  htsmsg_field_t *f;
+  htsmsg_t *m, *tag;
+  int len = end - start;
+  char *src = malloc(len + 1);
+
+  memcpy(src, start, len);
+  src[len] = '\0';
+
+  m = htsmsg_create_map();
+  xs->xs_xp.xp_srcdataused = 0;
+  if (htsmsg_xml_parse_tag(&xs->xs_xp, m, src + 1) == NULL ||
+      (f = TAILQ_FIRST(&m->hm_fields)) == NULL) {
+    htsmsg_destroy(m);
+    free(src);
+    return -1;
+  }
+
+  tag = htsmsg_detach_submsg(f);
+  if (xs->xs_xp.xp_srcdataused) {
+    tag->hm_data = src;
+    tag->hm_data_size = len + 1;
+    src = NULL;
+  }
+  xs->xs_cb(xs->xs_opaque, htsmsg_field_name(f), tag);
+  htsmsg_destroy(m);
+  free(src);
+  return 0;
+}
+
+/**
+ *
+ */
+static int
+xml_stream_scan(htsmsg_xml_stream_t *xs)
+{
+  char *buf = (char *)xs->xs_buf.sb_data;
+  char *e = buf + xs->xs_buf.sb_ptr;
+  char *s, *t;
+  int empty;
+
+  while (xs->xs_state == XS_PROLOG || xs->xs_state == XS_ROOT) {
+    s = buf + xs->xs_pos;
+    if ((s = memchr(s, '<', e - s)) == NULL) {
+      xs->xs_pos = e - buf;
+      break;
+    }
+    xs->xs_pos = s - buf;
+    if (e - s < 4)
+      break;
+
+    if (s[1] == '!') {
+      if (s[2] == '-' && s[3] == '-')
+        t = xml_stream_find(s + 4, e, "-->", 3);
+      else if (s[2] == '[')
+        t = xml_stream_find(s + 3, e, "]]>", 3);
+      else
+        t = xml_stream_decl_end(s + 2, e);
+    } else if (s[1] == '?') {
+      t = xml_stream_find(s + 2, e, "?>", 2);
+    } else if (s[1] == '/') {
+      if ((t = memchr(s, '>', e - s)) == NULL)
+        break;
+      t++;
+      if (--xs->xs_depth == 1 && xs->xs_start >= 0) {
+        if (xml_stream_element(xs, buf + xs->xs_start, t))
+          goto err;
+        xs->xs_start = -1;
+      } else if (xs->xs_depth <= 0) {
+        xs->xs_state = XS_DONE;
+      }
+    } else {
+      if ((t = xml_stream_tag_end(s + 1, e)) == NULL)
+        break;
+      empty = t[-2] == '/';
+      if (xs->xs_state == XS_PROLOG) {
+        xml_stream_prolog(xs, buf, s - buf);
+        xs->xs_state = empty ? XS_DONE : XS_ROOT;
+        xs->xs_depth = 1;
+      } else if (xs->xs_depth == 1) {
+        if (empty) {
+          if (xml_stream_element(xs, s, t))
+            goto err;
+        } else {
+          xs->xs_start = s - buf;
+          xs->xs_depth++;
+        }
+      } else if (!empty) {
+        xs->xs_depth++;
+      }
+    }
+    if (t == NULL)
+      break;
+    xs->xs_pos = t - buf;
+  }
+  return 0;
+
+err:
+  xs->xs_state = XS_ERROR;
+  return -1;
+}
+
+/**
+ * Feed the next chunk of the document
+ */
+int
+htsmsg_xml_stream_feed(htsmsg_xml_stream_t *xs, const void *data, size_t len)
+{
+  int off;
+
+  if (xs->xs_state == XS_ERROR)
+    return -1;
+  if (xs->xs_state == XS_DONE)
+    return 0;
+
+  sbuf_append(&xs->xs_buf, data, len);
+  if (xml_stream_scan(xs))
+    return -1;
+
+  /* Drop the processed data, keep the prolog until the root element */
+  if (xs->xs_state == XS_ROOT) {
+    off = xs->xs_start >= 0 ? xs->xs_start : xs->xs_pos;
+    if (off > 0) {
+      sbuf_cut(&xs->xs_buf, off);
+      xs->xs_pos -= off;
+      if (xs->xs_start >= 0)
+        xs->xs_start -= off;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Check that the whole document was received
+ */
+int
+htsmsg_xml_stream_finish
+  (htsmsg_xml_stream_t *xs, char *errbuf, size_t errbufsize)
+{
+  if (xs->xs_state == XS_DONE)
+    return 0;
+  if (xs->xs_state != XS_ERROR)
+    xmlerr(&xs->xs_xp, "Unexpected end of file");
+  snprintf(errbuf, errbufsize, "%s", xs->xs_xp.xp_errmsg);
+
+  /* Remove any odd chars inside of errmsg */
+  for ( ; *errbuf; errbuf++)
+    if (*errbuf < ' ')
+      *errbuf = ' ';
+
+  return -1;
+}
+
 /*
  * Get cdata string field
  */
@@ -23,6 +23,20 @@
 #include "htsbuf.h"
 
 htsmsg_t *htsmsg_xml_deserialize(char *src, char *errbuf, size_t errbufsize);
+
+/*
+ * Streaming parser, the callback receives the direct children
+ * of the root element (the callback owns 'tag', 'name' is valid
+ * only until 'tag' is destroyed)
+ */
+typedef struct htsmsg_xml_stream htsmsg_xml_stream_t;
+typedef void (*htsmsg_xml_stream_cb_t)(void *opaque, const char *name, htsmsg_t *tag);
+
+htsmsg_xml_stream_t *htsmsg_xml_stream_create(htsmsg_xml_stream_cb_t cb, void *opaque);
+void htsmsg_xml_stream_destroy(htsmsg_xml_stream_t *xs);
+int htsmsg_xml_stream_feed(htsmsg_xml_stream_t *xs, const void *data, size_t len);
+int htsmsg_xml_stream_finish(htsmsg_xml_stream_t *xs, char *errbuf, size_t errbufsize);
+
 const char *htsmsg_xml_get_cdata_str (htsmsg_t *tags, const char *tag);
 int htsmsg_xml_get_cdata_u32 (htsmsg_t *tags, const char *tag, uint32_t *u32);
 const char *htsmsg_xml_get_attr_str(htsmsg_t *tag, const char *attr);
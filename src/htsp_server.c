@@ -18,6 +18,7 @@
 
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 
 #include "tvheadend.h"
 #include "atomic.h"
@@ -79,8 +80,9 @@ const char * _htsp_get_subscription_status(int smcode);
 static void htsp_epg_send_waiting(struct htsp_connection *, int64_t mintime);
 
 static streaming_ops_t htsp_streaming_input_ops = {
-  .st_cb   = htsp_streaming_input,
-  .st_info = htsp_streaming_input_info
+  .st_cb    = htsp_streaming_input,
+  .st_info  = htsp_streaming_input_info,
+  .st_batch = 1
 };
 
 /**
@@ -97,8 +99,29 @@ typedef struct htsp_msg {
 			   hm_msg can contain messages that points
 			   to packet payload so to avoid copy we
 			   keep a reference here */
+
+  pktbuf_t *hm_data;    /* Already serialized message (hm_msg is NULL),
+			   shared by all connections receiving the
+			   same async notification */
 } htsp_msg_t;
 
+/**
+ * Async notifications serialized once per broadcast. A message common
+ * to all connections is serialized before the loop, the messages built
+ * per connection are matched against the few recently serialized ones.
+ */
+#define HTSP_ASYNC_CACHE_SIZE 4
+
+typedef struct htsp_async_cache {
+  htsmsg_t *hac_msg;
+  pktbuf_t *hac_data;
+  int hac_count;
+  struct {
+    htsmsg_t *msg;
+    pktbuf_t *data;
+  } hac_entries[HTSP_ASYNC_CACHE_SIZE];
+} htsp_async_cache_t;
+
 
 /**
  *
@@ -152,6 +175,8 @@ typedef struct htsp_connection {
   tvh_mutex_t htsp_out_mutex;
   tvh_cond_t htsp_out_cond;
 
+  sbuf_t htsp_wbuf;    /* Serialized messages for one writev() */
+
   htsp_msg_q_t htsp_hmq_ctrl;
   htsp_msg_q_t htsp_hmq_epg;
   htsp_msg_q_t htsp_hmq_qstatus;
@@ -298,6 +323,8 @@ htsp_msg_destroy(htsp_msg_t *hm)
   htsmsg_destroy(hm->hm_msg);
   if(hm->hm_pb != NULL)
     pktbuf_ref_dec(hm->hm_pb);
+  if(hm->hm_data != NULL)
+    pktbuf_ref_dec(hm->hm_data);
   free(hm);
 }
 
@@ -413,17 +440,9 @@ htsp_subscription_free(htsp_connection_t *htsp, htsp_subscription_t *hs)
  *
  */
 static void
-htsp_send(htsp_connection_t *htsp, htsmsg_t *m, pktbuf_t *pb,
-	  htsp_msg_q_t *hmq, int payloadsize)
+htsp_send_msg(htsp_connection_t *htsp, htsp_msg_t *hm,
+	      htsp_msg_q_t *hmq, int payloadsize)
 {
-  htsp_msg_t *hm = malloc(sizeof(htsp_msg_t));
-
-  hm->hm_msg = m;
-  hm->hm_pb = pb;
-  if(pb != NULL)
-    pktbuf_ref_inc(pb);
-  hm->hm_payloadsize = payloadsize;
-
   tvh_mutex_lock(&htsp->htsp_out_mutex);
 
   assert(!hmq->hmq_dead);
@@ -446,6 +465,25 @@ htsp_send(htsp_connection_t *htsp, htsmsg_t *m, pktbuf_t *pb,
   tvh_mutex_unlock(&htsp->htsp_out_mutex);
 }
 
+/**
+ *
+ */
+static void
+htsp_send(htsp_connection_t *htsp, htsmsg_t *m, pktbuf_t *pb,
+	  htsp_msg_q_t *hmq, int payloadsize)
+{
+  htsp_msg_t *hm = malloc(sizeof(htsp_msg_t));
+
+  hm->hm_msg = m;
+  hm->hm_pb = pb;
+  if(pb != NULL)
+    pktbuf_ref_inc(pb);
+  hm->hm_data = NULL;
+  hm->hm_payloadsize = payloadsize;
+
+  htsp_send_msg(htsp, hm, hmq, payloadsize);
+}
+
 /**
  *
  */
@@ -481,6 +519,113 @@ htsp_send_message(htsp_connection_t *htsp, htsmsg_t *m, htsp_msg_q_t *hmq)
   htsp_send(htsp, m, NULL, hmq ?: &htsp->htsp_hmq_ctrl, 0);
 }
 
+/**
+ * Serialize an async notification
+ */
+static pktbuf_t *
+htsp_async_serialize(htsmsg_t *m)
+{
+  void *dptr;
+  size_t dlen;
+
+  if (htsmsg_binary_serialize(m, &dptr, &dlen, INT32_MAX) != 0) {
+    tvhwarn(LS_HTSP, "failed to serialize async message");
+    return NULL;
+  }
+  return pktbuf_make(dptr, dlen);
+}
+
+/**
+ * Start a broadcast, 'm' (if not NULL) is common to all connections
+ * and it is serialized once. Takes 'm'.
+ */
+static void
+htsp_async_cache_init(htsp_async_cache_t *hac, htsmsg_t *m)
+{
+  memset(hac, 0, sizeof(*hac));
+  if (m) {
+    hac->hac_msg = m;
+    hac->hac_data = htsp_async_serialize(m);
+  }
+}
+
+/**
+ * Send an async notification, the binary form is shared with the
+ * other connections which get an identical message. Takes 'm',
+ * NULL sends the common message.
+ */
+static void
+htsp_async_cache_send(htsp_async_cache_t *hac, htsp_connection_t *htsp,
+                      htsmsg_t *m)
+{
+  htsp_msg_t *hm;
+  pktbuf_t *pb = NULL;
+  int i;
+
+  if (m == NULL) {
+    if ((pb = hac->hac_data) == NULL)
+      return;
+    if (tvhtrace_enabled())
+      htsp_trace(htsp, LS_HTSP_ANS, "answer", hac->hac_msg);
+    pktbuf_ref_inc(pb);
+    goto queue;
+  }
+
+  if (tvhtrace_enabled())
+    htsp_trace(htsp, LS_HTSP_ANS, "answer", m);
+
+  for (i = 0; i < hac->hac_count; i++)
+    if (htsmsg_cmp(hac->hac_entries[i].msg, m) == 0) {
+      pb = hac->hac_entries[i].data;
+      pktbuf_ref_inc(pb);
+      break;
+    }
+
+  if (pb == NULL) {
+    if ((pb = htsp_async_serialize(m)) == NULL) {
+      htsmsg_destroy(m);
+      return;
+    }
+    if (hac->hac_count < HTSP_ASYNC_CACHE_SIZE) {
+      hac->hac_entries[hac->hac_count].msg = m;
+      hac->hac_entries[hac->hac_count].data = pb;
+      hac->hac_count++;
+      pktbuf_ref_inc(pb);
+      m = NULL;
+    }
+  }
+  htsmsg_destroy(m);
+
+queue:
+  hm = malloc(sizeof(htsp_msg_t));
+  hm->hm_msg = NULL;
+  hm->hm_pb = NULL;
+  hm->hm_data = pb;
+  hm->hm_payloadsize = 0;
+
+  htsp_send_msg(htsp, hm, &htsp->htsp_hmq_ctrl, 0);
+}
+
+/**
+ *
+ */
+static void
+htsp_async_cache_done(htsp_async_cache_t *hac)
+{
+  int i;
+
+  for (i = 0; i < hac->hac_count; i++) {
+    htsmsg_destroy(hac->hac_entries[i].msg);
+    pktbuf_ref_dec(hac->hac_entries[i].data);
+  }
+  hac->hac_count = 0;
+  htsmsg_destroy(hac->hac_msg);
+  hac->hac_msg = NULL;
+  if (hac->hac_data)
+    pktbuf_ref_dec(hac->hac_data);
+  hac->hac_data = NULL;
+}
+
 /**
  * Simple function to respond with an error
  */
@@ -3483,56 +3628,138 @@ send_reply_with_unlock:
 }
 
 /**
- *
+ * Take the next message to be sent, htsp_out_mutex is held
+ */
+static htsp_msg_t *
+htsp_write_dequeue(htsp_connection_t *htsp)
+{
+  htsp_msg_q_t *hmq;
+  htsp_msg_t *hm;
+
+  if((hmq = TAILQ_FIRST(&htsp->htsp_active_output_queues)) == NULL)
+    return NULL;
+
+  hm = TAILQ_FIRST(&hmq->hmq_q);
+  TAILQ_REMOVE(&hmq->hmq_q, hm, hm_link);
+  hmq->hmq_length--;
+  hmq->hmq_payload -= hm->hm_payloadsize;
+
+  TAILQ_REMOVE(&htsp->htsp_active_output_queues, hmq, hmq_link);
+  if(hmq->hmq_length) {
+    /* Still messages to be sent, put back in active queues */
+    if(hmq->hmq_strict_prio) {
+      TAILQ_INSERT_HEAD(&htsp->htsp_active_output_queues, hmq, hmq_link);
+    } else {
+      TAILQ_INSERT_TAIL(&htsp->htsp_active_output_queues, hmq, hmq_link);
+    }
+  }
+  return hm;
+}
+
+/**
+ * The writer takes all messages which are already queued (up to
+ * the limits below) and passes them to the kernel using one writev().
+ * It never waits for more messages, so the live latency is not
+ * affected.
  */
+#define HTSP_WRITE_MAX_MSGS  64
+#define HTSP_WRITE_MAX_BYTES (256*1024)
+
+/**
+ * Add a part of the connection buffer to the vector, consecutive
+ * parts share one entry
+ */
+static inline void
+htsp_write_iov(htsp_connection_t *htsp, struct iovec *iov, int *iovcnt,
+               int *end, int off, int len)
+{
+  if (len <= 0)
+    return;
+  if (*end == off) {
+    iov[*iovcnt-1].iov_len += len;
+  } else {
+    iov[*iovcnt].iov_base = htsp->htsp_wbuf.sb_data + off;
+    iov[*iovcnt].iov_len  = len;
+    (*iovcnt)++;
+  }
+  *end = off + len;
+}
+
 static void *
 htsp_write_scheduler(void *aux)
 {
   htsp_connection_t *htsp = aux;
-  htsp_msg_q_t *hmq;
-  htsp_msg_t *hm;
-  void *dptr;
-  size_t dlen;
-  int r;
+  htsp_msg_t *hm, *hms[HTSP_WRITE_MAX_MSGS];
+  struct iovec iov[3 * HTSP_WRITE_MAX_MSGS];
+  int offs[HTSP_WRITE_MAX_MSGS], lens[HTSP_WRITE_MAX_MSGS];
+  int exts[HTSP_WRITE_MAX_MSGS];
+  size_t bytes;
+  int i, cnt, iovcnt, end, r;
 
   tvh_mutex_lock(&htsp->htsp_out_mutex);
 
   while(htsp->htsp_writer_run) {
 
-    if((hmq = TAILQ_FIRST(&htsp->htsp_active_output_queues)) == NULL) {
+    if((hm = htsp_write_dequeue(htsp)) == NULL) {
       /* Nothing to be done, go to sleep */
       tvh_cond_wait(&htsp->htsp_out_cond, &htsp->htsp_out_mutex);
       continue;
     }
 
-    hm = TAILQ_FIRST(&hmq->hmq_q);
-    TAILQ_REMOVE(&hmq->hmq_q, hm, hm_link);
-    hmq->hmq_length--;
-    hmq->hmq_payload -= hm->hm_payloadsize;
-
-    TAILQ_REMOVE(&htsp->htsp_active_output_queues, hmq, hmq_link);
-    if(hmq->hmq_length) {
-      /* Still messages to be sent, put back in active queues */
-      if(hmq->hmq_strict_prio) {
-        TAILQ_INSERT_HEAD(&htsp->htsp_active_output_queues, hmq, hmq_link);
-      } else {
-        TAILQ_INSERT_TAIL(&htsp->htsp_active_output_queues, hmq, hmq_link);
-      }
+    cnt = 0;
+    bytes = 0;
+    while (1) {
+      hms[cnt++] = hm;
+      bytes += hm->hm_payloadsize + pktbuf_len(hm->hm_data);
+      if (cnt >= HTSP_WRITE_MAX_MSGS || bytes >= HTSP_WRITE_MAX_BYTES)
+        break;
+      if ((hm = htsp_write_dequeue(htsp)) == NULL)
+        break;
     }
 
     tvh_mutex_unlock(&htsp->htsp_out_mutex);
 
-    if (htsmsg_binary_serialize(hm->hm_msg, &dptr, &dlen, INT32_MAX) != 0) {
-      tvhwarn(LS_HTSP, "%s: failed to serialize data", htsp->htsp_logname);
-      htsp_msg_destroy(hm);
-      tvh_mutex_lock(&htsp->htsp_out_mutex);
-      continue;
+    /* Serialize into the connection buffer, remember the offsets
+       (the buffer may be reallocated meanwhile); the packet payload
+       is not copied, it's sent from the packet buffer */
+    sbuf_reset(&htsp->htsp_wbuf, 2 * HTSP_WRITE_MAX_BYTES);
+    for (i = 0; i < cnt; i++) {
+      hm = hms[i];
+      offs[i] = htsp->htsp_wbuf.sb_ptr;
+      exts[i] = -1;
+      if (hm->hm_data == NULL &&
+          htsmsg_binary_serialize_sbuf(hm->hm_msg, &htsp->htsp_wbuf, INT32_MAX,
+                                       hm->hm_pb ? pktbuf_ptr(hm->hm_pb) : NULL,
+                                       &exts[i]) != 0)
+        tvhwarn(LS_HTSP, "%s: failed to serialize data", htsp->htsp_logname);
+      lens[i] = htsp->htsp_wbuf.sb_ptr - offs[i];
     }
 
-    htsp_msg_destroy(hm);
+    for (i = iovcnt = 0, end = -1; i < cnt; i++) {
+      hm = hms[i];
+      if (hm->hm_data) {
+        /* shared async notification, serialized already */
+        iov[iovcnt].iov_base = pktbuf_ptr(hm->hm_data);
+        iov[iovcnt].iov_len  = pktbuf_len(hm->hm_data);
+        iovcnt++;
+        end = -1;
+      } else if (exts[i] >= 0) {
+        htsp_write_iov(htsp, iov, &iovcnt, &end, offs[i], exts[i] - offs[i]);
+        iov[iovcnt].iov_base = pktbuf_ptr(hm->hm_pb);
+        iov[iovcnt].iov_len  = pktbuf_len(hm->hm_pb);
+        iovcnt++;
+        end = -1;
+        htsp_write_iov(htsp, iov, &iovcnt, &end, exts[i], offs[i] + lens[i] - exts[i]);
+      } else {
+        htsp_write_iov(htsp, iov, &iovcnt, &end, offs[i], lens[i]);
+      }
+    }
+
+    r = iovcnt ? tvh_writev(htsp->htsp_fd, iov, iovcnt) : 0;
+
+    for (i = 0; i < cnt; i++)
+      htsp_msg_destroy(hms[i]);
 
-    r = tvh_write(htsp->htsp_fd, dptr, dlen);
-    free(dptr);
     tvh_mutex_lock(&htsp->htsp_out_mutex);
 
     if (r) {
@@ -3627,6 +3854,7 @@ htsp_serve(int fd, void **opaque, struct sockaddr_storage *source,
   tvh_mutex_unlock(&htsp.htsp_out_mutex);
 
   pthread_join(htsp.htsp_writer_thread, NULL);
+  sbuf_free(&htsp.htsp_wbuf);
 
   while((s = LIST_FIRST(&htsp.htsp_dead_subscriptions)) != NULL)
     htsp_subscription_free(&htsp, s);
@@ -3725,12 +3953,14 @@ static void
 htsp_async_send(htsmsg_t *m, int mode, void *aux)
 {
   htsp_connection_t *htsp;
+  htsp_async_cache_t hac;
 
   lock_assert(&global_lock);
+  htsp_async_cache_init(&hac, m);
   LIST_FOREACH(htsp, &htsp_async_connections, htsp_async_link)
     if (htsp->htsp_async_mode & mode)
-      htsp_send_message(htsp, htsmsg_copy(m), NULL);
-  htsmsg_destroy(m);
+      htsp_async_cache_send(&hac, htsp, NULL);
+  htsp_async_cache_done(&hac);
 }
 
 /**
@@ -3742,6 +3972,7 @@ static void
 htsp_async_send_cb(http_async_send_cb_t cb, int mode, void *aux)
 {
   htsp_connection_t *htsp;
+  htsp_async_cache_t hac = { 0 };
   htsmsg_t *m;
 
   lock_assert(&global_lock);
@@ -3749,8 +3980,9 @@ htsp_async_send_cb(http_async_send_cb_t cb, int mode, void *aux)
     if (htsp->htsp_async_mode & mode) {
       m = cb(htsp, aux);
       if (m != NULL)
-        htsp_send_message(htsp, m, NULL);
+        htsp_async_cache_send(&hac, htsp, m);
     }
+  htsp_async_cache_done(&hac);
 }
 
 /**
@@ -3760,15 +3992,17 @@ static void
 _htsp_channel_update(channel_t *ch, const char *method, htsmsg_t *msg)
 {
   htsp_connection_t *htsp;
+  htsp_async_cache_t hac;
+  htsp_async_cache_init(&hac, msg);
   LIST_FOREACH(htsp, &htsp_async_connections, htsp_async_link) {
     if (htsp->htsp_async_mode & HTSP_ASYNC_ON)
       if (htsp_user_access_channel(htsp,ch)) {
-        htsmsg_t *m = msg ? htsmsg_copy(msg)
+        htsmsg_t *m = msg ? NULL
                         : htsp_build_channel(ch, method, htsp);
-        htsp_send_message(htsp, m, NULL);
+        htsp_async_cache_send(&hac, htsp, m);
       }
   }
-  htsmsg_destroy(msg);
+  htsp_async_cache_done(&hac);
 }
 
 /**
@@ -3876,15 +4110,17 @@ static void
 _htsp_dvr_entry_update(dvr_entry_t *de, const char *method, htsmsg_t *msg)
 {
   htsp_connection_t *htsp;
+  htsp_async_cache_t hac;
+  htsp_async_cache_init(&hac, msg);
   LIST_FOREACH(htsp, &htsp_async_connections, htsp_async_link) {
     if (htsp->htsp_async_mode & HTSP_ASYNC_ON)
       if (!dvr_entry_verify(de, htsp->htsp_granted_access, 1)) {
-        htsmsg_t *m = msg ? htsmsg_copy(msg)
+        htsmsg_t *m = msg ? NULL
                         : htsp_build_dvrentry(htsp, de, method, htsp->htsp_language, 0);
-        htsp_send_message(htsp, m, NULL);
+        htsp_async_cache_send(&hac, htsp, m);
       }
   }
-  htsmsg_destroy(msg);
+  htsp_async_cache_done(&hac);
 }
 
 /**
@@ -3912,14 +4148,16 @@ void
 htsp_dvr_entry_update_stats(dvr_entry_t *de)
 {
   htsp_connection_t *htsp;
+  htsp_async_cache_t hac = { 0 };
   LIST_FOREACH(htsp, &htsp_async_connections, htsp_async_link) {
     if (htsp->htsp_async_mode & HTSP_ASYNC_ON){
       if (!dvr_entry_verify(de, htsp->htsp_granted_access, 1)) {
         htsmsg_t *m = htsp_build_dvrentry(htsp, de, "dvrEntryUpdate", htsp->htsp_language, htsp->htsp_version <= 25 ? 0 : 1);
-        htsp_send_message(htsp, m, NULL);
+        htsp_async_cache_send(&hac, htsp, m);
       }
     }
   }
+  htsp_async_cache_done(&hac);
 }
 
 /**
@@ -3941,16 +4179,18 @@ static void
 _htsp_autorec_entry_update(dvr_autorec_entry_t *dae, const char *method, htsmsg_t *msg)
 {
   htsp_connection_t *htsp;
+  htsp_async_cache_t hac;
+  htsp_async_cache_init(&hac, msg);
   LIST_FOREACH(htsp, &htsp_async_connections, htsp_async_link) {
     if (htsp->htsp_async_mode & HTSP_ASYNC_ON) {
       if (!dvr_autorec_entry_verify(dae, htsp->htsp_granted_access, 1)) {
-        htsmsg_t *m = msg ? htsmsg_copy(msg)
+        htsmsg_t *m = msg ? NULL
                           : htsp_build_autorecentry(htsp, dae, method);
-        htsp_send_message(htsp, m, NULL);
+        htsp_async_cache_send(&hac, htsp, m);
       }
     }
   }
-  htsmsg_destroy(msg);
+  htsp_async_cache_done(&hac);
 }
 
 /**
@@ -3995,16 +4235,18 @@ static void
 _htsp_timerec_entry_update(dvr_timerec_entry_t *dte, const char *method, htsmsg_t *msg)
 {
   htsp_connection_t *htsp;
+  htsp_async_cache_t hac;
+  htsp_async_cache_init(&hac, msg);
   LIST_FOREACH(htsp, &htsp_async_connections, htsp_async_link) {
     if (htsp->htsp_async_mode & HTSP_ASYNC_ON) {
       if (!dvr_timerec_entry_verify(dte, htsp->htsp_granted_access, 1)) {
-        htsmsg_t *m = msg ? htsmsg_copy(msg)
+        htsmsg_t *m = msg ? NULL
                           : htsp_build_timerecentry(htsp, dte, method);
-        htsp_send_message(htsp, m, NULL);
+        htsp_async_cache_send(&hac, htsp, m);
       }
     }
   }
-  htsmsg_destroy(msg);
+  htsp_async_cache_done(&hac);
 }
 
 /**
@@ -4090,20 +4332,22 @@ static void
 _htsp_event_update(epg_broadcast_t *ebc, const char *method, htsmsg_t *msg)
 {
   htsp_connection_t *htsp;
+  htsp_async_cache_t hac;
+  htsp_async_cache_init(&hac, msg);
   LIST_FOREACH(htsp, &htsp_async_connections, htsp_async_link) {
     if (htsp->htsp_async_mode & HTSP_ASYNC_EPG) {
       /* Use last update instead of window time as we do not want to push an update
        * for an event we still have to send with "htsp_epg_window_cb" */
       if (!htsp->htsp_epg_window || ebc->start <= htsp->htsp_epg_lastupdate) {
         if (htsp_user_access_channel(htsp,ebc->channel)) {
-          htsmsg_t *m = msg ? htsmsg_copy(msg)
+          htsmsg_t *m = msg ? NULL
                           : htsp_build_event(ebc, method, htsp->htsp_language, 0, htsp);
-          htsp_send_message(htsp, m, NULL);
+          htsp_async_cache_send(&hac, htsp, m);
         }
       }
     }
   }
-  htsmsg_destroy(msg);
+  htsp_async_cache_done(&hac);
 }
 
 /**
@@ -4575,6 +4819,8 @@ htsp_subscription_timeshift_status(htsp_subscription_t *hs, timeshift_status_t *
     htsmsg_add_s64(m, "start", hs->hs_90khz ? status->pts_start : ts_rescale(status->pts_start, 1000000)) ;
   if (status->pts_end != PTS_UNSET)
     htsmsg_add_s64(m, "end", hs->hs_90khz ? status->pts_end : ts_rescale(status->pts_end, 1000000)) ;
+  if (status->seek_time > 0)
+    htsmsg_add_s64(m, "seekTime", status->seek_time);
   htsp_send_subscription(hs->hs_htsp, m, NULL, hs, 0);
 }
 #endif
@@ -4616,14 +4862,24 @@ static void
 htsp_streaming_input(void *opaque, streaming_message_t *sm)
 {
   htsp_subscription_t *hs = opaque;
+  streaming_pkt_batch_t *spb;
+  int i;
 
   switch(sm->sm_type) {
   case SMT_PACKET:
+  case SMT_PACKET_BATCH:
     if (hs->hs_wait_for_video)
       break;
     if (!hs->hs_first)
       tvhdebug(LS_HTSP, "%s - first packet", hs->hs_htsp->htsp_logname);
     hs->hs_first = 1;
+    if (sm->sm_type == SMT_PACKET_BATCH) {
+      spb = sm->sm_data;
+      for (i = 0; i < spb->spb_count; i++)
+        htsp_stream_deliver(hs, spb->spb_pkts[i]);
+      spb->spb_count = 0;
+      break;
+    }
     htsp_stream_deliver(hs, sm->sm_data);
     // reference is transferred
     sm->sm_data = NULL;
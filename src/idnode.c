@@ -1099,6 +1099,219 @@ idnode_set_sort
   tvh_qsort_r(is->is_array, is->is_count, sizeof(idnode_t*), idnode_cmp_sort, (void*)sort);
 }
 
+/*
+ * Sort keys are read once per node (the property getters are not called
+ * for each comparison), the equal keys keep the set order
+ */
+typedef struct idnode_sort_key {
+  idnode_t *in;
+  size_t    idx;
+  union {
+    char   *str;
+    int64_t s64;
+    double  dbl;
+  } u;
+} idnode_sort_key_t;
+
+typedef struct idnode_sort_keys {
+  enum {
+    ISK_NONE,
+    ISK_STR,
+    ISK_S64,
+    ISK_DBL
+  }  type;
+  int dir;
+} idnode_sort_keys_t;
+
+static int
+idnode_sort_key_type ( const property_t *p )
+{
+  if (p->islist || (p->list && !(p->opts & PO_SORTKEY)))
+    return ISK_STR;
+  switch (p->type) {
+    case PT_STR:
+      return ISK_STR;
+    case PT_INT:
+    case PT_DYN_INT:
+    case PT_U16:
+    case PT_BOOL:
+    case PT_PERM:
+    case PT_U32:
+    case PT_S64:
+    case PT_S64_ATOMIC:
+    case PT_TIME:
+      return ISK_S64;
+    case PT_DBL:
+      return ISK_DBL;
+    case PT_LANGSTR:
+    case PT_NONE:
+      break;
+  }
+  return ISK_NONE;
+}
+
+static void
+idnode_sort_key_get
+  ( idnode_sort_key_t *k, int type, const char *key, const char *lang )
+{
+  const property_t *p = idnode_find_prop(k->in, key);
+  const char *s;
+  int32_t i32 = 0;
+  uint32_t u32 = 0;
+  time_t t = 0;
+
+  memset(&k->u, 0, sizeof(k->u));
+  if (p == NULL || idnode_sort_key_type(p) != type)
+    return;
+  switch (type) {
+    case ISK_STR:
+      if (p->islist || p->list)
+        k->u.str = idnode_get_display(k->in, p, lang);
+      else if ((s = idnode_get_str(k->in, key)) != NULL)
+        k->u.str = strdup(s);
+      break;
+    case ISK_S64:
+      switch (p->type) {
+        case PT_U32:
+          idnode_get_u32(k->in, key, &u32);
+          k->u.s64 = u32;
+          break;
+        case PT_S64:
+          idnode_get_s64(k->in, key, &k->u.s64);
+          break;
+        case PT_S64_ATOMIC:
+          idnode_get_s64_atomic(k->in, key, &k->u.s64);
+          break;
+        case PT_TIME:
+          idnode_get_time(k->in, key, &t);
+          k->u.s64 = t;
+          break;
+        default:
+          idnode_get_u32(k->in, key, (uint32_t *)&i32);
+          k->u.s64 = i32;
+          break;
+      }
+      break;
+    case ISK_DBL:
+      idnode_get_dbl(k->in, key, &k->u.dbl);
+      break;
+  }
+}
+
+static int
+idnode_cmp_sort_key
+  ( const void *a, const void *b, void *s )
+{
+  const idnode_sort_key_t *ka = a, *kb = b;
+  const idnode_sort_keys_t *sk = s;
+  int r = 0;
+
+  switch (sk->type) {
+    case ISK_STR:
+      r = strcmp(ka->u.str ?: "", kb->u.str ?: "");
+      break;
+    case ISK_S64:
+      r = safecmp(ka->u.s64, kb->u.s64);
+      break;
+    case ISK_DBL:
+      r = safecmp(ka->u.dbl, kb->u.dbl);
+      break;
+    case ISK_NONE:
+      break;
+  }
+  if (r)
+    return sk->dir == IS_ASC ? r : -r;
+  return safecmp(ka->idx, kb->idx);
+}
+
+/*
+ * Move the 'count' lowest keys to the beginning of the array (unsorted)
+ */
+static void
+idnode_sort_key_select
+  ( idnode_sort_key_t *keys, size_t n, size_t count, idnode_sort_keys_t *sk )
+{
+  idnode_sort_key_t pivot, tmp;
+  size_t lo = 0, hi = n - 1, i, j;
+
+  while (lo < hi) {
+    /* Median of three as pivot */
+    i = lo + (hi - lo) / 2;
+    if (idnode_cmp_sort_key(&keys[i], &keys[lo], sk) < 0)
+      { tmp = keys[i]; keys[i] = keys[lo]; keys[lo] = tmp; }
+    if (idnode_cmp_sort_key(&keys[hi], &keys[lo], sk) < 0)
+      { tmp = keys[hi]; keys[hi] = keys[lo]; keys[lo] = tmp; }
+    if (idnode_cmp_sort_key(&keys[hi], &keys[i], sk) < 0)
+      { tmp = keys[hi]; keys[hi] = keys[i]; keys[i] = tmp; }
+    pivot = keys[i];
+    /* Partition */
+    i = lo;
+    j = hi;
+    while (i <= j) {
+      while (idnode_cmp_sort_key(&keys[i], &pivot, sk) < 0) i++;
+      while (idnode_cmp_sort_key(&keys[j], &pivot, sk) > 0) j--;
+      if (i <= j) {
+        tmp = keys[i]; keys[i] = keys[j]; keys[j] = tmp;
+        i++;
+        if (j == 0) break;
+        j--;
+      }
+    }
+    if (count <= j)
+      hi = j;
+    else if (count >= i)
+      lo = i;
+    else
+      break;
+  }
+}
+
+/*
+ * Sort the first 'count' nodes of the set, the order of the rest
+ * is undefined
+ */
+void
+idnode_set_sort_partial
+  ( idnode_set_t *is, idnode_sort_t *sort, size_t count )
+{
+  idnode_sort_key_t *keys;
+  idnode_sort_keys_t sk;
+  const property_t *p = NULL;
+  size_t i, n = is->is_count;
+
+  if (n < 2 || count == 0)
+    return;
+  if (count > n)
+    count = n;
+
+  for (i = 0; i < n && p == NULL; i++)
+    p = idnode_find_prop(is->is_array[i], sort->key);
+  if (p == NULL)
+    return;
+  sk.type = idnode_sort_key_type(p);
+  sk.dir = sort->dir;
+  if (sk.type == ISK_NONE)
+    return;
+
+  keys = malloc(n * sizeof(*keys));
+  for (i = 0; i < n; i++) {
+    keys[i].in = is->is_array[i];
+    keys[i].idx = i;
+    idnode_sort_key_get(&keys[i], sk.type, sort->key, sort->lang);
+  }
+
+  if (count < n)
+    idnode_sort_key_select(keys, n, count, &sk);
+  tvh_qsort_r(keys, count, sizeof(*keys), idnode_cmp_sort_key, &sk);
+
+  for (i = 0; i < n; i++) {
+    is->is_array[i] = keys[i].in;
+    if (sk.type == ISK_STR)
+      free(keys[i].u.str);
+  }
+  free(keys);
+}
+
 void
 idnode_set_sort_by_title
   ( idnode_set_t *is, const char *lang )
@@ -325,6 +325,7 @@ static inline int idnode_set_exists ( idnode_set_t *is, idnode_t *in )
 static inline int idnode_set_empty ( idnode_set_t *is )
   { return is->is_count == 0; }
 void idnode_set_sort ( idnode_set_t *is, idnode_sort_t *s );
+void idnode_set_sort_partial ( idnode_set_t *is, idnode_sort_t *s, size_t count );
 void idnode_set_sort_by_title ( idnode_set_t *is, const char *lang );
 htsmsg_t *idnode_set_as_htsmsg ( idnode_set_t *is );
 void idnode_set_clear ( idnode_set_t *is );
@@ -124,6 +124,8 @@ tvh_input_stream_create_msg
     htsmsg_add_str(m, "stream", st->stream_name);
   htsmsg_add_u32(m, "subs", st->subs_count);
   htsmsg_add_u32(m, "weight", st->max_weight);
+  htsmsg_add_u32(m, "worker", st->worker);
+  htsmsg_add_u32(m, "load", st->load);
   if ((pids = st->pids) != NULL) {
     l = htsmsg_create_list();
     if (pids->all) {
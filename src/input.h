@@ -77,6 +77,8 @@ struct tvh_input_stream {
   char *stream_name;  ///< Name for this stream
   int   subs_count;   ///< Number of subcscriptions
   int   max_weight;   ///< Current max weight
+  int   worker;       ///< Input worker thread index
+  int   load;         ///< Input worker thread load (0.1%)
 
   struct mpegts_apids *pids; ///< active PID list
 
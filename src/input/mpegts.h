@@ -51,6 +51,9 @@ typedef struct mpegts_input         mpegts_input_t;
 typedef struct mpegts_table_feed    mpegts_table_feed_t;
 typedef struct mpegts_network_link  mpegts_network_link_t;
 typedef struct mpegts_packet        mpegts_packet_t;
+typedef struct mpegts_input_slab    mpegts_input_slab_t;
+typedef struct mpegts_input_worker  mpegts_input_worker_t;
+typedef struct mpegts_input_dlv     mpegts_input_dlv_t;
 typedef struct mpegts_pcr           mpegts_pcr_t;
 typedef struct mpegts_buffer        mpegts_buffer_t;
 
@@ -129,10 +132,60 @@ struct mpegts_packet
   TAILQ_ENTRY(mpegts_packet)  mp_link;
   size_t                      mp_len;
   mpegts_mux_t               *mp_mux;
+  mpegts_input_slab_t        *mp_slab; ///< Owner slab (NULL = malloc'd)
   uint8_t                     mp_cc_restart;
   uint8_t                     mp_data[0];
 };
 
+/*
+ * Input queue packets are carved sequentially from fixed-size slabs,
+ * the slab is recycled once the input thread consumed all its packets
+ */
+#define MPEGTS_INPUT_SLAB_SIZE  (512*1024)
+#define MPEGTS_INPUT_SLAB_SPARE 2
+
+struct mpegts_input_slab
+{
+  LIST_ENTRY(mpegts_input_slab) mis_link;
+  int                           mis_refs;
+  size_t                        mis_used;
+  uint8_t                       mis_data[0];
+};
+
+/*
+ * Input processing workers, each active mux is bound to one worker
+ * so the packet order per mux is kept
+ */
+#define MPEGTS_INPUT_WORKERS_MAX 8
+
+struct mpegts_input_dlv
+{
+  service_t                    *md_service;
+  uint64_t                      md_tspos;
+  uint32_t                      md_off;
+  uint32_t                      md_len;
+  uint16_t                      md_pid;
+  uint8_t                       md_raw;
+  uint8_t                       md_table;
+};
+
+struct mpegts_input_worker
+{
+  mpegts_input_t               *miw_input;
+  int                           miw_index;
+  pthread_t                     miw_tid;
+  tvh_cond_t                    miw_cond;      ///< mi_input_lock
+  TAILQ_HEAD(,mpegts_packet)    miw_queue;     ///< mi_input_lock
+  int                           miw_muxes;     ///< mi_input_lock
+  int64_t                       miw_load_busy; ///< busy time (us)
+  int                           miw_load;      ///< load (0.1%)
+  /* Service deliveries postponed after mi_output_lock is released */
+  tvh_mutex_t                   miw_dlv_lock;
+  mpegts_input_dlv_t           *miw_dlv;
+  int                           miw_dlv_count;
+  int                           miw_dlv_alloc;
+};
+
 struct mpegts_pcr {
   int64_t  pcr_first;
   int64_t  pcr_last;
@@ -482,6 +535,7 @@ struct mpegts_mux
 
   LIST_HEAD(, mpegts_mux_instance) mm_instances;
   mpegts_mux_instance_t      *mm_active;
+  int                         mm_input_worker; ///< mi_input_lock
   LIST_HEAD(,service)         mm_transports;
 
   /*
@@ -618,9 +672,10 @@ struct mpegts_service
 
   /**
    * When a subscription request SMT_MPEGTS, chunk them together
-   * in order to reduce load.
+   * in order to reduce load. The chunk is passed to all subscribers
+   * by reference.
    */
-  sbuf_t s_tsbuf;
+  pktbuf_t *s_tsbuf;
   int64_t s_tsbuf_last;
 
   /**
@@ -712,15 +767,20 @@ struct mpegts_input
 
   int mi_running;            /* threads running */
   int64_t mi_last_dispatch;
+  int64_t mi_load_last;      /* last load sample time */
+  int mi_load;               /* max. input worker load (0.1%) */
+  int mi_worker_threads;     /* configured worker count */
 
   /* Data input */
   // Note: this section is protected by mi_input_lock
-  pthread_t                       mi_input_tid;
   mtimer_t                        mi_input_thread_start;
   tvh_mutex_t                     mi_input_lock;
-  tvh_cond_t                      mi_input_cond;
-  TAILQ_HEAD(,mpegts_packet)      mi_input_queue;
+  mpegts_input_worker_t           mi_workers[MPEGTS_INPUT_WORKERS_MAX];
+  int                             mi_workers_count;
   uint64_t                        mi_input_queue_size;
+  mpegts_input_slab_t            *mi_input_slab;
+  LIST_HEAD(,mpegts_input_slab)   mi_input_slab_spare;
+  int                             mi_input_slab_nspare;
   tvhlog_limit_t                  mi_input_queue_loglimit;
   qprofile_t                      mi_qprofile;
   int                             mi_remove_scrambled_bits;
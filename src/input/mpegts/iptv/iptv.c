@@ -192,11 +192,16 @@ iptv_input_thread_balance(iptv_input_t *mi)
   iptv_thread_pool_t *pool, *apool = mi->mi_tpool;
 
   /*
-   * select input with the smallest count of active threads
+   * select input with the smallest count of active threads,
+   * prefer the less loaded input thread when the counts are equal
    */
-  TAILQ_FOREACH(pool, &iptv_tpool, link)
+  TAILQ_FOREACH(pool, &iptv_tpool, link) {
     if (pool->streams < apool->streams)
       return 1;
+    if (pool->streams == apool->streams &&
+        atomic_get(&pool->input->mi_load) + 100 < atomic_get(&mi->mi_load))
+      return 1;
+  }
   return 0;
 }
 
@@ -331,6 +331,20 @@ const idclass_t mpegts_input_class =
       .def.i    = 1,
       .opts     = PO_EXPERT,
     },
+    {
+      .type     = PT_INT,
+      .id       = "worker_threads",
+      .name     = N_("Processing threads"),
+      .desc     = N_("Number of threads processing (demultiplexing, "
+                     "descrambling) the received muxes. Each active mux "
+                     "is handled by one thread, so more than one thread "
+                     "helps only for inputs carrying several muxes. "
+                     "Changes take effect after restart."),
+      .off      = offsetof(mpegts_input_t, mi_worker_threads),
+      .intextra = INTEXTRA_RANGE(1, MPEGTS_INPUT_WORKERS_MAX, 1),
+      .def.i    = 1,
+      .opts     = PO_EXPERT,
+    },
     {
       .type     = PT_STR,
       .id       = "networks",
@@ -830,6 +844,8 @@ mpegts_input_open_cat_monitor
                      MPS_WEIGHT_CAT);
 }
 
+static void mpegts_input_deliver_barrier ( mpegts_input_t *mi );
+
 void
 mpegts_input_open_service
   ( mpegts_input_t *mi, mpegts_service_t *s, int flags, int init, int weight )
@@ -956,6 +972,7 @@ mpegts_input_close_service ( mpegts_input_t *mi, mpegts_service_t *s )
 no_pids:
   tvh_mutex_unlock(&s->s_stream_mutex);
   tvh_mutex_unlock(&mi->mi_output_lock);
+  mpegts_input_deliver_barrier(mi);
 
   mpegts_mux_update_pids(mm);
 
@@ -975,6 +992,24 @@ mpegts_input_create_mux_instance
     mpegts_mux_instance_create(mpegts_mux_instance, NULL, mi, mm);
 }
 
+/*
+ * Worker assignment (mi_input_lock must be held)
+ */
+static void
+mpegts_input_worker_bind ( mpegts_input_t *mi, mpegts_mux_t *mm )
+{
+  mpegts_input_worker_t *miw, *best = &mi->mi_workers[0];
+  int i;
+
+  for (i = 1; i < mi->mi_workers_count; i++) {
+    miw = &mi->mi_workers[i];
+    if (miw->miw_muxes < best->miw_muxes)
+      best = miw;
+  }
+  best->miw_muxes++;
+  mm->mm_input_worker = best->miw_index;
+}
+
 static void
 mpegts_input_started_mux
   ( mpegts_input_t *mi, mpegts_mux_instance_t *mmi )
@@ -988,6 +1023,11 @@ mpegts_input_started_mux
   if (LIST_FIRST(&mi->mi_mux_active) == NULL)
     mtimer_arm_rel(&mi->mi_status_timer, mpegts_input_status_timer, mi, sec2mono(1));
 
+  /* Bind the mux to the least used worker */
+  tvh_mutex_lock(&mi->mi_input_lock);
+  mpegts_input_worker_bind(mi, mm);
+  tvh_mutex_unlock(&mi->mi_input_lock);
+
   /* Update */
   mm->mm_active = mmi;
 
@@ -1017,13 +1057,23 @@ mpegts_input_stopped_mux
   char buf[256];
   service_t *s, *s_next;
   mpegts_mux_t *mm = mmi->mmi_mux;
+  int i;
 
   /* no longer active */
   LIST_REMOVE(mmi, mmi_active_link);
 
+  tvh_mutex_lock(&mi->mi_input_lock);
+  mi->mi_workers[mm->mm_input_worker].miw_muxes--;
+  tvh_mutex_unlock(&mi->mi_input_lock);
+
   /* Disarm timer */
-  if (LIST_FIRST(&mi->mi_mux_active) == NULL)
+  if (LIST_FIRST(&mi->mi_mux_active) == NULL) {
     mtimer_disarm(&mi->mi_status_timer);
+    mi->mi_load_last = 0;
+    for (i = 0; i < MPEGTS_INPUT_WORKERS_MAX; i++)
+      atomic_set(&mi->mi_workers[i].miw_load, 0);
+    atomic_set(&mi->mi_load, 0);
+  }
 
   mi->mi_display_name(mi, buf, sizeof(buf));
   tvhtrace(LS_MPEGTS, "%s - flush subscribers", buf);
@@ -1145,56 +1195,140 @@ get_pcr ( const uint8_t *tsb, int64_t *rpcr )
   return 1;
 }
 
-static inline int
-ts_sync_count ( const uint8_t *tsb, int len )
-{
-  const uint8_t *start = tsb;
-  while (len >= 188) {
-    if (len >= 1880 &&
-        tsb[0*188] == 0x47 && tsb[1*188] == 0x47 &&
-        tsb[2*188] == 0x47 && tsb[3*188] == 0x47 &&
-        tsb[4*188] == 0x47 && tsb[5*188] == 0x47 &&
-        tsb[6*188] == 0x47 && tsb[7*188] == 0x47 &&
-        tsb[8*188] == 0x47 && tsb[9*188] == 0x47) {
-      len -= 1880;
-      tsb += 1880;
-    } else if (*tsb == 0x47) {
-      len -= 188;
-      tsb += 188;
+/*
+ * Input queue slabs (mi_input_lock must be held)
+ */
+static void
+mpegts_input_slab_release ( mpegts_input_t *mi, mpegts_input_slab_t *mis )
+{
+  if (--mis->mis_refs > 0)
+    return;
+  if (mi->mi_input_slab_nspare < MPEGTS_INPUT_SLAB_SPARE) {
+    LIST_INSERT_HEAD(&mi->mi_input_slab_spare, mis, mis_link);
+    mi->mi_input_slab_nspare++;
+  } else {
+    free(mis);
+  }
+}
+
+static void
+mpegts_input_slab_flush ( mpegts_input_t *mi )
+{
+  mpegts_input_slab_t *mis;
+
+  if ((mis = mi->mi_input_slab) != NULL) {
+    mi->mi_input_slab = NULL;
+    mpegts_input_slab_release(mi, mis);
+  }
+  while ((mis = LIST_FIRST(&mi->mi_input_slab_spare)) != NULL) {
+    LIST_REMOVE(mis, mis_link);
+    free(mis);
+  }
+  mi->mi_input_slab_nspare = 0;
+}
+
+static mpegts_packet_t *
+mpegts_input_packet_alloc ( mpegts_input_t *mi, size_t len )
+{
+  mpegts_input_slab_t *mis = mi->mi_input_slab;
+  mpegts_packet_t *mp;
+  size_t size = (sizeof(mpegts_packet_t) + len + 15) & ~(size_t)15;
+
+  if (size > MPEGTS_INPUT_SLAB_SIZE) {
+    mp = malloc(sizeof(mpegts_packet_t) + len);
+    mp->mp_slab = NULL;
+    return mp;
+  }
+  /* All packets consumed, rewind the current slab (cache hot) */
+  if (mis && mis->mis_refs == 1)
+    mis->mis_used = 0;
+  if (mis == NULL || mis->mis_used + size > MPEGTS_INPUT_SLAB_SIZE) {
+    if (mis)
+      mpegts_input_slab_release(mi, mis);
+    if ((mis = LIST_FIRST(&mi->mi_input_slab_spare)) != NULL) {
+      LIST_REMOVE(mis, mis_link);
+      mi->mi_input_slab_nspare--;
     } else {
-      break;
+      mis = malloc(sizeof(*mis) + MPEGTS_INPUT_SLAB_SIZE);
     }
+    mis->mis_refs = 1;
+    mis->mis_used = 0;
+    mi->mi_input_slab = mis;
   }
-  return tsb - start;
+  mp = (mpegts_packet_t *)(mis->mis_data + mis->mis_used);
+  mis->mis_used += size;
+  mis->mis_refs++;
+  mp->mp_slab = mis;
+  return mp;
+}
+
+static void
+mpegts_input_packet_free ( mpegts_input_t *mi, mpegts_packet_t *mp )
+{
+  if (mp->mp_slab)
+    mpegts_input_slab_release(mi, mp->mp_slab);
+  else
+    free(mp);
 }
 
 static void
 mpegts_input_queue_packets
-  ( mpegts_mux_instance_t *mmi, mpegts_packet_t *mp )
+  ( mpegts_mux_instance_t *mmi, const uint8_t *tsb, int len, int flags )
 {
   mpegts_input_t *mi = mmi->mmi_input;
+  mpegts_input_worker_t *miw;
+  mpegts_packet_t *mp;
   const char *id = SRCLINEID();
-  int len = mp->mp_len;
+  int empty, noise;
 
+  /* Reserve the packet space in the slab */
   tvh_mutex_lock(&mi->mi_input_lock);
-  if (mmi->mmi_mux->mm_active == mmi) {
-    if (mi->mi_input_queue_size < 50*1024*1024) {
-      mi->mi_input_queue_size += len;
-      memoryinfo_alloc(&mpegts_input_queue_memoryinfo, sizeof(mpegts_packet_t) + len);
-      mpegts_mux_grab(mp->mp_mux);
-      TAILQ_INSERT_TAIL(&mi->mi_input_queue, mp, mp_link);
-      tprofile_queue_add(&mi->mi_qprofile, id, len);
-      tprofile_queue_set(&mi->mi_qprofile, id, mi->mi_input_queue_size);
-      tvh_cond_signal(&mi->mi_input_cond, 0);
-    } else {
-      if (tvhlog_limit(&mi->mi_input_queue_loglimit, 10))
-        tvhwarn(LS_MPEGTS, "too much queued input data (over 50MB) for %s, discarding new", mi->mi_name);
-      tprofile_queue_drop(&mi->mi_qprofile, id, len);
-      free(mp);
-    }
-  } else {
-    free(mp);
+  if (mmi->mmi_mux->mm_active != mmi) {
+    tvh_mutex_unlock(&mi->mi_input_lock);
+    return;
+  }
+  if (mi->mi_input_queue_size >= 50*1024*1024) {
+    if (tvhlog_limit(&mi->mi_input_queue_loglimit, 10))
+      tvhwarn(LS_MPEGTS, "too much queued input data (over 50MB) for %s, discarding new", mi->mi_name);
+    tprofile_queue_drop(&mi->mi_qprofile, id, len);
+    tvh_mutex_unlock(&mi->mi_input_lock);
+    return;
+  }
+  mp = mpegts_input_packet_alloc(mi, len);
+  tvh_mutex_unlock(&mi->mi_input_lock);
+
+  /* Fill it unlocked (the muxes have one producer each, so the order
+   * of the packets per mux does not change) */
+  mp->mp_mux        = mmi->mmi_mux;
+  mp->mp_len        = len;
+  mp->mp_cc_restart = (flags & MPEGTS_DATA_CC_RESTART) ? 1 : 0;
+  memcpy(mp->mp_data, tsb, len);
+  if (mi->mi_remove_scrambled_bits || (flags & MPEGTS_DATA_REMOVE_SCRAMBLED) != 0) {
+    uint8_t *tmp, *end;
+    for (tmp = mp->mp_data, end = mp->mp_data + len; tmp < end; tmp += 188)
+      tmp[3] &= ~0xc0;
+  }
+  noise = (flags & MPEGTS_DATA_CC_RESTART) == 0 && data_noise(mp);
+
+  /* Link it */
+  tvh_mutex_lock(&mi->mi_input_lock);
+  if (noise || mmi->mmi_mux->mm_active != mmi) {
+    mpegts_input_packet_free(mi, mp);
+    tvh_mutex_unlock(&mi->mi_input_lock);
+    return;
   }
+  len = mp->mp_len;
+  miw = &mi->mi_workers[mp->mp_mux->mm_input_worker];
+  empty = TAILQ_EMPTY(&miw->miw_queue);
+  mi->mi_input_queue_size += len;
+  memoryinfo_alloc(&mpegts_input_queue_memoryinfo, sizeof(mpegts_packet_t) + len);
+  mpegts_mux_grab(mp->mp_mux);
+  TAILQ_INSERT_TAIL(&miw->miw_queue, mp, mp_link);
+  tprofile_queue_add(&mi->mi_qprofile, id, len);
+  tprofile_queue_set(&mi->mi_qprofile, id, mi->mi_input_queue_size);
+  /* The worker drains its whole queue before it sleeps */
+  if (empty)
+    tvh_cond_signal(&miw->miw_cond, 0);
   tvh_mutex_unlock(&mi->mi_input_lock);
 }
 
@@ -1205,7 +1339,6 @@ mpegts_input_recv_packets
 {
   mpegts_input_t *mi = mmi->mmi_input;
   int len, len2, off;
-  mpegts_packet_t *mp;
   uint8_t *tsb;
 #define MIN_TS_PKT 100
 #define MIN_TS_SYN (5*188)
@@ -1266,31 +1399,12 @@ retry:
 
   /* Pass */
   if (len2 >= MIN_TS_SYN || (flags & MPEGTS_DATA_CC_RESTART)) {
-    mp = malloc(sizeof(mpegts_packet_t) + len2);
-    mp->mp_mux        = mmi->mmi_mux;
-    mp->mp_len        = len2;
-    mp->mp_cc_restart = (flags & MPEGTS_DATA_CC_RESTART) ? 1 : 0;
-
-    memcpy(mp->mp_data, tsb, len2);
-    if (mi->mi_remove_scrambled_bits || (flags & MPEGTS_DATA_REMOVE_SCRAMBLED) != 0) {
-      uint8_t *tmp, *end;
-      for (tmp = mp->mp_data, end = mp->mp_data + len2; tmp < end; tmp += 188)
-        tmp[3] &= ~0xc0;
-    }
-
+    mpegts_input_queue_packets(mmi, tsb, len2, flags);
     len -= len2;
     off += len2;
-
-    if ((flags & MPEGTS_DATA_CC_RESTART) == 0 && data_noise(mp)) {
-      free(mp);
-      goto end;
-    }
-
-    mpegts_input_queue_packets(mmi, mp);
   }
 
   /* Adjust buffer */
-end:
   if (len && (flags & MPEGTS_DATA_CC_RESTART) == 0) {
     sbuf_cut(sb, off); // cut off the bottom
     if (sb->sb_ptr >= MIN_TS_PKT * 188)
@@ -1415,9 +1529,77 @@ mpegts_input_table_waiting ( mpegts_input_t *mi, mpegts_mux_t *mm )
   tvh_mutex_unlock(&mm->mm_tables_lock);
 }
 
+/*
+ * Service delivery. With more workers the deliveries are collected
+ * under mi_output_lock and made after it is released (miw_dlv_lock
+ * is held), so the descrambling and ES parsing run in parallel.
+ */
+static void
+mpegts_input_deliver
+  ( mpegts_input_worker_t *miw, service_t *s, uint64_t tspos,
+    const uint8_t *data, const uint8_t *tsb, uint16_t pid, int len,
+    int raw, int table )
+{
+  mpegts_input_dlv_t *md;
+
+  if (miw == NULL) {
+    if (raw)
+      ts_recv_raw((mpegts_service_t *)s, tspos, tsb, len);
+    else
+      ts_recv_packet1((mpegts_service_t *)s, tspos, pid, tsb, len, table);
+    return;
+  }
+  if (miw->miw_dlv_count >= miw->miw_dlv_alloc) {
+    miw->miw_dlv_alloc = MAX(64, miw->miw_dlv_alloc * 2);
+    miw->miw_dlv = realloc(miw->miw_dlv, miw->miw_dlv_alloc * sizeof(*md));
+  }
+  md = &miw->miw_dlv[miw->miw_dlv_count++];
+  md->md_service = s;
+  md->md_tspos   = tspos;
+  md->md_off     = tsb - data;
+  md->md_len     = len;
+  md->md_pid     = pid;
+  md->md_raw     = raw;
+  md->md_table   = table;
+}
+
+static void
+mpegts_input_deliver_flush ( mpegts_input_worker_t *miw, const uint8_t *data )
+{
+  mpegts_input_dlv_t *md, *end;
+
+  for (md = miw->miw_dlv, end = md + miw->miw_dlv_count; md != end; md++) {
+    if (md->md_raw)
+      ts_recv_raw((mpegts_service_t *)md->md_service, md->md_tspos,
+                  data + md->md_off, md->md_len);
+    else
+      ts_recv_packet1((mpegts_service_t *)md->md_service, md->md_tspos,
+                      md->md_pid, data + md->md_off, md->md_len,
+                      md->md_table);
+  }
+  miw->miw_dlv_count = 0;
+}
+
+/*
+ * Wait until the postponed deliveries finish (the service
+ * subscriptions must be already removed under mi_output_lock)
+ */
+static void
+mpegts_input_deliver_barrier ( mpegts_input_t *mi )
+{
+  int i;
+
+  if (mi->mi_workers_count < 2)
+    return;
+  for (i = 0; i < mi->mi_workers_count; i++) {
+    tvh_mutex_lock(&mi->mi_workers[i].miw_dlv_lock);
+    tvh_mutex_unlock(&mi->mi_workers[i].miw_dlv_lock);
+  }
+}
+
 static int
 mpegts_input_process
-  ( mpegts_input_t *mi, mpegts_packet_t *mpkt )
+  ( mpegts_input_t *mi, mpegts_input_worker_t *miw, mpegts_packet_t *mpkt )
 {
   uint16_t pid, pid2;
   uint8_t cc, cc2;
@@ -1509,12 +1691,14 @@ mpegts_input_process
       /* Stream all PIDs */
       LIST_FOREACH(mps, &mm->mm_all_subs, mps_svcraw_link)
         if ((mps->mps_type & MPS_ALL) || (type & (MPS_TABLE|MPS_FTABLE)))
-          ts_recv_raw((mpegts_service_t *)mps->mps_owner, tspos, tsb, llen);
+          mpegts_input_deliver(miw, mps->mps_owner, tspos, mpkt->mp_data,
+                               tsb, pid, llen, 1, 0);
 
       /* Stream raw PIDs */
       if (type & MPS_RAW) {
         LIST_FOREACH(mps, &mp->mp_raw_subs, mps_raw_link)
-          ts_recv_raw((mpegts_service_t *)mps->mps_owner, tspos, tsb, llen);
+          mpegts_input_deliver(miw, mps->mps_owner, tspos, mpkt->mp_data,
+                               tsb, pid, llen, 1, 0);
       }
 
       /* Stream service data */
@@ -1524,7 +1708,8 @@ mpegts_input_process
           f = (type & (MPS_TABLE|MPS_FTABLE)) ||
               (pid == s->s_components.set_pmt_pid) ||
               (pid == s->s_components.set_pcr_pid);
-          ts_recv_packet1((mpegts_service_t*)s, tspos, pid, tsb, llen, f);
+          mpegts_input_deliver(miw, s, tspos, mpkt->mp_data,
+                               tsb, pid, llen, 0, f);
         }
       } else
       /* Stream table data */
@@ -1534,7 +1719,8 @@ mpegts_input_process
           f = (type & (MPS_TABLE|MPS_FTABLE)) ||
               (pid == s->s_components.set_pmt_pid) ||
               (pid == s->s_components.set_pcr_pid);
-          ts_recv_packet1((mpegts_service_t*)s, tspos, pid, tsb, llen, f);
+          mpegts_input_deliver(miw, s, tspos, mpkt->mp_data,
+                               tsb, pid, llen, 0, f);
         }
       }
 
@@ -1580,7 +1766,8 @@ mpegts_input_process
 
       /* Stream to all fullmux subscribers */
       LIST_FOREACH(mps, &mm->mm_all_subs, mps_svcraw_link)
-        ts_recv_raw((mpegts_service_t *)mps->mps_owner, tspos, tsb, llen);
+        mpegts_input_deliver(miw, mps->mps_owner, tspos, mpkt->mp_data,
+                             tsb, pid, llen, 1, 0);
 
     }
 
@@ -1701,8 +1888,10 @@ static void *
 mpegts_input_thread ( void * p )
 {
   mpegts_packet_t *mp;
-  mpegts_input_t *mi = p;
-  size_t bytes = 0;
+  mpegts_input_worker_t *miw = p, *dlv;
+  mpegts_input_t *mi = miw->miw_input;
+  size_t bytes = 0, l;
+  int64_t busy;
   int update_pids;
   tprofile_t tprofile;
   char buf[256];
@@ -1710,24 +1899,31 @@ mpegts_input_thread ( void * p )
   tvh_mutex_lock(&global_lock);
   mi->mi_display_name(mi, buf, sizeof(buf));
   tvh_mutex_unlock(&global_lock);
+  if (miw->miw_index > 0) {
+    l = strlen(buf);
+    tvh_strlcatf(buf, sizeof(buf), l, " #%d", miw->miw_index + 1);
+  }
 
   tprofile_init(&tprofile, buf);
 
+  /* Deliver to services outside mi_output_lock when workers share it */
+  dlv = mi->mi_workers_count > 1 ? miw : NULL;
+
   tvh_mutex_lock(&mi->mi_input_lock);
   while (atomic_get(&mi->mi_running)) {
 
     /* Wait for a packet */
-    if (!(mp = TAILQ_FIRST(&mi->mi_input_queue))) {
+    if (!(mp = TAILQ_FIRST(&miw->miw_queue))) {
       if (bytes) {
         tvhtrace(LS_MPEGTS, "input %s got %zu bytes", buf, bytes);
         bytes = 0;
       }
-      tvh_cond_wait(&mi->mi_input_cond, &mi->mi_input_lock);
+      tvh_cond_wait(&miw->miw_cond, &mi->mi_input_lock);
       continue;
     }
     mi->mi_input_queue_size -= mp->mp_len;
     memoryinfo_free(&mpegts_input_queue_memoryinfo, sizeof(mpegts_packet_t) + mp->mp_len);
-    TAILQ_REMOVE(&mi->mi_input_queue, mp, mp_link);
+    TAILQ_REMOVE(&miw->miw_queue, mp, mp_link);
     tvh_mutex_unlock(&mi->mi_input_lock);
       
     /* Process */
@@ -1741,10 +1937,18 @@ mpegts_input_thread ( void * p )
       tvh_mutex_lock(&mi->mi_output_lock);
     }
     tprofile_start(&tprofile, "input");
-    bytes += mpegts_input_process(mi, mp);
-    tprofile_finish(&tprofile);
+    busy = getmonoclock();
+    if (dlv)
+      tvh_mutex_lock(&miw->miw_dlv_lock);
+    bytes += mpegts_input_process(mi, dlv, mp);
     update_pids = mp->mp_mux && mp->mp_mux->mm_update_pids_flag;
     tvh_mutex_unlock(&mi->mi_output_lock);
+    if (dlv) {
+      mpegts_input_deliver_flush(miw, mp->mp_data);
+      tvh_mutex_unlock(&miw->miw_dlv_lock);
+    }
+    atomic_add_s64(&miw->miw_load_busy, getmonoclock() - busy);
+    tprofile_finish(&tprofile);
     if (update_pids) {
       tvh_mutex_lock(&global_lock);
       mpegts_mux_update_pids(mp->mp_mux);
@@ -1754,7 +1958,6 @@ mpegts_input_thread ( void * p )
     /* Cleanup */
     if (mp->mp_mux)
       mpegts_mux_release(mp->mp_mux);
-    free(mp);
 
 #if ENABLE_TSDEBUG
     {
@@ -1764,19 +1967,20 @@ mpegts_input_thread ( void * p )
 #endif
 
     tvh_mutex_lock(&mi->mi_input_lock);
+    mpegts_input_packet_free(mi, mp);
   }
 
   tvhtrace(LS_MPEGTS, "input %s got %zu bytes (finish)", buf, bytes);
 
   /* Flush */
-  while ((mp = TAILQ_FIRST(&mi->mi_input_queue))) {
+  while ((mp = TAILQ_FIRST(&miw->miw_queue))) {
     memoryinfo_free(&mpegts_input_queue_memoryinfo, sizeof(mpegts_packet_t) + mp->mp_len);
-    TAILQ_REMOVE(&mi->mi_input_queue, mp, mp_link);
+    TAILQ_REMOVE(&miw->miw_queue, mp, mp_link);
+    mi->mi_input_queue_size -= mp->mp_len;
     if (mp->mp_mux)
       mpegts_mux_release(mp->mp_mux);
-    free(mp);
+    mpegts_input_packet_free(mi, mp);
   }
-  mi->mi_input_queue_size = 0;
   tvh_mutex_unlock(&mi->mi_input_lock);
 
   tprofile_done(&tprofile);
@@ -1839,6 +2043,7 @@ mpegts_input_flush_mux
 {
   mpegts_table_feed_t *mtf;
   mpegts_packet_t *mp;
+  int i;
 
   lock_assert(&global_lock);
 
@@ -1848,12 +2053,13 @@ mpegts_input_flush_mux
 
   /* Flush input Q */
   tvh_mutex_lock(&mi->mi_input_lock);
-  TAILQ_FOREACH(mp, &mi->mi_input_queue, mp_link) {
-    if (mp->mp_mux == mm) {
-      mpegts_mux_release(mm);
-      mp->mp_mux = NULL;
+  for (i = 0; i < MPEGTS_INPUT_WORKERS_MAX; i++)
+    TAILQ_FOREACH(mp, &mi->mi_workers[i].miw_queue, mp_link) {
+      if (mp->mp_mux == mm) {
+        mpegts_mux_release(mm);
+        mp->mp_mux = NULL;
+      }
     }
-  }
   tvh_mutex_unlock(&mi->mi_input_lock);
 
   /* Flush table Q */
@@ -1894,6 +2100,8 @@ mpegts_input_stream_status
   st->stream_name = strdup(buf);
   st->subs_count  = s;
   st->max_weight  = w;
+  st->worker      = mm->mm_input_worker;
+  st->load        = atomic_get(&mi->mi_workers[st->worker].miw_load);
 
   st->pids = mpegts_pid_alloc();
   RB_FOREACH(mp, &mm->mm_pids, mp_link) {
@@ -1933,6 +2141,7 @@ mpegts_input_empty_status
   st->uuid        = strdup(idnode_uuid_as_str(&mi->ti_id, ubuf));
   mi->mi_display_name(mi, buf, sizeof(buf));
   st->input_name  = strdup(buf);
+  st->load        = atomic_get(&mi->mi_load);
   LIST_FOREACH(mmi_, &mi->mi_mux_instances, tii_input_link) {
     mmi = (mpegts_mux_instance_t *)mmi_;
     st->stats.unc += atomic_get(&mmi->tii_stats.unc);
@@ -1993,23 +2202,33 @@ static void
 mpegts_input_thread_start ( void *aux )
 {
   mpegts_input_t *mi = aux;
+  int i;
+
   atomic_set(&mi->mi_running, 1);
+
+  tvh_mutex_lock(&mi->mi_input_lock);
+  mi->mi_workers_count = MINMAX(mi->mi_worker_threads, 1, MPEGTS_INPUT_WORKERS_MAX);
+  tvh_mutex_unlock(&mi->mi_input_lock);
   
   tvh_thread_create(&mi->mi_table_tid, NULL,
                     mpegts_input_table_thread, mi, "mi-table");
-  tvh_thread_create(&mi->mi_input_tid, NULL,
-                    mpegts_input_thread, mi, "mi-main");
+  for (i = 0; i < mi->mi_workers_count; i++)
+    tvh_thread_create(&mi->mi_workers[i].miw_tid, NULL,
+                      mpegts_input_thread, &mi->mi_workers[i], "mi-main");
 }
 
 static void
 mpegts_input_thread_stop ( mpegts_input_t *mi )
 {
+  int i;
+
   atomic_set(&mi->mi_running, 0);
   mtimer_disarm(&mi->mi_input_thread_start);
 
-  /* Stop input thread */
+  /* Stop input threads */
   tvh_mutex_lock(&mi->mi_input_lock);
-  tvh_cond_signal(&mi->mi_input_cond, 0);
+  for (i = 0; i < mi->mi_workers_count; i++)
+    tvh_cond_signal(&mi->mi_workers[i].miw_cond, 0);
   tvh_mutex_unlock(&mi->mi_input_lock);
 
   /* Stop table thread */
@@ -2019,8 +2238,9 @@ mpegts_input_thread_stop ( mpegts_input_t *mi )
 
   /* Join threads (relinquish lock due to potential deadlock) */
   tvh_mutex_unlock(&global_lock);
-  if (mi->mi_input_tid)
-    pthread_join(mi->mi_input_tid, NULL);
+  for (i = 0; i < mi->mi_workers_count; i++)
+    if (mi->mi_workers[i].miw_tid)
+      pthread_join(mi->mi_workers[i].miw_tid, NULL);
   if (mi->mi_table_tid)
     pthread_join(mi->mi_table_tid, NULL);
   tvh_mutex_lock(&global_lock);
@@ -2037,7 +2257,24 @@ mpegts_input_status_timer ( void *p )
   mpegts_input_t *mi = p;
   mpegts_mux_instance_t *mmi;
   htsmsg_t *e;
-  int64_t subs = 0;
+  mpegts_input_worker_t *miw;
+  int64_t subs = 0, now, busy;
+  int i, load, max = 0;
+
+  /* Input worker load */
+  now  = getmonoclock();
+  for (i = 0; i < mi->mi_workers_count; i++) {
+    miw  = &mi->mi_workers[i];
+    busy = atomic_exchange_s64(&miw->miw_load_busy, 0);
+    if (mi->mi_load_last && now > mi->mi_load_last) {
+      load = MIN(1000, busy * 1000 / (now - mi->mi_load_last));
+      atomic_set(&miw->miw_load, load);
+      max = MAX(max, load);
+    }
+  }
+  if (mi->mi_load_last && now > mi->mi_load_last)
+    atomic_set(&mi->mi_load, max);
+  mi->mi_load_last = now;
 
   tvh_mutex_lock(&mi->mi_output_lock);
   LIST_FOREACH(mmi, &mi->mi_mux_active, mmi_active_link) {
@@ -2066,7 +2303,9 @@ mpegts_input_create0
   ( mpegts_input_t *mi, const idclass_t *class, const char *uuid,
     htsmsg_t *c )
 {
+  mpegts_input_worker_t *miw;
   char buf[32];
+  int i;
 
   if (idnode_insert(&mi->ti_id, uuid, class, 0)) {
     if (uuid)
@@ -2103,8 +2342,14 @@ mpegts_input_create0
 
   /* Init input/output structures */
   tvh_mutex_init(&mi->mi_input_lock, NULL);
-  tvh_cond_init(&mi->mi_input_cond, 1);
-  TAILQ_INIT(&mi->mi_input_queue);
+  for (i = 0; i < MPEGTS_INPUT_WORKERS_MAX; i++) {
+    miw = &mi->mi_workers[i];
+    miw->miw_input = mi;
+    miw->miw_index = i;
+    tvh_cond_init(&miw->miw_cond, 1);
+    tvh_mutex_init(&miw->miw_dlv_lock, NULL);
+    TAILQ_INIT(&miw->miw_queue);
+  }
 
   tvh_mutex_init(&mi->mi_output_lock, NULL);
   tvh_cond_init(&mi->mi_table_cond, 1);
@@ -2141,6 +2386,7 @@ mpegts_input_delete ( mpegts_input_t *mi, int delconf )
 {
   mpegts_network_link_t *mnl;
   tvh_input_instance_t *tii, *tii_next;
+  int i;
 
   /* Early shutdown flag */
   atomic_set(&mi->mi_running, 0);
@@ -2168,6 +2414,16 @@ mpegts_input_delete ( mpegts_input_t *mi, int delconf )
   /* Stop threads (will unlock global_lock to join) */
   mpegts_input_thread_stop(mi);
 
+  tvh_mutex_lock(&mi->mi_input_lock);
+  mpegts_input_slab_flush(mi);
+  tvh_mutex_unlock(&mi->mi_input_lock);
+
+  for (i = 0; i < MPEGTS_INPUT_WORKERS_MAX; i++) {
+    tvh_cond_destroy(&mi->mi_workers[i].miw_cond);
+    tvh_mutex_destroy(&mi->mi_workers[i].miw_dlv_lock);
+    free(mi->mi_workers[i].miw_dlv);
+  }
+
   tprofile_queue_done(&mi->mi_qprofile);
   tvh_mutex_destroy(&mi->mi_output_lock);
   tvh_cond_destroy(&mi->mi_table_cond);
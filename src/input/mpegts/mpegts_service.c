@@ -513,7 +513,8 @@ mpegts_service_stop(service_t *t)
     i->mi_close_service(i, s);
 
   /* Save some memory */
-  sbuf_free(&s->s_tsbuf);
+  pktbuf_ref_dec(s->s_tsbuf);
+  s->s_tsbuf = NULL;
 }
 
 /*
@@ -824,7 +825,8 @@ mpegts_service_delete ( service_t *t, int delconf )
   /* Free memory */
   if (t->s_type == STYPE_STD)
     LIST_REMOVE(ms, s_dvb_mux_link);
-  sbuf_free(&ms->s_tsbuf);
+  pktbuf_ref_dec(ms->s_tsbuf);
+  ms->s_tsbuf = NULL;
 
   /* Remove master/slave linking */
   while (ms->s_masters.is_count > 0) {
@@ -932,7 +934,6 @@ mpegts_service_create0
     return NULL;
 
   /* Create */
-  sbuf_init(&s->s_tsbuf);
   if (conf) {
     if (s->s_dvb_last_seen > gclk()) /* sanity check */
       s->s_dvb_last_seen = gclk();
@@ -1253,8 +1254,6 @@ mpegts_service_create_raw ( mpegts_mux_t *mm )
     return NULL;
   }
 
-  sbuf_init(&s->s_tsbuf);
-
   s->s_dvb_mux        = mm;
 
   s->s_delete         = mpegts_service_delete;
@@ -286,30 +286,34 @@ ts_recv_raw(mpegts_service_t *t, uint64_t tspos, const uint8_t *tsb, int len)
 }
 
 /**
- *
+ * The chunk buffer is handed over to the subscribers (no copy)
  */
 static void
-ts_flush(mpegts_service_t *t, sbuf_t *sb)
+ts_flush(mpegts_service_t *t)
 {
-  streaming_message_t sm;
-  pktbuf_t *pb;
+  streaming_message_t *sm;
 
   t->s_tsbuf_last = mclk();
 
-  pb = pktbuf_alloc(sb->sb_data, sb->sb_ptr);
-  pb->pb_err = sb->sb_err;
-
-  memset(&sm, 0, sizeof(sm));
-  sm.sm_type = SMT_MPEGTS;
-  sm.sm_data = pb;
-  streaming_service_deliver((service_t *)t, streaming_msg_clone(&sm));
-
-  pktbuf_ref_dec(pb);
+  sm = streaming_msg_create_data(SMT_MPEGTS, t->s_tsbuf);
+  t->s_tsbuf = NULL;
+  streaming_service_deliver((service_t *)t, sm);
 
   service_set_streaming_status_flags((service_t *)t, TSS_PACKETS);
   t->s_streaming_live |= TSS_LIVE;
+}
 
-  sbuf_reset(sb, 2*TS_REMUX_BUFSIZE);
+/**
+ *
+ */
+static inline pktbuf_t *
+ts_chunk(mpegts_service_t *t)
+{
+  pktbuf_t *pb = t->s_tsbuf;
+
+  if (pb == NULL)
+    pb = t->s_tsbuf = pktbuf_alloc_room(TS_REMUX_BUFSIZE + 7*188);
+  return pb;
 }
 
 /**
@@ -318,18 +322,15 @@ ts_flush(mpegts_service_t *t, sbuf_t *sb)
 static void
 ts_remux(mpegts_service_t *t, const uint8_t *src, int len, int errors)
 {
-  sbuf_t *sb = &t->s_tsbuf;
+  pktbuf_t *pb = ts_chunk(t);
 
-  if (sb->sb_data == NULL)
-    sbuf_init_fixed(sb, TS_REMUX_BUFSIZE);
+  pb = t->s_tsbuf = pktbuf_append(pb, src, len);
+  pb->pb_err += errors;
 
-  sbuf_append(sb, src, len);
-  sb->sb_err += errors;
-
-  if(monocmpfastsec(mclk(), t->s_tsbuf_last) && sb->sb_ptr < TS_REMUX_BUFSIZE)
+  if(monocmpfastsec(mclk(), t->s_tsbuf_last) && pb->pb_size < TS_REMUX_BUFSIZE)
     return;
 
-  ts_flush(t, sb);
+  ts_flush(t);
 }
 
 /**
@@ -338,21 +339,19 @@ ts_remux(mpegts_service_t *t, const uint8_t *src, int len, int errors)
 static void
 ts_skip(mpegts_service_t *t, const uint8_t *src, int len)
 {
-  sbuf_t *sb = &t->s_tsbuf;
+  pktbuf_t *pb;
 
   if (len < 188)
     return;
 
-  if (sb->sb_data == NULL)
-    sbuf_init_fixed(sb, TS_REMUX_BUFSIZE);
-
-  sb->sb_err += len / 188;
+  pb = ts_chunk(t);
+  pb->pb_err += len / 188;
 
   if(monocmpfastsec(mclk(), t->s_tsbuf_last) &&
-     sb->sb_err < (TS_REMUX_BUFSIZE / 188))
+     pb->pb_err < (TS_REMUX_BUFSIZE / 188))
     return;
 
-  ts_flush(t, sb);
+  ts_flush(t);
   service_send_streaming_status((service_t *)t);
 }
 
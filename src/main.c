@@ -855,6 +855,7 @@ main(int argc, char **argv)
               opt_dbus         = 0,
               opt_dbus_session = 0,
               opt_nobackup     = 0,
+              opt_packconf     = 0,
               opt_nobat        = 0,
               opt_subsystems   = 0,
               opt_tprofile     = 0,
@@ -887,6 +888,10 @@ main(int argc, char **argv)
     {   0, NULL,        N_("Service configuration"),   OPT_BOOL, NULL         },
     { 'c', "config",    N_("Alternate configuration path"), OPT_STR,  &opt_config  },
     { 'B', "nobackup",  N_("Don't backup configuration tree at upgrade"), OPT_BOOL, &opt_nobackup },
+    {   0, "packconf",  N_("Keep the configuration in a packed store\n"
+                           "(the configuration tree is imported on demand\n"
+                           "and exported back when this option is removed)"),
+      OPT_BOOL, &opt_packconf },
     { 'f', "fork",      N_("Fork and run as daemon"),  OPT_BOOL, &opt_fork    },
     { 'u', "user",      N_("Run as user"),             OPT_STR,  &opt_user    },
     { 'g', "group",     N_("Run as group"),            OPT_STR,  &opt_group   },
@@ -1159,12 +1164,14 @@ main(int argc, char **argv)
     }
   }
 
+  tsscan_init();
+  startcode_init();
   tprofile_module_init(opt_tprofile);
   tprofile_init(&gtimer_profile, "gtimer");
   tprofile_init(&mtimer_profile, "mtimer");
   uuid_init();
   idnode_boot();
-  config_boot(opt_config, gid, uid, opt_user_agent);
+  config_boot(opt_config, gid, uid, opt_user_agent, opt_packconf);
   tcp_server_preinit(opt_ipv6);
   http_server_init(opt_bindaddr);    // bind to ports only
   htsp_init(opt_bindaddr);	     // bind to ports only
@@ -1274,6 +1281,7 @@ main(int argc, char **argv)
   memoryinfo_register(&pkt_memoryinfo);
   memoryinfo_register(&pktbuf_memoryinfo);
   memoryinfo_register(&pktref_memoryinfo);
+  pkt_pool_init();
 
   /**
    * Initialize subsystems
@@ -1449,6 +1457,7 @@ main(int argc, char **argv)
   tvhftrace(LS_MAIN, intlconv_done);
   tvhftrace(LS_MAIN, urlparse_done);
   tvhftrace(LS_MAIN, streaming_done);
+  tvhftrace(LS_MAIN, pkt_pool_done);
   tvhftrace(LS_MAIN, idnode_done);
   tvhftrace(LS_MAIN, notify_done);
   tvhftrace(LS_MAIN, spawn_done);
@@ -371,6 +371,23 @@ muxer_suffix(muxer_t *m,  const struct streaming_start *ss)
   return muxer_container_suffix(mc, video);
 }
 
+/**
+ * Write all packets from the batch, the references are consumed
+ */
+int
+muxer_write_pkt_batch(muxer_t *m, streaming_pkt_batch_t *spb)
+{
+  int i, r, ret = 0;
+
+  for (i = 0; i < spb->spb_count; i++) {
+    r = m->m_write_pkt(m, SMT_PACKET, spb->spb_pkts[i]);
+    if (r)
+      ret = r;
+  }
+  free(spb);
+  return ret;
+}
+
 /**
  * cache type conversions
  */
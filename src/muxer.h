@@ -183,8 +183,17 @@ static inline int muxer_destroy (muxer_t *m)
 static inline int muxer_write_meta (muxer_t *m, struct epg_broadcast *eb, const char *comment)
   { if (m) return m->m_write_meta(m, eb, comment); return -1; }
 
+int muxer_write_pkt_batch(muxer_t *m, streaming_pkt_batch_t *spb);
+
 static inline int muxer_write_pkt (muxer_t *m, streaming_message_type_t smt, void *data)
-  { if (m && data) return m->m_write_pkt(m, smt, data); return -1; }
+{
+  if (m && data) {
+    if (smt == SMT_PACKET_BATCH)
+      return muxer_write_pkt_batch(m, data);
+    return m->m_write_pkt(m, smt, data);
+  }
+  return -1;
+}
 
 static inline const char* muxer_mime (muxer_t *m, const struct streaming_start *ss)
   { if (m && ss) return m->m_mime(m, ss); return NULL; }
@@ -31,6 +31,258 @@
 memoryinfo_t pkt_memoryinfo = { .my_name = "Packets" };
 memoryinfo_t pktbuf_memoryinfo = { .my_name = "Packet buffers" };
 memoryinfo_t pktref_memoryinfo = { .my_name = "Packet references" };
+memoryinfo_t pktpool_memoryinfo = { .my_name = "Packet pool (idle)" };
+memoryinfo_t pktbufpool_memoryinfo = { .my_name = "Packet buffer pool (idle)" };
+
+/*
+ * Object pools
+ *
+ * Freed packet headers and payload buffers are kept in small per-thread
+ * caches and a shared depot for reuse. The pooled objects are plain
+ * malloc() blocks, so an object may still be released using free().
+ *
+ * The idle objects are bounded by the limits below: the depots hold
+ * at most about 3.3MB in total (256kB per payload size class, two
+ * objects of the 256kB class, up to 1024 headers per header pool),
+ * and each thread which frees packets caches at most 64kB per size
+ * class up to 32kB (about 0.5MB per thread). Larger payloads skip
+ * the thread caches.
+ */
+#define PKT_POOL_PKT      0
+#define PKT_POOL_PKTBUF   1
+#define PKT_POOL_PKTREF   2
+#define PKT_POOL_DATA     3  /* first payload size class */
+#define PKT_POOL_DATA_MIN 8  /* 256 bytes */
+#define PKT_POOL_DATA_MAX 18 /* 256 kbytes */
+#define PKT_POOL_COUNT    (PKT_POOL_DATA + PKT_POOL_DATA_MAX - PKT_POOL_DATA_MIN + 1)
+
+#define PKT_POOL_CACHE_BYTES (64*1024)       /* per thread and pool */
+#define PKT_POOL_CACHE_MAX   64
+#define PKT_POOL_DEPOT_BYTES (256*1024)      /* shared, per pool */
+#define PKT_POOL_DEPOT_MIN   2
+#define PKT_POOL_DEPOT_MAX   1024
+
+typedef struct pkt_pool_obj {
+  struct pkt_pool_obj *next;
+} pkt_pool_obj_t;
+
+typedef struct pkt_pool {
+  tvh_mutex_t     lock;
+  size_t          size;
+  int             cache_limit;
+  int             depot_limit;
+  volatile int    depot_count;  /* changed under lock, peeked without */
+  pkt_pool_obj_t *depot;
+  memoryinfo_t   *mi;
+} pkt_pool_t;
+
+typedef struct pkt_pool_cache {
+  int             count;
+  pkt_pool_obj_t *head;
+} pkt_pool_cache_t;
+
+static pkt_pool_t pkt_pools[PKT_POOL_COUNT];
+static int pkt_pool_enabled;
+static pthread_key_t pkt_pool_key;
+static __thread pkt_pool_cache_t pkt_pool_cache[PKT_POOL_COUNT];
+static __thread int pkt_pool_registered;
+
+static void
+pkt_pool_depot_put(pkt_pool_t *pp, pkt_pool_obj_t *o)
+{
+  tvh_mutex_lock(&pp->lock);
+  if (pp->depot_count < pp->depot_limit) {
+    o->next = pp->depot;
+    pp->depot = o;
+    atomic_add(&pp->depot_count, 1);
+    o = NULL;
+  }
+  tvh_mutex_unlock(&pp->lock);
+  if (o) {
+    memoryinfo_free(pp->mi, pp->size);
+    free(o);
+  }
+}
+
+static void
+pkt_pool_cache_flush(pkt_pool_t *pp, pkt_pool_cache_t *pc, int keep)
+{
+  pkt_pool_obj_t *o;
+
+  tvh_mutex_lock(&pp->lock);
+  while (pc->count > keep) {
+    o = pc->head;
+    pc->head = o->next;
+    pc->count--;
+    if (pp->depot_count < pp->depot_limit) {
+      o->next = pp->depot;
+      pp->depot = o;
+      atomic_add(&pp->depot_count, 1);
+    } else {
+      memoryinfo_free(pp->mi, pp->size);
+      free(o);
+    }
+  }
+  tvh_mutex_unlock(&pp->lock);
+}
+
+static void
+pkt_pool_thread_exit(void *aux)
+{
+  int i;
+
+  for (i = 0; i < PKT_POOL_COUNT; i++)
+    if (pkt_pool_cache[i].count)
+      pkt_pool_cache_flush(&pkt_pools[i], &pkt_pool_cache[i], 0);
+}
+
+static inline void
+pkt_pool_register(void)
+{
+  if (!pkt_pool_registered) {
+    pthread_setspecific(pkt_pool_key, pkt_pool_cache);
+    pkt_pool_registered = 1;
+  }
+}
+
+static void *
+pkt_pool_get(int idx)
+{
+  pkt_pool_t *pp = &pkt_pools[idx];
+  pkt_pool_cache_t *pc = &pkt_pool_cache[idx];
+  pkt_pool_obj_t *o;
+
+  if (!pkt_pool_enabled)
+    return malloc(pp->size);
+  if (pp->cache_limit == 0) {
+    /* no thread cache for the large objects */
+    o = NULL;
+    if (atomic_get(&pp->depot_count) > 0) {
+      tvh_mutex_lock(&pp->lock);
+      if ((o = pp->depot) != NULL) {
+        pp->depot = o->next;
+        atomic_dec(&pp->depot_count, 1);
+      }
+      tvh_mutex_unlock(&pp->lock);
+    }
+    if (o == NULL)
+      return malloc(pp->size);
+    memoryinfo_free(pp->mi, pp->size);
+    return o;
+  }
+  if (pc->head == NULL && atomic_get(&pp->depot_count) > 0) {
+    /* refill the half of the thread cache from the depot */
+    pkt_pool_register();
+    tvh_mutex_lock(&pp->lock);
+    while (pp->depot && pc->count < pp->cache_limit / 2) {
+      o = pp->depot;
+      pp->depot = o->next;
+      atomic_dec(&pp->depot_count, 1);
+      o->next = pc->head;
+      pc->head = o;
+      pc->count++;
+    }
+    tvh_mutex_unlock(&pp->lock);
+  }
+  if ((o = pc->head) == NULL)
+    return malloc(pp->size);
+  pc->head = o->next;
+  pc->count--;
+  memoryinfo_free(pp->mi, pp->size);
+  return o;
+}
+
+static void
+pkt_pool_put(int idx, void *ptr)
+{
+  pkt_pool_t *pp = &pkt_pools[idx];
+  pkt_pool_cache_t *pc = &pkt_pool_cache[idx];
+  pkt_pool_obj_t *o = ptr;
+
+  if (!pkt_pool_enabled) {
+    free(ptr);
+    return;
+  }
+  if (pp->cache_limit == 0) {
+    memoryinfo_alloc(pp->mi, pp->size);
+    pkt_pool_depot_put(pp, o);
+    return;
+  }
+  pkt_pool_register();
+  if (pc->count >= pp->cache_limit)
+    pkt_pool_cache_flush(pp, pc, pp->cache_limit / 2);
+  o->next = pc->head;
+  pc->head = o;
+  pc->count++;
+  memoryinfo_alloc(pp->mi, pp->size);
+}
+
+static inline int
+pkt_pool_data_class(size_t size)
+{
+  int c;
+
+  if (!pkt_pool_enabled || size > (1 << PKT_POOL_DATA_MAX))
+    return -1;
+  if (size <= (1 << PKT_POOL_DATA_MIN))
+    return PKT_POOL_DATA;
+  c = 32 - __builtin_clz((uint32_t)(size - 1));
+  return PKT_POOL_DATA + c - PKT_POOL_DATA_MIN;
+}
+
+static void
+pkt_pool_setup(int idx, size_t size, memoryinfo_t *mi)
+{
+  pkt_pool_t *pp = &pkt_pools[idx];
+
+  tvh_mutex_init(&pp->lock, NULL);
+  pp->size = MAX(size, sizeof(pkt_pool_obj_t));
+  pp->cache_limit = MIN(PKT_POOL_CACHE_BYTES / pp->size, PKT_POOL_CACHE_MAX);
+  if (pp->cache_limit < 2)
+    pp->cache_limit = 0;
+  pp->depot_limit = MINMAX(PKT_POOL_DEPOT_BYTES / pp->size,
+                           PKT_POOL_DEPOT_MIN, PKT_POOL_DEPOT_MAX);
+  pp->mi = mi;
+}
+
+void
+pkt_pool_init(void)
+{
+  int i;
+
+  pkt_pool_setup(PKT_POOL_PKT, sizeof(th_pkt_t), &pktpool_memoryinfo);
+  pkt_pool_setup(PKT_POOL_PKTBUF, sizeof(pktbuf_t), &pktpool_memoryinfo);
+  pkt_pool_setup(PKT_POOL_PKTREF, sizeof(th_pktref_t), &pktpool_memoryinfo);
+  for (i = PKT_POOL_DATA_MIN; i <= PKT_POOL_DATA_MAX; i++)
+    pkt_pool_setup(PKT_POOL_DATA + i - PKT_POOL_DATA_MIN, 1 << i,
+                   &pktbufpool_memoryinfo);
+  pthread_key_create(&pkt_pool_key, pkt_pool_thread_exit);
+  memoryinfo_register(&pktpool_memoryinfo);
+  memoryinfo_register(&pktbufpool_memoryinfo);
+  pkt_pool_enabled = 1;
+}
+
+void
+pkt_pool_done(void)
+{
+  pkt_pool_t *pp;
+  pkt_pool_obj_t *o;
+  int i;
+
+  pkt_pool_thread_exit(NULL);
+  pkt_pool_enabled = 0;
+  for (i = 0; i < PKT_POOL_COUNT; i++) {
+    pp = &pkt_pools[i];
+    tvh_mutex_lock(&pp->lock);
+    while ((o = pp->depot) != NULL) {
+      pp->depot = o->next;
+      memoryinfo_free(pp->mi, pp->size);
+      free(o);
+    }
+    pp->depot_count = 0;
+    tvh_mutex_unlock(&pp->lock);
+  }
+}
 
 /*
  *
@@ -42,7 +294,7 @@ pkt_destroy(th_pkt_t *pkt)
     pktbuf_ref_dec(pkt->pkt_payload);
     pktbuf_ref_dec(pkt->pkt_meta);
 
-    free(pkt);
+    pkt_pool_put(PKT_POOL_PKT, pkt);
     memoryinfo_free(&pkt_memoryinfo, sizeof(*pkt));
   }
 }
@@ -67,8 +319,9 @@ pkt_alloc(streaming_component_type_t type, const uint8_t *data, size_t datalen,
     payload = NULL;
   }
 
-  pkt = calloc(1, sizeof(th_pkt_t));
+  pkt = pkt_pool_get(PKT_POOL_PKT);
   if (pkt) {
+    memset(pkt, 0, sizeof(*pkt));
     pkt->pkt_type = type;
     pkt->pkt_payload = payload;
     pkt->pkt_dts = dts;
@@ -90,7 +343,7 @@ pkt_alloc(streaming_component_type_t type, const uint8_t *data, size_t datalen,
 th_pkt_t *
 pkt_copy_shallow(th_pkt_t *pkt)
 {
-  th_pkt_t *n = malloc(sizeof(th_pkt_t));
+  th_pkt_t *n = pkt_pool_get(PKT_POOL_PKT);
 
   if (n) {
     blacklisted_memcpy(n, pkt, sizeof(*pkt));
@@ -113,7 +366,7 @@ pkt_copy_shallow(th_pkt_t *pkt)
 th_pkt_t *
 pkt_copy_nodata(th_pkt_t *pkt)
 {
-  th_pkt_t *n = malloc(sizeof(th_pkt_t));
+  th_pkt_t *n = pkt_pool_get(PKT_POOL_PKT);
 
   if (n) {
     blacklisted_memcpy(n, pkt, sizeof(*pkt));
@@ -212,7 +465,7 @@ pktref_clear_queue(struct th_pktref_queue *q)
     while((pr = TAILQ_FIRST(q)) != NULL) {
       TAILQ_REMOVE(q, pr, pr_link);
       pkt_ref_dec(pr->pr_pkt);
-      free(pr);
+      pkt_pool_put(PKT_POOL_PKTREF, pr);
       memoryinfo_free(&pktref_memoryinfo, sizeof(*pr));
     }
   }
@@ -225,7 +478,7 @@ pktref_clear_queue(struct th_pktref_queue *q)
 void
 pktref_enqueue(struct th_pktref_queue *q, th_pkt_t *pkt)
 {
-  th_pktref_t *pr = malloc(sizeof(th_pktref_t));
+  th_pktref_t *pr = pkt_pool_get(PKT_POOL_PKTREF);
   if (pr) {
     pr->pr_pkt = pkt;
     TAILQ_INSERT_TAIL(q, pr, pr_link);
@@ -241,7 +494,7 @@ void
 pktref_enqueue_sorted(struct th_pktref_queue *q, th_pkt_t *pkt,
                       int (*cmp)(const void *, const void *))
 {
-  th_pktref_t *pr = malloc(sizeof(th_pktref_t));
+  th_pktref_t *pr = pkt_pool_get(PKT_POOL_PKTREF);
   if (pr) {
     pr->pr_pkt = pkt;
     TAILQ_INSERT_SORTED(q, pr, pr_link, cmp);
@@ -260,7 +513,7 @@ pktref_remove(struct th_pktref_queue *q, th_pktref_t *pr)
     if (q)
       TAILQ_REMOVE(q, pr, pr_link);
     pkt_ref_dec(pr->pr_pkt);
-    free(pr);
+    pkt_pool_put(PKT_POOL_PKTREF, pr);
     memoryinfo_free(&pktref_memoryinfo, sizeof(*pr));
   }
 }
@@ -292,7 +545,7 @@ pktref_get_first(struct th_pktref_queue *q)
   if (pr) {
     pkt = pr->pr_pkt;
     TAILQ_REMOVE(q, pr, pr_link);
-    free(pr);
+    pkt_pool_put(PKT_POOL_PKTREF, pr);
     memoryinfo_free(&pktref_memoryinfo, sizeof(*pr));
     return pkt;
   }
@@ -317,7 +570,7 @@ pktref_insert_head(struct th_pktref_queue *q, th_pkt_t *pkt)
 th_pktref_t *
 pktref_create(th_pkt_t *pkt)
 {
-  th_pktref_t *pr = malloc(sizeof(th_pktref_t));
+  th_pktref_t *pr = pkt_pool_get(PKT_POOL_PKTREF);
   if (pr) {
     pr->pr_pkt = pkt;
     memoryinfo_alloc(&pktref_memoryinfo, sizeof(*pr));
@@ -329,25 +582,30 @@ pktref_create(th_pkt_t *pkt)
  *
  */
 
+static void
+pktbuf_free(pktbuf_t *pb)
+{
+  memoryinfo_free(&pktbuf_memoryinfo, sizeof(*pb) + pb->pb_size);
+  if (pb->pb_class >= 0)
+    pkt_pool_put(pb->pb_class, pb->pb_data);
+  else
+    free(pb->pb_data);
+  pkt_pool_put(PKT_POOL_PKTBUF, pb);
+}
+
 void
 pktbuf_destroy(pktbuf_t *pb)
 {
-  if (pb) {
-    memoryinfo_free(&pktbuf_memoryinfo, sizeof(*pb) + pb->pb_size);
-    free(pb->pb_data);
-    free(pb);
-  }
+  if (pb)
+    pktbuf_free(pb);
 }
 
 void
 pktbuf_ref_dec(pktbuf_t *pb)
 {
   if (pb) {
-    if((atomic_add(&pb->pb_refcount, -1)) == 1) {
-      memoryinfo_free(&pktbuf_memoryinfo, sizeof(*pb) + pb->pb_size);
-      free(pb->pb_data);
-      free(pb);
-    }
+    if((atomic_add(&pb->pb_refcount, -1)) == 1)
+      pktbuf_free(pb);
   }
 }
 
@@ -366,23 +624,31 @@ pktbuf_alloc(const uint8_t *data, size_t size)
 {
   pktbuf_t *pb;
   uint8_t *buffer;
+  int cls = -1;
 
-  buffer = size > 0 ? malloc(size) : NULL;
-  if (buffer) {\
+  if (size > 0) {
+    cls = pkt_pool_data_class(size);
+    buffer = cls >= 0 ? pkt_pool_get(cls) : malloc(size);
+    if (buffer == NULL)
+      return NULL;
     if (data != NULL)
       memcpy(buffer, data, size);
-  } else if (size > 0) {
-    return NULL;
+  } else {
+    buffer = NULL;
   }
-  pb = malloc(sizeof(pktbuf_t));
+  pb = pkt_pool_get(PKT_POOL_PKTBUF);
   if (pb == NULL) {
-    free(buffer);
+    if (cls >= 0)
+      pkt_pool_put(cls, buffer);
+    else
+      free(buffer);
     return NULL;
   }
   pb->pb_refcount = 1;
   pb->pb_data = buffer;
   pb->pb_size = size;
   pb->pb_err = 0;
+  pb->pb_class = cls;
   memoryinfo_alloc(&pktbuf_memoryinfo, sizeof(*pb) + size);
   return pb;
 }
@@ -390,24 +656,48 @@ pktbuf_alloc(const uint8_t *data, size_t size)
 pktbuf_t *
 pktbuf_make(void *data, size_t size)
 {
-  pktbuf_t *pb = malloc(sizeof(pktbuf_t));
+  pktbuf_t *pb = pkt_pool_get(PKT_POOL_PKTBUF);
   if (pb) {
     pb->pb_refcount = 1;
+    pb->pb_err = 0;
     pb->pb_size = size;
     pb->pb_data = data;
+    pb->pb_class = -1;
     memoryinfo_alloc(&pktbuf_memoryinfo, sizeof(*pb) + pb->pb_size);
   }
   return pb;
 }
 
+/*
+ * Empty buffer, pktbuf_append() fills the preallocated room in place
+ */
+pktbuf_t *
+pktbuf_alloc_room(size_t size)
+{
+  pktbuf_t *pb = pktbuf_alloc(NULL, size);
+  if (pb) {
+    memoryinfo_remove(&pktbuf_memoryinfo, pb->pb_size);
+    pb->pb_size = 0;
+  }
+  return pb;
+}
+
 pktbuf_t *
 pktbuf_append(pktbuf_t *pb, const void *data, size_t size)
 {
   void *ndata;
   if (pb == NULL)
     return pktbuf_alloc(data, size);
+  if (pb->pb_class >= 0 && pb->pb_size + size <= pkt_pools[pb->pb_class].size) {
+    memcpy(pb->pb_data + pb->pb_size, data, size);
+    pb->pb_size += size;
+    memoryinfo_append(&pktbuf_memoryinfo, size);
+    return pb;
+  }
   ndata = realloc(pb->pb_data, pb->pb_size + size);
   if (ndata) {
+    /* the pooled block has been resized, it is a plain malloc block now */
+    pb->pb_class = -1;
     pb->pb_data = ndata;
     memcpy(ndata + pb->pb_size, data, size);
     pb->pb_size += size;
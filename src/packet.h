@@ -31,6 +31,7 @@ typedef struct pktbuf {
   int pb_err;
   uint8_t *pb_data;
   size_t pb_size;
+  int pb_class;       // payload pool size class, -1 = plain malloc
 } pktbuf_t;
 
 /**
@@ -98,10 +99,16 @@ TAILQ_HEAD(th_pktref_queue, th_pktref);
 extern struct memoryinfo pkt_memoryinfo;
 extern struct memoryinfo pktbuf_memoryinfo;
 extern struct memoryinfo pktref_memoryinfo;
+extern struct memoryinfo pktpool_memoryinfo;
+extern struct memoryinfo pktbufpool_memoryinfo;
 
 /**
  *
  */
+void pkt_pool_init(void);
+
+void pkt_pool_done(void);
+
 void pkt_ref_dec(th_pkt_t *pkt);
 
 void pkt_ref_inc(th_pkt_t *pkt);
@@ -161,6 +168,8 @@ pktbuf_t *pktbuf_alloc(const uint8_t *data, size_t size);
 
 pktbuf_t *pktbuf_make(void *data, size_t size);
 
+pktbuf_t *pktbuf_alloc_room(size_t size);
+
 pktbuf_t *pktbuf_append(pktbuf_t *pb, const void *data, size_t size);
 
 static inline size_t   pktbuf_len(pktbuf_t *pb) { return pb ? pb->pb_size : 0; }
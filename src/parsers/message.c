@@ -332,7 +332,9 @@ parser_input(void *opaque, streaming_message_t *sm)
 
   switch(sm->sm_type) {
   case SMT_MPEGTS:
+    streaming_batch_begin(&prs->prs_batch);
     parser_input_mpegts(prs, (pktbuf_t *)sm->sm_data);
+    streaming_batch_end(&prs->prs_batch, prs->prs_output);
     streaming_msg_free(sm);
     break;
   case SMT_START:
@@ -359,40 +361,53 @@ static streaming_ops_t parser_input_ops = {
 };
 
 /**
- * Parser get output target
+ * The parsed packets are passed by reference to all subscriptions
  */
-streaming_target_t *
-parser_output(streaming_target_t *pad)
+static void
+parser_fanout(void *opaque, streaming_message_t *sm)
+{
+  parser_t *prs = opaque;
+  streaming_pad_deliver(&prs->prs_pad, sm);
+}
+
+static htsmsg_t *
+parser_fanout_info(void *opaque, htsmsg_t *list)
 {
-  return ((parser_t *)pad)->prs_output;
+  parser_t *prs = opaque;
+  htsmsg_add_str(list, NULL, "parser output");
+  htsmsg_add_s32(list, NULL, prs->prs_pad.sp_ntargets);
+  return list;
 }
 
+static streaming_ops_t parser_fanout_ops = {
+  .st_cb   = parser_fanout,
+  .st_info = parser_fanout_info
+};
+
 /**
  * Parser create
  */
-streaming_target_t *
-parser_create(streaming_target_t *output, th_subscription_t *ts)
+static parser_t *
+parser_create(service_t *t)
 {
   parser_t *prs = calloc(1, sizeof(parser_t));
-  service_t *t = ts->ths_service;
 
-  prs->prs_output = output;
-  prs->prs_subscription = ts;
   prs->prs_service = t;
   TAILQ_INIT(&prs->prs_rstlog);
   elementary_set_init(&prs->prs_components, LS_PARSER, service_nicename(t), t);
   streaming_target_init(&prs->prs_input, &parser_input_ops, prs, 0);
-  return &prs->prs_input;
-
+  streaming_target_init(&prs->prs_fanout, &parser_fanout_ops, prs, 0);
+  streaming_pad_init(&prs->prs_pad);
+  prs->prs_output = &prs->prs_fanout;
+  return prs;
 }
 
 /*
  * Parser destroy
  */
-void
-parser_destroy(streaming_target_t *pad)
+static void
+parser_destroy(parser_t *prs)
 {
-  parser_t *prs = (parser_t *)pad;
   elementary_stream_t *es;
   parser_es_t *pes;
   streaming_queue_clear(&prs->prs_rstlog);
@@ -406,3 +421,47 @@ parser_destroy(streaming_target_t *pad)
   elementary_set_clean(&prs->prs_components, NULL, 0);
   free(prs);
 }
+
+/**
+ * Get the output pad of the service parser (created on demand),
+ * s_stream_mutex must be held
+ */
+streaming_pad_t *
+parser_service_acquire(service_t *t)
+{
+  parser_t *prs = t->s_parser;
+  streaming_message_t *sm;
+
+  lock_assert(&t->s_stream_mutex);
+
+  if (prs == NULL) {
+    prs = parser_create(t);
+    /* The service is already running, there is no subscriber yet */
+    if (elementary_set_has_streams(&t->s_components, 1)) {
+      sm = streaming_msg_create_data(SMT_START, service_build_streaming_start(t));
+      parser_input_start(prs, sm);
+    }
+    streaming_target_connect(&t->s_streaming_pad, &prs->prs_input);
+    t->s_parser = prs;
+  }
+  prs->prs_refcount++;
+  return &prs->prs_pad;
+}
+
+/**
+ * Release the service parser, s_stream_mutex must be held
+ */
+void
+parser_service_release(service_t *t)
+{
+  parser_t *prs = t->s_parser;
+
+  lock_assert(&t->s_stream_mutex);
+
+  assert(prs && prs->prs_refcount > 0);
+  if (--prs->prs_refcount > 0)
+    return;
+  streaming_target_disconnect(&t->s_streaming_pad, &prs->prs_input);
+  t->s_parser = NULL;
+  parser_destroy(prs);
+}
@@ -795,7 +795,7 @@ extract_subtitle(parser_t *t, parser_es_t *st, tt_mag_t *ttm, int64_t pts)
   th_pkt_t *pkt = pkt_alloc(st->es_type, sub, off, pts, pts, pts);
   pkt->pkt_componentindex = st->es_index;
 
-  streaming_target_deliver2(t->prs_output, streaming_msg_create_pkt(pkt));
+  streaming_batch_deliver(&t->prs_batch, t->prs_output, pkt);
 
   /* Decrease our own reference to the packet */
   pkt_ref_dec(pkt);
@@ -153,7 +153,7 @@ deliver:
     parser_rstlog(t, pkt);
   } else {
     pkt_trace(LS_PARSER, pkt, "deliver");
-    streaming_target_deliver2(t->prs_output, streaming_msg_create_pkt(pkt));
+    streaming_batch_deliver(&t->prs_batch, t->prs_output, pkt);
   }
 
   /* Decrease our own reference to the packet */
@@ -364,7 +364,7 @@ parse_pes(parser_t *t, parser_es_t *st, const uint8_t *data, int len,
 {
   uint_fast32_t sc = st->es_startcond;
   uint16_t plen;
-  int i, j, r, hlen, tmp, off;
+  int i, j, k, r, hlen, tmp, off;
 
   if (start) {
     st->es_parser_state = 1;
@@ -424,13 +424,25 @@ parse_pes(parser_t *t, parser_es_t *st, const uint8_t *data, int len,
       continue;
     }
 
-    /* quick loop to find startcode */
+    /* quick loop to find startcode spanning the previous data */
     j = i;
     do {
       sc = (sc << 8) | data[i++];
       if((sc & 0xffffff00) == 0x00000100)
         goto found;
-    } while (i < len);
+    } while (i < len && i < j + 3);
+    if (i < len) {
+      /* vectorized scan, the startcode must include the next byte */
+      k = startcode_find(data + j, data + len) - data;
+      if (k + 3 < len) {
+        for (tmp = MAX(i, k + 4 - (int)sizeof(sc)); tmp < k + 4; tmp++)
+          sc = (sc << 8) | data[tmp];
+        i = k + 4;
+        goto found;
+      }
+      for (tmp = MAX(i, len - (int)sizeof(sc)); tmp < len; tmp++)
+        sc = (sc << 8) | data[tmp];
+    }
     sbuf_append(&st->es_buf, data + j, len - j);
     break;
 
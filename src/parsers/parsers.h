@@ -28,8 +28,6 @@
 typedef struct parser_es parser_es_t;
 typedef struct parser parser_t;
 
-struct th_subscription;
-
 typedef void (parse_callback_t)
   (parser_t *t, parser_es_t *st, const uint8_t *data, int len, int start);
 
@@ -78,10 +76,13 @@ struct parser {
 
   streaming_target_t *prs_output;
 
-  th_subscription_t *prs_subscription;
-
   service_t *prs_service;
 
+  /* Output shared by the subscriptions */
+  streaming_target_t prs_fanout;
+  streaming_pad_t    prs_pad;
+  int                prs_refcount;
+
   /* Elementary streams */
   elementary_set_t prs_components;
 
@@ -100,6 +101,9 @@ struct parser {
 
   /* restart_pending log */
   struct streaming_message_queue prs_rstlog;
+
+  /* packets parsed from one SMT_MPEGTS message */
+  streaming_batch_t prs_batch;
 };
 
 static inline int64_t
@@ -123,11 +127,9 @@ getpts(const uint8_t *p)
   }
 }
 
-streaming_target_t * parser_create(streaming_target_t *output, struct th_subscription *ts);
-
-void parser_destroy(streaming_target_t *pad);
+streaming_pad_t *parser_service_acquire(service_t *t);
 
-streaming_target_t * parser_output(streaming_target_t *pad);
+void parser_service_release(service_t *t);
 
 void parse_mpeg_ts(parser_t *t, parser_es_t *st, const uint8_t *data,
                    int len, int start, int err);
@@ -0,0 +1,166 @@
+/*
+ *  Elementary stream start code scanner
+ *  Copyright (C) 2026 Tvheadend
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tvheadend.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define STARTCODE_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define STARTCODE_NEON 1
+#include <arm_neon.h>
+#endif
+
+/*
+ * All scanners return the pointer to the first byte of the first
+ * 00 00 01 sequence which lies completely in [p, end), or 'end'.
+ */
+typedef const uint8_t *(*startcode_fn_t)(const uint8_t *p, const uint8_t *end);
+
+static const uint8_t *
+startcode_find_scalar ( const uint8_t *p, const uint8_t *end )
+{
+  while (end - p >= 3) {
+    if (p[2] > 1) {
+      p += 3;
+    } else if (p[2] == 0) {
+      p++;
+    } else {
+      if (p[0] == 0 && p[1] == 0)
+        return p;
+      p += 3;
+    }
+  }
+  return end;
+}
+
+#if STARTCODE_X86
+
+__attribute__((target("sse2")))
+static const uint8_t *
+startcode_find_sse2 ( const uint8_t *p, const uint8_t *end )
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one  = _mm_set1_epi8(1);
+  __m128i m;
+  int bits;
+
+  while (end - p >= 16 + 2) {
+    m = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 2)), one);
+    if (_mm_movemask_epi8(m)) {
+      m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), zero));
+      m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 1)), zero));
+      bits = _mm_movemask_epi8(m);
+      if (bits)
+        return p + __builtin_ctz(bits);
+    }
+    p += 16;
+  }
+
+  return startcode_find_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static const uint8_t *
+startcode_find_avx2 ( const uint8_t *p, const uint8_t *end )
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one  = _mm256_set1_epi8(1);
+  __m256i m;
+  uint32_t bits;
+
+  while (end - p >= 32 + 2) {
+    m = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + 2)), one);
+    if (_mm256_movemask_epi8(m)) {
+      m = _mm256_and_si256(m, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p), zero));
+      m = _mm256_and_si256(m, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + 1)), zero));
+      bits = _mm256_movemask_epi8(m);
+      if (bits)
+        return p + __builtin_ctz(bits);
+    }
+    p += 32;
+  }
+
+  return startcode_find_sse2(p, end);
+}
+
+#endif
+
+#if STARTCODE_NEON
+
+static const uint8_t *
+startcode_find_neon ( const uint8_t *p, const uint8_t *end )
+{
+  const uint8x16_t zero = vdupq_n_u8(0);
+  const uint8x16_t one  = vdupq_n_u8(1);
+  uint8x16_t m;
+
+  while (end - p >= 16 + 2) {
+    m = vceqq_u8(vld1q_u8(p + 2), one);
+    m = vandq_u8(m, vceqq_u8(vld1q_u8(p), zero));
+    m = vandq_u8(m, vceqq_u8(vld1q_u8(p + 1), zero));
+    if (vmaxvq_u8(m))
+      break; /* the scalar code locates it in this block */
+    p += 16;
+  }
+
+  return startcode_find_scalar(p, end);
+}
+
+static startcode_fn_t startcode_find_fn = startcode_find_neon;
+
+#else
+
+static startcode_fn_t startcode_find_fn = startcode_find_scalar;
+
+#endif
+
+/*
+ * Find the first 00 00 01 sequence in [p, end), return 'end' if none
+ */
+const uint8_t *
+startcode_find ( const uint8_t *p, const uint8_t *end )
+{
+  return startcode_find_fn(p, end);
+}
+
+/*
+ * Select the widest implementation supported by this CPU
+ */
+void
+startcode_init ( void )
+{
+#if STARTCODE_NEON
+  const char *name = "neon";
+#else
+  const char *name = "scalar";
+#endif
+
+#if STARTCODE_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    startcode_find_fn = startcode_find_avx2;
+    name = "avx2";
+  } else if (__builtin_cpu_supports("sse2")) {
+    startcode_find_fn = startcode_find_sse2;
+    name = "sse2";
+  }
+#endif
+  tvhdebug(LS_MAIN, "ES start code scanner: %s", name);
+}
@@ -38,6 +38,8 @@ typedef struct globalheaders {
 #define MAX_SCAN_TIME   5000  // in ms
 #define MAX_NOPKT_TIME  2500  // in ms
 
+static void globalheaders_input(void *opaque, streaming_message_t *sm);
+
 /**
  *
  */
@@ -285,6 +287,7 @@ gh_hold(globalheaders_t *gh, streaming_message_t *sm)
 {
   th_pkt_t *pkt;
   streaming_start_component_t *ssc;
+  streaming_batch_t batch = { 0 };
 
   switch(sm->sm_type) {
   case SMT_PACKET:
@@ -320,13 +323,13 @@ gh_hold(globalheaders_t *gh, streaming_message_t *sm)
     streaming_target_deliver2(gh->gh_output, sm);
 
     // Send all pending packets
+    streaming_batch_begin(&batch);
     while((pkt = pktref_get_first(&gh->gh_holdq)) != NULL) {
-      if (pkt->pkt_payload) {
-        sm = streaming_msg_create_pkt(pkt);
-        streaming_target_deliver2(gh->gh_output, sm);
-      }
+      if (pkt->pkt_payload)
+        streaming_batch_deliver(&batch, gh->gh_output, pkt);
       pkt_ref_dec(pkt);
     }
+    streaming_batch_end(&batch, gh->gh_output);
     gh->gh_passthru = 1;
     break;
 
@@ -354,6 +357,10 @@ gh_hold(globalheaders_t *gh, streaming_message_t *sm)
   case SMT_TIMESHIFT_STATUS:
     streaming_target_deliver2(gh->gh_output, sm);
     break;
+  case SMT_PACKET_BATCH:
+    /* split, the header might complete in the middle */
+    streaming_msg_unbatch(sm, globalheaders_input, gh);
+    break;
   }
 }
 
@@ -364,7 +371,9 @@ gh_hold(globalheaders_t *gh, streaming_message_t *sm)
 static void
 gh_pass(globalheaders_t *gh, streaming_message_t *sm)
 {
+  streaming_pkt_batch_t *spb;
   th_pkt_t *pkt;
+  int i, j;
   switch(sm->sm_type) {
   case SMT_START:
     /* stop */
@@ -398,6 +407,21 @@ gh_pass(globalheaders_t *gh, streaming_message_t *sm)
     else
       streaming_msg_free(sm);
     break;
+  case SMT_PACKET_BATCH:
+    spb = sm->sm_data;
+    for (i = j = 0; i < spb->spb_count; i++) {
+      pkt = spb->spb_pkts[i];
+      if (pkt->pkt_payload || pkt->pkt_err)
+        spb->spb_pkts[j++] = pkt;
+      else
+        pkt_ref_dec(pkt);
+    }
+    spb->spb_count = j;
+    if (j)
+      streaming_target_deliver2(gh->gh_output, sm);
+    else
+      streaming_msg_free(sm);
+    break;
   }
 }
 
@@ -426,8 +450,9 @@ globalheaders_input_info(void *opaque, htsmsg_t *list)
 }
 
 static streaming_ops_t globalheaders_input_ops = {
-  .st_cb   = globalheaders_input,
-  .st_info = globalheaders_input_info
+  .st_cb    = globalheaders_input,
+  .st_info  = globalheaders_input_info,
+  .st_batch = 1
 };
 
 
@@ -73,6 +73,8 @@ typedef struct tsfix {
   struct th_pktref_queue tf_ptsq;
   struct th_pktref_queue tf_backlog;
 
+  streaming_batch_t tf_batch;
+
 } tsfix_t;
 
 
@@ -319,8 +321,7 @@ deliver:
               ref, tfs->tfs_dts_epoch);
   }
 
-  streaming_message_t *sm = streaming_msg_create_pkt(pkt);
-  streaming_target_deliver2(tf->tf_output, sm);
+  streaming_batch_deliver(&tf->tf_batch, tf->tf_output, pkt);
   pkt_ref_dec(pkt);
 }
 
@@ -546,16 +547,14 @@ compute_pts(tsfix_t *tf, tfstream_t *tfs, th_pkt_t *pkt)
  *
  */
 static void
-tsfix_input_packet(tsfix_t *tf, streaming_message_t *sm)
+tsfix_input_packet(tsfix_t *tf, th_pkt_t *pkt)
 {
-  th_pkt_t *pkt;
   tfstream_t *tfs, *tfs2;
   int64_t diff, diff2, threshold;
   int r;
 
-  pkt = pkt_copy_shallow(sm->sm_data);
+  pkt = pkt_copy_shallow(pkt);
   tfs = tfs_find(tf, pkt);
-  streaming_msg_free(sm);
 
   if (tfs == NULL || mclk() < tf->tf_start_time) {
     tsfix_packet_drop(tfs, pkt, "start time");
@@ -600,10 +599,8 @@ tsfix_input_packet(tsfix_t *tf, streaming_message_t *sm)
 
   if (pkt->pkt_dts == PTS_UNSET) {
     if (tfs->tfs_last_dts_in == PTS_UNSET) {
-      if (tfs->tfs_type == SCT_TELETEXT) {
-        sm = streaming_msg_create_pkt(pkt);
-        streaming_target_deliver2(tf->tf_output, sm);
-      }
+      if (tfs->tfs_type == SCT_TELETEXT)
+        streaming_batch_deliver(&tf->tf_batch, tf->tf_output, pkt);
       pkt_ref_dec(pkt);
       return;
     }
@@ -632,14 +629,24 @@ static void
 tsfix_input(void *opaque, streaming_message_t *sm)
 {
   tsfix_t *tf = opaque;
+  streaming_pkt_batch_t *spb;
+  int i;
 
   switch(sm->sm_type) {
   case SMT_PACKET:
-    if (tf->tf_wait_for_video) {
-      streaming_msg_free(sm);
-      return;
+    if (!tf->tf_wait_for_video)
+      tsfix_input_packet(tf, sm->sm_data);
+    streaming_msg_free(sm);
+    return;
+  case SMT_PACKET_BATCH:
+    if (!tf->tf_wait_for_video) {
+      spb = sm->sm_data;
+      streaming_batch_begin(&tf->tf_batch);
+      for (i = 0; i < spb->spb_count; i++)
+        tsfix_input_packet(tf, spb->spb_pkts[i]);
+      streaming_batch_end(&tf->tf_batch, tf->tf_output);
     }
-    tsfix_input_packet(tf, sm);
+    streaming_msg_free(sm);
     return;
   case SMT_START:
     tsfix_stop(tf);
@@ -690,8 +697,9 @@ tsfix_input_info(void *opaque, htsmsg_t *list)
 }
 
 static streaming_ops_t tsfix_input_ops = {
-  .st_cb   = tsfix_input,
-  .st_info = tsfix_input_info
+  .st_cb    = tsfix_input,
+  .st_info  = tsfix_input_info,
+  .st_batch = 1
 };
 
 
@@ -703,7 +703,8 @@ profile_input(void *opaque, streaming_message_t *sm)
     prch->prch_start_pending = 1;
     streaming_msg_free(sm);
     sm = NULL;
-  } else if (sm->sm_type == SMT_PACKET || sm->sm_type == SMT_MPEGTS) {
+  } else if (sm->sm_type == SMT_PACKET || sm->sm_type == SMT_MPEGTS ||
+             sm->sm_type == SMT_PACKET_BATCH) {
     streaming_msg_free(sm);
     return;
   }
@@ -724,8 +725,9 @@ profile_input_info(void *opaque, htsmsg_t *list)
 }
 
 static streaming_ops_t profile_input_ops = {
-  .st_cb   = profile_input,
-  .st_info = profile_input_info
+  .st_cb    = profile_input,
+  .st_info  = profile_input_info,
+  .st_batch = 1
 };
 
 /*
@@ -759,36 +761,61 @@ profile_input_queue_info(void *opaque, htsmsg_t *list)
 }
 
 static streaming_ops_t profile_input_queue_ops = {
-  .st_cb   = profile_input_queue,
-  .st_info = profile_input_queue_info
+  .st_cb    = profile_input_queue,
+  .st_info  = profile_input_queue_info,
+  .st_batch = 1
 };
 
+/*
+ * Time correction, returns NULL when the packet is dropped
+ */
+static th_pkt_t *
+profile_sharer_ts_delta(profile_chain_t *prch, th_pkt_t *pkt)
+{
+  th_pkt_t *n;
+
+  if (prch->prch_ts_delta == PTS_UNSET)
+    prch->prch_ts_delta = MAX(0, pkt->pkt_dts - 10000);
+  if (pkt->pkt_pts >= prch->prch_ts_delta &&
+      pkt->pkt_dts >= prch->prch_ts_delta &&
+      pkt->pkt_pcr >= prch->prch_ts_delta) {
+    n = pkt_copy_shallow(pkt);
+    pkt_ref_dec(pkt);
+    n->pkt_pts -= prch->prch_ts_delta;
+    n->pkt_dts -= prch->prch_ts_delta;
+    n->pkt_pcr -= prch->prch_ts_delta;
+    return n;
+  }
+  pkt_trace(LS_PROFILE, pkt, "packet drop (delta %"PRId64")", prch->prch_ts_delta);
+  pkt_ref_dec(pkt);
+  return NULL;
+}
+
 /*
  *
  */
 static void
 profile_sharer_deliver(profile_chain_t *prch, streaming_message_t *sm)
 {
+  streaming_pkt_batch_t *spb;
+  th_pkt_t *pkt;
+  int i, j;
+
+  if (!prch->prch_ts_delta)
+    goto deliver;
   if (sm->sm_type == SMT_PACKET) {
-    if (!prch->prch_ts_delta)
-      goto deliver;
-    th_pkt_t *pkt = sm->sm_data;
-    if (prch->prch_ts_delta == PTS_UNSET)
-      prch->prch_ts_delta = MAX(0, pkt->pkt_dts - 10000);
-    /*
-     * time correction here
-     */
-    if (pkt->pkt_pts >= prch->prch_ts_delta &&
-        pkt->pkt_dts >= prch->prch_ts_delta &&
-        pkt->pkt_pcr >= prch->prch_ts_delta) {
-      th_pkt_t *n = pkt_copy_shallow(pkt);
-      pkt_ref_dec(pkt);
-      n->pkt_pts -= prch->prch_ts_delta;
-      n->pkt_dts -= prch->prch_ts_delta;
-      n->pkt_pcr -= prch->prch_ts_delta;
-      sm->sm_data = n;
-    } else {
-      pkt_trace(LS_PROFILE, pkt, "packet drop (delta %"PRId64")", prch->prch_ts_delta);
+    sm->sm_data = profile_sharer_ts_delta(prch, sm->sm_data);
+    if (sm->sm_data == NULL) {
+      streaming_msg_free(sm);
+      return;
+    }
+  } else if (sm->sm_type == SMT_PACKET_BATCH) {
+    spb = sm->sm_data;
+    for (i = j = 0; i < spb->spb_count; i++)
+      if ((pkt = profile_sharer_ts_delta(prch, spb->spb_pkts[i])) != NULL)
+        spb->spb_pkts[j++] = pkt;
+    spb->spb_count = j;
+    if (j == 0) {
       streaming_msg_free(sm);
       return;
     }
@@ -806,6 +833,10 @@ profile_sharer_input(void *opaque, streaming_message_t *sm)
   profile_sharer_t *prsh = opaque;
   profile_chain_t *prch, *next, *run = NULL;
 
+#if ENABLE_TIMESHIFT
+  if (prsh->prsh_timeshift)
+    streaming_target_deliver(prsh->prsh_timeshift, streaming_msg_clone(sm));
+#endif
   if (sm->sm_type == SMT_STOP) {
     if (prsh->prsh_start_msg)
       streaming_start_unref(prsh->prsh_start_msg);
@@ -827,7 +858,8 @@ profile_sharer_input(void *opaque, streaming_message_t *sm)
       run = prch;
       continue;
     }
-    if (sm->sm_type != SMT_PACKET && sm->sm_type != SMT_MPEGTS)
+    if (sm->sm_type != SMT_PACKET && sm->sm_type != SMT_MPEGTS &&
+        sm->sm_type != SMT_PACKET_BATCH)
       continue;
     if (prch->prch_stop)
       continue;
@@ -850,8 +882,9 @@ profile_sharer_input_info(void *opaque, htsmsg_t *list)
 }
 
 static streaming_ops_t profile_sharer_input_ops = {
-  .st_cb   = profile_sharer_input,
-  .st_info = profile_sharer_input_info
+  .st_cb    = profile_sharer_input,
+  .st_info  = profile_sharer_input_info,
+  .st_batch = 1
 };
 
 /*
@@ -950,6 +983,11 @@ profile_sharer_create(profile_sharer_t *prsh,
   prch->prch_post_share = dst;
   tvh_mutex_lock(&prsh->prsh_queue_mutex);
   prch->prch_ts_delta = LIST_EMPTY(&prsh->prsh_chains) ? 0 : PTS_UNSET;
+#if ENABLE_TIMESHIFT
+  /* the shared timeshift buffer requires the same time base */
+  if (prsh->prsh_timeshift)
+    prch->prch_ts_delta = 0;
+#endif
   LIST_INSERT_HEAD(&prsh->prsh_chains, prch, prch_sharer_link);
   prch->prch_sharer = prsh;
   if (!prsh->prsh_master)
@@ -1210,6 +1248,16 @@ const idclass_t profile_htsp_class =
   }
 };
 
+#if ENABLE_TIMESHIFT
+static int
+profile_htsp_can_share(profile_chain_t *prch,
+                       profile_chain_t *joiner)
+{
+  /* only the chains with the shared timeshift buffer */
+  return joiner->prch_can_share == profile_htsp_can_share;
+}
+#endif
+
 static int
 profile_htsp_work(profile_chain_t *prch,
                   streaming_target_t *dst,
@@ -1217,6 +1265,11 @@ profile_htsp_work(profile_chain_t *prch,
 {
   profile_sharer_t *prsh;
 
+#if ENABLE_TIMESHIFT
+  if (timeshift_period > 0 && timeshift_conf.shared)
+    prch->prch_can_share = profile_htsp_can_share;
+#endif
+
   prsh = profile_sharer_find(prch);
   if (!prsh)
     goto fail;
@@ -1227,7 +1280,9 @@ profile_htsp_work(profile_chain_t *prch,
 
 #if ENABLE_TIMESHIFT
   if (timeshift_period > 0)
-    dst = prch->prch_timeshift = timeshift_create(dst, timeshift_period);
+    dst = prch->prch_timeshift =
+      timeshift_create(dst, timeshift_period,
+                       prch->prch_can_share ? &prsh->prsh_timeshift : NULL);
 #endif
 
   dst = prch->prch_gh = globalheaders_create(dst);
@@ -2698,7 +2753,7 @@ profile_transcode_work(profile_chain_t *prch,
 
 #if ENABLE_TIMESHIFT
   if (timeshift_period > 0)
-    dst = prch->prch_timeshift = timeshift_create(dst, timeshift_period);
+    dst = prch->prch_timeshift = timeshift_create(dst, timeshift_period, NULL);
 #endif
   if (profile_sharer_create(prsh, prch, dst))
     goto fail;
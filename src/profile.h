@@ -160,6 +160,9 @@ typedef struct profile_sharer {
 #if ENABLE_LIBAV
   struct streaming_target  *prsh_transcoder;
 #endif
+#if ENABLE_TIMESHIFT
+  struct streaming_target  *prsh_timeshift;
+#endif
 } profile_sharer_t;
 
 void profile_register(const idclass_t *clazz, profile_builder_t builder);
@@ -390,7 +390,7 @@ satip_rtp_thread(void *aux)
 
   tvh_mutex_lock(&sq->sq_mutex);
   while (rtp->sq && !fatal) {
-    sm = TAILQ_FIRST(&sq->sq_queue);
+    sm = streaming_queue_first(sq);
     if (sm == NULL) {
       if (tcp) {
         r = satip_rtp_flush_tcp_data(rtp);
@@ -444,6 +444,7 @@ satip_rtp_thread(void *aux)
     case SMT_SERVICE_STATUS:
     case SMT_TIMESHIFT_STATUS:
     case SMT_DESCRAMBLE_INFO:
+    case SMT_PACKET_BATCH:
       break;
     }
 
@@ -378,6 +378,11 @@ typedef struct service {
    */
   streaming_pad_t s_streaming_pad;
 
+  /**
+   * Parser shared by the packet subscriptions (s_stream_mutex)
+   */
+  struct parser *s_parser;
+
   tvhlog_limit_t s_tei_log;
 
   /*
@@ -439,7 +439,7 @@ service_mapper_thread ( void *aux )
 
       /* Wait for message */
       tvh_mutex_lock(&sq->sq_mutex);
-      while((sm = TAILQ_FIRST(&sq->sq_queue)) == NULL) {
+      while((sm = streaming_queue_first(sq)) == NULL) {
         tvh_cond_wait(&sq->sq_cond, &sq->sq_mutex);
         if (!tvheadend_is_running())
           break;
@@ -479,7 +479,7 @@ service_mapper_thread ( void *aux )
       break;
 
     tvh_mutex_lock(&sq->sq_mutex);
-    streaming_queue_clear(&sq->sq_queue);
+    streaming_queue_flush(sq);
     tvh_mutex_unlock(&sq->sq_mutex);
  
     tvh_mutex_lock(&global_lock);
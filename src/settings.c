@@ -64,6 +64,7 @@ hts_settings_init(const char *confpath)
 void
 hts_settings_done(void)
 {
+  hts_settings_pack_done();
   free(settingspath);
 }
 
@@ -112,6 +113,36 @@ _hts_settings_buildpath
   }
 }
 
+/*
+ * Build the path relative to the settings root for the packed store,
+ * returns non-zero when the store is not used for this path
+ */
+static int
+_hts_settings_packpath
+  (char *dst, size_t dstsize, const char *fmt, va_list ap)
+{
+  va_list ap2;
+  char *s, *d;
+
+  if (!hts_settings_pack_active())
+    return 1;
+  va_copy(ap2, ap);
+  _hts_settings_buildpath(dst, dstsize, fmt, ap2, NULL);
+  va_end(ap2);
+  if (*dst == '/')
+    return 1;
+  for (s = d = dst; *s; s++)
+    if (*s != '/' || (d != dst && d[-1] != '/'))
+      *d++ = *s;
+  if (d != dst && d[-1] == '/')
+    d--;
+  *d = '\0';
+  /* The EPG database files are not settings records */
+  if (!strncmp(dst, "epgdb", 5) && strchr(dst, '/') == NULL)
+    return 1;
+  return 0;
+}
+
 int
 hts_settings_buildpath
   (char *dst, size_t dstsize, const char *fmt, ...)
@@ -142,6 +173,15 @@ hts_settings_save(htsmsg_t *record, const char *pathfmt, ...)
   if(settingspath == NULL)
     return;
 
+  /* Packed store */
+  va_start(ap, pathfmt);
+  r = _hts_settings_packpath(path, sizeof(path), pathfmt, ap);
+  va_end(ap);
+  if (r == 0) {
+    hts_settings_pack_save(path, record);
+    return;
+  }
+
   /* Clean the path */
   va_start(ap, pathfmt);
   _hts_settings_buildpath(path, sizeof(path), pathfmt, ap, settingspath);
@@ -319,6 +359,64 @@ hts_settings_load_path(const char *fullpath, int depth)
   return r;
 }
 
+/*
+ * Collect all records below the path for the packed store import
+ */
+static void
+hts_settings_import_path(const char *fullpath, const char *path, htsmsg_t *list)
+{
+  char child[PATH_MAX], childpath[PATH_MAX];
+  const char *name;
+  struct stat st;
+  fb_dirent **namelist, *d;
+  htsmsg_t *e, *c;
+  int n, i;
+
+  if (stat(fullpath, &st))
+    return;
+
+  /* Directory */
+  if (S_ISDIR(st.st_mode)) {
+    if((n = fb_scandir(fullpath, &namelist)) < 0)
+      return;
+    for(i = 0; i < n; i++) {
+      d = namelist[i];
+      name = d->name;
+      if(name[0] != '.' && name[0] && name[strlen(name)-1] != '~') {
+        snprintf(child, sizeof(child), "%s/%s", fullpath, name);
+        snprintf(childpath, sizeof(childpath), "%s%s%s",
+                 path, *path ? "/" : "", name);
+        hts_settings_import_path(child, childpath, list);
+      }
+      free(d);
+    }
+    free(namelist);
+
+  /* File */
+  } else if ((c = hts_settings_load_one(fullpath)) != NULL) {
+    e = htsmsg_create_map();
+    htsmsg_add_str(e, "p", path);
+    htsmsg_add_msg(e, "d", c);
+    htsmsg_add_msg(list, NULL, e);
+  }
+}
+
+/*
+ * Import the records from the configuration tree to the packed store
+ */
+static void
+hts_settings_import(const char *path)
+{
+  char fullpath[PATH_MAX];
+  htsmsg_t *list = htsmsg_create_list();
+
+  if (snprintf(fullpath, sizeof(fullpath), "%s%s%s",
+               settingspath, *path ? "/" : "", path) < sizeof(fullpath))
+    hts_settings_import_path(fullpath, path, list);
+  hts_settings_pack_import(path, list);
+  htsmsg_destroy(list);
+}
+
 /**
  *
  */
@@ -331,9 +429,15 @@ hts_settings_vload(const char *pathfmt, va_list ap, int depth)
   va_copy(ap2, ap);
 
   /* Try normal path */
-  _hts_settings_buildpath(fullpath, sizeof(fullpath), 
-                          pathfmt, ap, settingspath);
-  ret = hts_settings_load_path(fullpath, depth);
+  if (_hts_settings_packpath(fullpath, sizeof(fullpath), pathfmt, ap) == 0) {
+    if (!hts_settings_pack_imported(fullpath))
+      hts_settings_import(fullpath);
+    ret = hts_settings_pack_load(fullpath, depth);
+  } else {
+    _hts_settings_buildpath(fullpath, sizeof(fullpath),
+                            pathfmt, ap, settingspath);
+    ret = hts_settings_load_path(fullpath, depth);
+  }
 
   /* Try bundle path */
   if (!ret && *pathfmt != '/') {
@@ -385,6 +489,12 @@ hts_settings_remove(const char *pathfmt, ...)
   va_list ap;
   struct stat st;
 
+  va_start(ap, pathfmt);
+  if (_hts_settings_packpath(fullpath, sizeof(fullpath), pathfmt, ap) == 0)
+    hts_settings_pack_remove(fullpath);
+  va_end(ap);
+
+  /* The configuration tree must not bring the records back on import */
   va_start(ap, pathfmt);
   _hts_settings_buildpath(fullpath, sizeof(fullpath),
                           pathfmt, ap, settingspath);
@@ -436,6 +546,14 @@ hts_settings_exists ( const char *pathfmt, ... )
   va_list ap;
   char path[PATH_MAX];
   struct stat st;
+  int r;
+
+  /* Packed store */
+  va_start(ap, pathfmt);
+  r = _hts_settings_packpath(path, sizeof(path), pathfmt, ap);
+  va_end(ap);
+  if (r == 0 && hts_settings_pack_imported(path))
+    return hts_settings_pack_exists(path);
 
   /* Build path */
   va_start(ap, pathfmt);
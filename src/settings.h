@@ -48,6 +48,17 @@ int hts_settings_makedirs ( const char *path );
 
 int hts_settings_exists ( const char *pathfmt, ... );
 
+/* Packed store (settings_pack.c) */
+void hts_settings_pack_init(int enable);
+void hts_settings_pack_done(void);
+int hts_settings_pack_active(void);
+int hts_settings_pack_imported(const char *path);
+void hts_settings_pack_import(const char *path, htsmsg_t *records);
+htsmsg_t *hts_settings_pack_load(const char *path, int depth);
+int hts_settings_pack_exists(const char *path);
+void hts_settings_pack_save(const char *path, htsmsg_t *record);
+void hts_settings_pack_remove(const char *path);
+
 char *hts_settings_get_xdg_dir_lookup (const char *name);
 char *hts_settings_get_xdg_dir_with_fallback (const char *name, const char *fallback);
 
@@ -0,0 +1,797 @@
+/*
+ *  Packed settings store
+ *  Copyright (C) 2026 Tvheadend
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tvheadend.h"
+#include "htsmsg.h"
+#include "htsmsg_binary2.h"
+#include "sbuf.h"
+#include "settings.h"
+
+/*
+ * All records are kept in memory, keyed by the relative settings path.
+ * The snapshot (config.pack) holds all records, every change is appended
+ * to the write-ahead log (config.pack.log) before the call returns.
+ * When the log grows over the snapshot size, a new snapshot is
+ * serialized and written by a background thread; the changes made in
+ * the meantime go to config.pack.log.new which replaces the old log once
+ * the snapshot is renamed in place. Both the snapshot and the log start
+ * with a header carrying the generation, so the log of an older snapshot
+ * is never replayed.
+ *
+ * The JSON tree is imported lazily: a path which was not imported yet is
+ * read from the files on the first load and then served from the store.
+ */
+
+#define PACK_FILE         "config.pack"
+#define PACK_LOG          "config.pack.log"
+#define PACK_LOG_NEW      "config.pack.log.new"
+#define PACK_EXPORTED     "config.pack.exported"
+#define PACK_VERSION      1
+#define PACK_COMPACT_MIN  (1024*1024)
+
+typedef struct pack_entry {
+  RB_ENTRY(pack_entry) link;
+  char                *path;
+  htsmsg_t            *msg;
+} pack_entry_t;
+
+typedef struct pack_import {
+  LIST_ENTRY(pack_import) link;
+  char                   *path;
+} pack_import_t;
+
+typedef struct pack_compact {
+  sbuf_t    sb;
+  uint32_t  gen;
+} pack_compact_t;
+
+static int               pack_active;
+static tvh_mutex_t       pack_lock;
+static RB_HEAD(, pack_entry) pack_entries;
+static LIST_HEAD(, pack_import) pack_imports;
+static uint32_t          pack_gen;
+static int               pack_log_fd = -1;
+static int64_t           pack_log_size;
+static int64_t           pack_log_base;     /* log size at the failed compaction */
+static int64_t           pack_snapshot_size;
+static pthread_t         pack_compact_tid;
+static int               pack_compact_running;
+static int               pack_compact_failed;
+
+static int
+pack_entry_cmp(const void *a, const void *b)
+{
+  return strcmp(((const pack_entry_t *)a)->path,
+                ((const pack_entry_t *)b)->path);
+}
+
+static pack_entry_t *
+pack_find(const char *path)
+{
+  pack_entry_t skel;
+  skel.path = (char *)path;
+  return RB_FIND(&pack_entries, &skel, link, pack_entry_cmp);
+}
+
+/*
+ * Return the first entry below the directory 'path'
+ */
+static pack_entry_t *
+pack_find_dir(const char *path, char *prefix, size_t prefixlen)
+{
+  pack_entry_t skel, *e;
+
+  snprintf(prefix, prefixlen, "%s%s", path, *path ? "/" : "");
+  skel.path = prefix;
+  e = RB_FIND_GE(&pack_entries, &skel, link, pack_entry_cmp);
+  if (e && strncmp(e->path, prefix, strlen(prefix)))
+    e = NULL;
+  return e;
+}
+
+/*
+ * The record of the log entry (a map or a list)
+ */
+static htsmsg_t *
+pack_record(htsmsg_t *m)
+{
+  htsmsg_field_t *f = htsmsg_field_find(m, "d");
+
+  if (f && (f->hmf_type == HMF_MAP || f->hmf_type == HMF_LIST))
+    return f->hmf_msg;
+  return NULL;
+}
+
+static void
+pack_set(const char *path, htsmsg_t *msg)
+{
+  pack_entry_t *e = pack_find(path);
+
+  if (e) {
+    htsmsg_destroy(e->msg);
+  } else {
+    e = calloc(1, sizeof(*e));
+    e->path = strdup(path);
+    if (RB_INSERT_SORTED(&pack_entries, e, link, pack_entry_cmp))
+      abort();
+  }
+  e->msg = msg;
+}
+
+static void
+pack_entry_free(pack_entry_t *e)
+{
+  RB_REMOVE(&pack_entries, e, link);
+  htsmsg_destroy(e->msg);
+  free(e->path);
+  free(e);
+}
+
+static void
+pack_del(const char *path)
+{
+  pack_entry_t *e, *n;
+  char prefix[PATH_MAX];
+  size_t l;
+
+  if ((e = pack_find(path)) != NULL)
+    pack_entry_free(e);
+  e = pack_find_dir(path, prefix, sizeof(prefix));
+  l = strlen(prefix);
+  for ( ; e && !strncmp(e->path, prefix, l); e = n) {
+    n = RB_NEXT(e, link);
+    pack_entry_free(e);
+  }
+}
+
+static int
+pack_is_imported(const char *path)
+{
+  pack_import_t *pi;
+  size_t l;
+
+  LIST_FOREACH(pi, &pack_imports, link) {
+    l = strlen(pi->path);
+    if (l == 0)
+      return 1;
+    if (!strncmp(path, pi->path, l) && (path[l] == '\0' || path[l] == '/'))
+      return 1;
+  }
+  return 0;
+}
+
+static void
+pack_add_import(const char *path)
+{
+  pack_import_t *pi;
+
+  if (pack_is_imported(path))
+    return;
+  pi = calloc(1, sizeof(*pi));
+  pi->path = strdup(path);
+  LIST_INSERT_HEAD(&pack_imports, pi, link);
+}
+
+static void
+pack_clear(void)
+{
+  pack_entry_t *e;
+  pack_import_t *pi;
+
+  while ((e = RB_FIRST(&pack_entries)) != NULL)
+    pack_entry_free(e);
+  while ((pi = LIST_FIRST(&pack_imports)) != NULL) {
+    LIST_REMOVE(pi, link);
+    free(pi->path);
+    free(pi);
+  }
+}
+
+/* **************************************************************************
+ * Files
+ * *************************************************************************/
+
+static int
+pack_path(char *dst, size_t dstsize, const char *name)
+{
+  return hts_settings_buildpath(dst, dstsize, "%s", name);
+}
+
+static int
+pack_append(sbuf_t *sb, htsmsg_t *m)
+{
+  void *data;
+  size_t len;
+  int r;
+
+  r = htsmsg_binary2_serialize(m, &data, &len, 0x10000000);
+  htsmsg_destroy(m);
+  if (r)
+    return -1;
+  sbuf_append(sb, data, len);
+  free(data);
+  return 0;
+}
+
+static int
+pack_append_header(sbuf_t *sb, uint32_t gen)
+{
+  htsmsg_t *m = htsmsg_create_map();
+  htsmsg_add_u32(m, "pack", PACK_VERSION);
+  htsmsg_add_u32(m, "gen", gen);
+  return pack_append(sb, m);
+}
+
+/*
+ * Apply the records from the file, returns the size of the valid data
+ * or -1 when the file is missing or it does not belong to the generation
+ * 'gen' (or 'gen' + 1 when 'next' is set). The generation of the
+ * snapshot is returned in 'gen'.
+ */
+static ssize_t
+pack_load_file(const char *name, uint32_t *gen, int snapshot, int next)
+{
+  char path[PATH_MAX];
+  struct stat st;
+  const uint8_t *mem;
+  size_t pos = 0, msglen;
+  htsmsg_t *m, *d;
+  const char *s;
+  uint32_t u32;
+  int fd, first = 1;
+
+  if (pack_path(path, sizeof(path), name))
+    return -1;
+  if ((fd = tvh_open(path, O_RDONLY, 0)) < 0)
+    return -1;
+  if (fstat(fd, &st) || st.st_size == 0) {
+    close(fd);
+    return -1;
+  }
+  mem = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    tvherror(LS_SETTINGS, "unable to map %s", path);
+    return -1;
+  }
+
+  while (pos < st.st_size) {
+    msglen = st.st_size - pos;
+    if (htsmsg_binary2_deserialize(&m, mem + pos, &msglen, NULL))
+      break;
+    if (first) {
+      if (htsmsg_get_u32(m, "pack", &u32) || u32 != PACK_VERSION ||
+          htsmsg_get_u32(m, "gen", &u32) ||
+          (!snapshot && u32 != *gen && (!next || u32 != *gen + 1))) {
+        htsmsg_destroy(m);
+        goto fail;
+      }
+      if (snapshot)
+        *gen = u32;
+      first = 0;
+    } else if ((s = htsmsg_get_str(m, "p")) != NULL) {
+      if (htsmsg_get_bool_or_default(m, "rm", 0)) {
+        pack_del(s);
+      } else if (htsmsg_get_bool_or_default(m, "imp", 0)) {
+        pack_add_import(s);
+      } else if ((d = pack_record(m)) != NULL) {
+        pack_set(s, htsmsg_copy(d));
+      }
+    }
+    htsmsg_destroy(m);
+    pos += msglen;
+  }
+
+  if (pos < st.st_size)
+    tvherror(LS_SETTINGS, "%s: corrupted data at %zd", path, pos);
+
+fail:
+  munmap((void *)mem, st.st_size);
+  return first ? -1 : pos;
+}
+
+static off_t
+pack_file_size(const char *name)
+{
+  char path[PATH_MAX];
+  struct stat st;
+
+  if (pack_path(path, sizeof(path), name) || stat(path, &st))
+    return -1;
+  return st.st_size;
+}
+
+/*
+ * Write the whole file using a temporary file
+ */
+static int
+pack_write_file(const char *name, const void *data, size_t size)
+{
+  char path[PATH_MAX], tmppath[PATH_MAX + 4];
+  int fd, r;
+
+  if (pack_path(path, sizeof(path), name))
+    return -1;
+  snprintf(tmppath, sizeof(tmppath), "%s.tmp", path);
+  fd = tvh_open(tmppath, O_CREAT | O_TRUNC | O_WRONLY, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    tvhalert(LS_SETTINGS, "Unable to create \"%s\" - %s", tmppath, strerror(errno));
+    return -1;
+  }
+  r = tvh_write(fd, data, size);
+  if (!r)
+    r = fsync(fd);
+  close(fd);
+  if (!r)
+    r = rename(tmppath, path);
+  if (r) {
+    tvhalert(LS_SETTINGS, "Unable to write \"%s\" - %s", path, strerror(errno));
+    unlink(tmppath);
+  }
+  return r;
+}
+
+static int
+pack_open_log(const char *name, uint32_t gen, int truncate)
+{
+  char path[PATH_MAX];
+  sbuf_t sb;
+  int fd;
+
+  if (pack_path(path, sizeof(path), name))
+    return -1;
+  fd = tvh_open(path, O_CREAT | O_WRONLY | O_APPEND | (truncate ? O_TRUNC : 0),
+                S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    tvhalert(LS_SETTINGS, "Unable to open \"%s\" - %s", path, strerror(errno));
+    return -1;
+  }
+  if (truncate) {
+    sbuf_init(&sb);
+    if (pack_append_header(&sb, gen) || tvh_write(fd, sb.sb_data, sb.sb_ptr)) {
+      tvhalert(LS_SETTINGS, "Unable to write \"%s\"", path);
+      sbuf_free(&sb);
+      close(fd);
+      return -1;
+    }
+    pack_log_size = sb.sb_ptr;
+    pack_log_base = 0;
+    sbuf_free(&sb);
+  }
+  return fd;
+}
+
+/*
+ * Serialize all records
+ */
+static void
+pack_serialize(sbuf_t *sb, uint32_t gen)
+{
+  pack_entry_t *e;
+  pack_import_t *pi;
+  htsmsg_t *m;
+
+  pack_append_header(sb, gen);
+  RB_FOREACH(e, &pack_entries, link) {
+    m = htsmsg_create_map();
+    htsmsg_add_str(m, "p", e->path);
+    htsmsg_add_msg(m, "d", htsmsg_copy(e->msg));
+    pack_append(sb, m);
+  }
+  LIST_FOREACH(pi, &pack_imports, link) {
+    m = htsmsg_create_map();
+    htsmsg_add_str(m, "p", pi->path);
+    htsmsg_add_bool(m, "imp", 1);
+    pack_append(sb, m);
+  }
+}
+
+static void *
+pack_compact_thread(void *aux)
+{
+  pack_compact_t *pc = aux;
+  char path[PATH_MAX], path2[PATH_MAX];
+  int failed = 1;
+
+  if (!pack_write_file(PACK_FILE, pc->sb.sb_data, pc->sb.sb_ptr) &&
+      !pack_path(path, sizeof(path), PACK_LOG_NEW) &&
+      !pack_path(path2, sizeof(path2), PACK_LOG)) {
+    if (rename(path, path2)) {
+      tvhalert(LS_SETTINGS, "Unable to rename \"%s\" - %s", path, strerror(errno));
+    } else {
+      tvhdebug(LS_SETTINGS, "packed store compacted (%d bytes)", pc->sb.sb_ptr);
+      failed = 0;
+    }
+  }
+  /* Read by pack_compact() after the join */
+  pack_compact_failed = failed;
+  sbuf_free(&pc->sb);
+  free(pc);
+  return NULL;
+}
+
+/*
+ * Write a new snapshot in the background, the pack lock must be held
+ */
+static void
+pack_compact(void)
+{
+  pack_compact_t *pc;
+  int fd;
+
+  /* The previous compaction renames the new log */
+  if (pack_compact_running) {
+    pthread_join(pack_compact_tid, NULL);
+    pack_compact_running = 0;
+  }
+
+  /*
+   * When the previous compaction failed, the new log still holds the
+   * only copy of the changes since the last written snapshot: keep
+   * appending to it and retry the snapshot of the same generation
+   */
+  if (!pack_compact_failed) {
+    fd = pack_open_log(PACK_LOG_NEW, pack_gen + 1, 1);
+    if (fd < 0)
+      return;
+    if (pack_log_fd >= 0)
+      close(pack_log_fd);
+    pack_log_fd = fd;
+    pack_gen++;
+  } else {
+    pack_log_base = pack_log_size;
+  }
+
+  pc = calloc(1, sizeof(*pc));
+  pc->gen = pack_gen;
+  sbuf_init_fixed(&pc->sb, 1024*1024);
+  pack_serialize(&pc->sb, pc->gen);
+  pack_snapshot_size = pc->sb.sb_ptr;
+  if (tvh_thread_create(&pack_compact_tid, NULL, pack_compact_thread, pc, "settingspack")) {
+    pack_compact_thread(pc);
+  } else {
+    pack_compact_running = 1;
+  }
+}
+
+/*
+ * Append the record to the log, the pack lock must be held
+ */
+static void
+pack_log(htsmsg_t *m)
+{
+  sbuf_t sb;
+
+  sbuf_init(&sb);
+  if (pack_append(&sb, m) == 0 && pack_log_fd >= 0) {
+    if (tvh_write(pack_log_fd, sb.sb_data, sb.sb_ptr))
+      tvhalert(LS_SETTINGS, "Unable to write the settings log - %s", strerror(errno));
+    pack_log_size += sb.sb_ptr;
+  }
+  sbuf_free(&sb);
+  if (pack_log_size - pack_log_base > PACK_COMPACT_MIN &&
+      pack_log_size - pack_log_base > pack_snapshot_size)
+    pack_compact();
+}
+
+/* **************************************************************************
+ * Public
+ * *************************************************************************/
+
+int
+hts_settings_pack_active(void)
+{
+  return pack_active;
+}
+
+int
+hts_settings_pack_imported(const char *path)
+{
+  int r;
+
+  tvh_mutex_lock(&pack_lock);
+  r = pack_is_imported(path);
+  tvh_mutex_unlock(&pack_lock);
+  return r;
+}
+
+/*
+ * Mark the path as imported, 'records' is a list of maps with the relative
+ * path "p" and the record "d" read from the files; the records already
+ * in the store are kept
+ */
+void
+hts_settings_pack_import(const char *path, htsmsg_t *records)
+{
+  htsmsg_field_t *f;
+  htsmsg_t *e, *m, *d;
+  const char *s;
+  int count = 0;
+
+  tvh_mutex_lock(&pack_lock);
+  if (!pack_is_imported(path)) {
+    if (records) {
+      HTSMSG_FOREACH(f, records) {
+        if ((e = htsmsg_field_get_map(f)) == NULL) continue;
+        if ((s = htsmsg_get_str(e, "p")) == NULL) continue;
+        if ((d = pack_record(e)) == NULL) continue;
+        if (pack_find(s)) continue;
+        pack_set(s, htsmsg_copy(d));
+        m = htsmsg_create_map();
+        htsmsg_add_str(m, "p", s);
+        htsmsg_add_msg(m, "d", htsmsg_copy(d));
+        pack_log(m);
+        count++;
+      }
+    }
+    pack_add_import(path);
+    m = htsmsg_create_map();
+    htsmsg_add_str(m, "p", path);
+    htsmsg_add_bool(m, "imp", 1);
+    pack_log(m);
+    tvhdebug(LS_SETTINGS, "imported \"%s\" (%d records)", path, count);
+  }
+  tvh_mutex_unlock(&pack_lock);
+}
+
+/*
+ * Load the record or the directory (up to 'depth' sub-directories)
+ */
+htsmsg_t *
+hts_settings_pack_load(const char *path, int depth)
+{
+  pack_entry_t *e;
+  htsmsg_t *r = NULL, *stack[32];
+  const char *name, *p, *stack_name[32];
+  size_t stack_len[32], l;
+  char prefix[PATH_MAX];
+  int level, i;
+
+  tvh_mutex_lock(&pack_lock);
+
+  /* Record */
+  if ((e = pack_find(path)) != NULL) {
+    r = htsmsg_copy(e->msg);
+    goto done;
+  }
+
+  /* Directory */
+  e = pack_find_dir(path, prefix, sizeof(prefix));
+  if (e == NULL)
+    goto done;
+  if (depth >= ARRAY_SIZE(stack))
+    depth = ARRAY_SIZE(stack) - 1;
+  l = strlen(prefix);
+  r = stack[0] = htsmsg_create_map();
+  level = 0;
+  for ( ; e && !strncmp(e->path, prefix, l); e = RB_NEXT(e, link)) {
+    /* Find the common directories with the previous entry */
+    name = e->path + l;
+    for (i = 0; i < level; i++) {
+      if (strncmp(name, stack_name[i], stack_len[i]) || name[stack_len[i]] != '/')
+        break;
+      name += stack_len[i] + 1;
+    }
+    level = i;
+    /* Create the remaining directories */
+    while ((p = strchr(name, '/')) != NULL) {
+      if (level >= depth)
+        break;
+      stack_name[level] = name;
+      stack_len[level] = p - name;
+      snprintf(prefix + l, sizeof(prefix) - l, "%.*s", (int)(p - name), name);
+      if ((stack[level + 1] = htsmsg_get_map(stack[level], prefix + l)) == NULL) {
+        stack[level + 1] = htsmsg_create_map();
+        htsmsg_add_msg(stack[level], prefix + l, stack[level + 1]);
+        stack[level + 1] = htsmsg_get_map(stack[level], prefix + l);
+      }
+      level++;
+      name = p + 1;
+    }
+    prefix[l] = '\0';
+    if (p == NULL)
+      htsmsg_add_msg(stack[level], name, htsmsg_copy(e->msg));
+  }
+
+done:
+  tvh_mutex_unlock(&pack_lock);
+  return r;
+}
+
+int
+hts_settings_pack_exists(const char *path)
+{
+  char prefix[PATH_MAX];
+  int r;
+
+  tvh_mutex_lock(&pack_lock);
+  r = pack_find(path) != NULL ||
+      pack_find_dir(path, prefix, sizeof(prefix)) != NULL;
+  tvh_mutex_unlock(&pack_lock);
+  return r;
+}
+
+void
+hts_settings_pack_save(const char *path, htsmsg_t *record)
+{
+  htsmsg_t *m;
+
+  tvh_mutex_lock(&pack_lock);
+  pack_set(path, htsmsg_copy(record));
+  m = htsmsg_create_map();
+  htsmsg_add_str(m, "p", path);
+  htsmsg_add_msg(m, "d", htsmsg_copy(record));
+  pack_log(m);
+  tvh_mutex_unlock(&pack_lock);
+}
+
+void
+hts_settings_pack_remove(const char *path)
+{
+  htsmsg_t *m;
+
+  tvh_mutex_lock(&pack_lock);
+  pack_del(path);
+  m = htsmsg_create_map();
+  htsmsg_add_str(m, "p", path);
+  htsmsg_add_bool(m, "rm", 1);
+  pack_log(m);
+  tvh_mutex_unlock(&pack_lock);
+}
+
+/*
+ * Load the store into memory, returns -1 if there is no snapshot
+ */
+static int
+pack_load(int *clean)
+{
+  uint32_t gen = 0, gen2;
+  ssize_t r;
+  int64_t mono = getmonoclock();
+  int count = 0;
+  pack_entry_t *e;
+
+  *clean = 1;
+  if ((r = pack_load_file(PACK_FILE, &gen, 1, 0)) < 0)
+    return -1;
+  pack_gen = gen;
+  pack_snapshot_size = r;
+
+  /* The log of this generation */
+  gen2 = gen;
+  r = pack_load_file(PACK_LOG, &gen2, 0, 0);
+  if (r < 0 || r != pack_file_size(PACK_LOG)) {
+    /* The log belongs to the previous snapshot or it is broken */
+    *clean = 0;
+  } else {
+    pack_log_size = r;
+  }
+
+  /* The compaction was interrupted */
+  gen2 = gen;
+  if (pack_load_file(PACK_LOG_NEW, &gen2, 0, 1) >= 0)
+    *clean = 0;
+
+  RB_FOREACH(e, &pack_entries, link)
+    count++;
+  tvhinfo(LS_SETTINGS, "packed store loaded (%d records, %"PRId64"ms)",
+          count, (getmonoclock() - mono) / 1000);
+  return 0;
+}
+
+/*
+ * Export the records back to the JSON tree
+ */
+static void
+pack_export(void)
+{
+  pack_entry_t *e;
+  char path[PATH_MAX], path2[PATH_MAX];
+  int clean, count = 0;
+
+  if (pack_load(&clean))
+    return;
+  tvhinfo(LS_SETTINGS, "exporting the packed store to the configuration tree");
+  RB_FOREACH(e, &pack_entries, link) {
+    hts_settings_save(e->msg, "%s", e->path);
+    count++;
+  }
+  pack_clear();
+  if (!pack_path(path, sizeof(path), PACK_FILE) &&
+      !pack_path(path2, sizeof(path2), PACK_EXPORTED))
+    if (rename(path, path2))
+      tvherror(LS_SETTINGS, "unable to rename %s", path);
+  hts_settings_remove(PACK_LOG);
+  hts_settings_remove(PACK_LOG_NEW);
+  tvhinfo(LS_SETTINGS, "exported %d records", count);
+}
+
+void
+hts_settings_pack_init(int enable)
+{
+  int clean, fresh;
+
+  tvh_mutex_init(&pack_lock, NULL);
+  RB_INIT(&pack_entries);
+
+  if (!enable) {
+    pack_export();
+    return;
+  }
+
+  if (pack_load(&clean)) {
+    /* New store, import everything on a new configuration */
+    fresh = !hts_settings_exists("config");
+    if (fresh)
+      pack_add_import("");
+    clean = 0;
+    tvhinfo(LS_SETTINGS, "creating the packed store%s",
+            fresh ? "" : ", the configuration is imported on demand");
+  }
+
+  if (clean) {
+    pack_log_fd = pack_open_log(PACK_LOG, pack_gen, 0);
+  } else {
+    /* Write a new snapshot now */
+    sbuf_t sb;
+    pack_gen++;
+    sbuf_init_fixed(&sb, 1024*1024);
+    pack_serialize(&sb, pack_gen);
+    pack_snapshot_size = sb.sb_ptr;
+    if (pack_write_file(PACK_FILE, sb.sb_data, sb.sb_ptr) == 0) {
+      pack_log_fd = pack_open_log(PACK_LOG, pack_gen, 1);
+      hts_settings_remove(PACK_LOG_NEW);
+    }
+    sbuf_free(&sb);
+  }
+
+  if (pack_log_fd < 0) {
+    tvhalert(LS_SETTINGS, "unable to use the packed store, using the configuration tree");
+    pack_clear();
+    return;
+  }
+  pack_active = 1;
+}
+
+void
+hts_settings_pack_done(void)
+{
+  if (!pack_active)
+    return;
+  tvh_mutex_lock(&pack_lock);
+  if (pack_compact_running) {
+    pthread_join(pack_compact_tid, NULL);
+    pack_compact_running = 0;
+  }
+  if (pack_log_fd >= 0)
+    close(pack_log_fd);
+  pack_log_fd = -1;
+  pack_active = 0;
+  pack_clear();
+  tvh_mutex_unlock(&pack_lock);
+}
@@ -51,7 +51,7 @@ streaming_target_init(streaming_target_t *st, streaming_ops_t *ops,
 /**
  *
  */
-static size_t
+size_t
 streaming_message_data_size(streaming_message_t *sm)
 {
   if (sm->sm_type == SMT_PACKET) {
@@ -62,30 +62,94 @@ streaming_message_data_size(streaming_message_t *sm)
     pktbuf_t *pkt_payload = sm->sm_data;
     if (pkt_payload)
       return pktbuf_len(pkt_payload);
+  } else if (sm->sm_type == SMT_PACKET_BATCH) {
+    streaming_pkt_batch_t *spb = sm->sm_data;
+    size_t size = 0;
+    int i;
+    for (i = 0; i < spb->spb_count; i++)
+      if (spb->spb_pkts[i]->pkt_payload)
+        size += pktbuf_len(spb->spb_pkts[i]->pkt_payload);
+    return size;
   }
   return 0;
 }
 
 /**
- *
+ * Producers never take sq_mutex unless the consumer is (about to be)
+ * sleeping, one wakeup covers all messages queued until it runs again
  */
 static void
 streaming_queue_deliver(void *opauqe, streaming_message_t *sm)
 {
   streaming_queue_t *sq = opauqe;
-
-  tvh_mutex_lock(&sq->sq_mutex);
+  streaming_message_t *head;
 
   /* queue size protection */
-  if (sq->sq_maxsize && sq->sq_maxsize < sq->sq_size) {
+  if (sq->sq_maxsize && (int64_t)sq->sq_maxsize < atomic_get_s64(&sq->sq_size)) {
     streaming_msg_free(sm);
-  } else {
-    TAILQ_INSERT_TAIL(&sq->sq_queue, sm, sm_link);
-    sq->sq_size += streaming_message_data_size(sm);
+    return;
+  }
+
+  atomic_add_s64(&sq->sq_size, streaming_message_data_size(sm));
+  do {
+    head = sq->sq_inbox;
+    sm->sm_link.tqe_next = head;
+  } while (!atomic_cas_ptr((atomic_refptr_t)&sq->sq_inbox, head, sm));
+
+  /* the CAS is a full barrier, sq_waiting is read after the push */
+  if (sq->sq_waiting && atomic_exchange(&sq->sq_waiting, 0)) {
+    tvh_mutex_lock(&sq->sq_mutex);
+    tvh_cond_signal(&sq->sq_cond, 0);
+    tvh_mutex_unlock(&sq->sq_mutex);
+  }
+}
+
+/**
+ * Move the messages from the producer stack to sq_queue (in order)
+ */
+static void
+streaming_queue_splice(streaming_queue_t *sq)
+{
+  streaming_message_t *sm, *next, *last;
+
+  do {
+    sm = sq->sq_inbox;
+  } while (sm && !atomic_cas_ptr((atomic_refptr_t)&sq->sq_inbox, sm, NULL));
+
+  last = TAILQ_LAST(&sq->sq_queue, streaming_message_queue);
+  for ( ; sm; sm = next) {
+    next = sm->sm_link.tqe_next;
+    if (last)
+      TAILQ_INSERT_AFTER(&sq->sq_queue, last, sm, sm_link);
+    else
+      TAILQ_INSERT_HEAD(&sq->sq_queue, sm, sm_link);
   }
+}
+
+/**
+ * Return the first queued message, sq_mutex must be held. When NULL
+ * is returned, the next delivered message signals sq_cond.
+ */
+streaming_message_t *
+streaming_queue_first(streaming_queue_t *sq)
+{
+  streaming_message_t *sm;
 
-  tvh_cond_signal(&sq->sq_cond, 0);
-  tvh_mutex_unlock(&sq->sq_mutex);
+  if ((sm = TAILQ_FIRST(&sq->sq_queue)) != NULL)
+    return sm;
+  streaming_queue_splice(sq);
+  if ((sm = TAILQ_FIRST(&sq->sq_queue)) != NULL)
+    return sm;
+  /* announce the sleep, then check again to not miss a wakeup;
+     atomic_set() is only an acquire barrier, the store must be
+     visible before the inbox is read again (pairs with the CAS
+     in streaming_queue_deliver) */
+  atomic_set(&sq->sq_waiting, 1);
+  __sync_synchronize();
+  streaming_queue_splice(sq);
+  if ((sm = TAILQ_FIRST(&sq->sq_queue)) != NULL)
+    atomic_set(&sq->sq_waiting, 0);
+  return sm;
 }
 
 /**
@@ -95,12 +159,9 @@ static htsmsg_t *
 streaming_queue_info(void *opaque, htsmsg_t *list)
 {
   streaming_queue_t *sq = opaque;
-  size_t size;
   char buf[256];
-  tvh_mutex_lock(&sq->sq_mutex);
-  size = sq->sq_size;
-  tvh_mutex_unlock(&sq->sq_mutex);
-  snprintf(buf, sizeof(buf), "streaming queue %p size %zd", sq, size);
+  snprintf(buf, sizeof(buf), "streaming queue %p size %"PRId64,
+           sq, atomic_get_s64(&sq->sq_size));
   htsmsg_add_str(list, NULL, buf);
   return list;
 }
@@ -111,10 +172,25 @@ streaming_queue_info(void *opaque, htsmsg_t *list)
 void
 streaming_queue_remove(streaming_queue_t *sq, streaming_message_t *sm)
 {
-  sq->sq_size -= streaming_message_data_size(sm);
+  atomic_dec_s64(&sq->sq_size, streaming_message_data_size(sm));
   TAILQ_REMOVE(&sq->sq_queue, sm, sm_link);
 }
 
+/**
+ * Drop all queued messages, sq_mutex must be held
+ */
+void
+streaming_queue_flush(streaming_queue_t *sq)
+{
+  streaming_message_t *sm;
+
+  streaming_queue_splice(sq);
+  while ((sm = TAILQ_FIRST(&sq->sq_queue)) != NULL) {
+    streaming_queue_remove(sq, sm);
+    streaming_msg_free(sm);
+  }
+}
+
 /**
  *
  */
@@ -131,6 +207,8 @@ streaming_queue_init(streaming_queue_t *sq, int reject_filter, size_t maxsize)
   tvh_mutex_init(&sq->sq_mutex, NULL);
   tvh_cond_init(&sq->sq_cond, 1);
   TAILQ_INIT(&sq->sq_queue);
+  sq->sq_inbox = NULL;
+  sq->sq_waiting = 0;
 
   sq->sq_maxsize = maxsize;
   sq->sq_size = 0;
@@ -142,8 +220,7 @@ streaming_queue_init(streaming_queue_t *sq, int reject_filter, size_t maxsize)
 void
 streaming_queue_deinit(streaming_queue_t *sq)
 {
-  sq->sq_size = 0;
-  streaming_queue_clear(&sq->sq_queue);
+  streaming_queue_flush(sq);
   tvh_mutex_destroy(&sq->sq_mutex);
   tvh_cond_destroy(&sq->sq_cond);
 }
@@ -225,6 +302,109 @@ streaming_msg_create_pkt(th_pkt_t *pkt)
 }
 
 
+/**
+ *
+ */
+void
+streaming_pkt_batch_free(streaming_pkt_batch_t *spb)
+{
+  int i;
+
+  for (i = 0; i < spb->spb_count; i++)
+    pkt_ref_dec(spb->spb_pkts[i]);
+  free(spb);
+}
+
+/**
+ *
+ */
+static streaming_pkt_batch_t *
+streaming_pkt_batch_copy(streaming_pkt_batch_t *src)
+{
+  size_t size = sizeof(*src) + src->spb_count * sizeof(th_pkt_t *);
+  streaming_pkt_batch_t *dst = malloc(size);
+  int i;
+
+  memcpy(dst, src, size);
+  dst->spb_size = src->spb_count;
+  for (i = 0; i < dst->spb_count; i++)
+    pkt_ref_inc(dst->spb_pkts[i]);
+  return dst;
+}
+
+/**
+ * Deliver the packet (reference is not stolen), it's queued to the
+ * batch between streaming_batch_begin() and streaming_batch_end()
+ */
+void
+streaming_batch_deliver(streaming_batch_t *sb, streaming_target_t *st,
+                        th_pkt_t *pkt)
+{
+  streaming_pkt_batch_t *spb = sb->sb_batch;
+
+  if (!sb->sb_active) {
+    streaming_target_deliver2(st, streaming_msg_create_pkt(pkt));
+    return;
+  }
+  if (spb == NULL || spb->spb_count == spb->spb_size) {
+    int size = spb ? spb->spb_size * 2 : 16;
+    spb = realloc(spb, sizeof(*spb) + size * sizeof(th_pkt_t *));
+    if (sb->sb_batch == NULL)
+      spb->spb_count = 0;
+    spb->spb_size = size;
+    sb->sb_batch = spb;
+  }
+  pkt_ref_inc(pkt);
+  spb->spb_pkts[spb->spb_count++] = pkt;
+}
+
+/**
+ * Send the collected packets as one message
+ */
+void
+streaming_batch_end(streaming_batch_t *sb, streaming_target_t *st)
+{
+  streaming_pkt_batch_t *spb = sb->sb_batch;
+  streaming_message_t *sm;
+
+  sb->sb_active = 0;
+  if (spb == NULL)
+    return;
+  sb->sb_batch = NULL;
+  if (spb->spb_count == 1) {
+    sm = streaming_msg_create_data(SMT_PACKET, spb->spb_pkts[0]);
+    free(spb);
+  } else if (spb->spb_count > 1) {
+    sm = streaming_msg_create_data(SMT_PACKET_BATCH, spb);
+  } else {
+    free(spb);
+    return;
+  }
+  streaming_target_deliver2(st, sm);
+}
+
+/**
+ * Split the batch to SMT_PACKET messages for targets without batch support
+ */
+void
+streaming_msg_unbatch(streaming_message_t *sm, st_callback_t *cb, void *opaque)
+{
+  streaming_pkt_batch_t *spb = sm->sm_data;
+  streaming_message_t *sm2;
+  int i;
+
+  for (i = 0; i < spb->spb_count; i++) {
+    sm2 = streaming_msg_create_data(SMT_PACKET, spb->spb_pkts[i]);
+#if ENABLE_TIMESHIFT
+    sm2->sm_time = sm->sm_time;
+#endif
+    sm2->sm_s = sm->sm_s;
+    cb(opaque, sm2);
+  }
+  spb->spb_count = 0;
+  streaming_msg_free(sm);
+}
+
 /**
  *
  */
@@ -316,6 +496,10 @@ streaming_msg_clone(streaming_message_t *src)
     dst->sm_data = src->sm_data;
     break;
 
+  case SMT_PACKET_BATCH:
+    dst->sm_data = streaming_pkt_batch_copy(src->sm_data);
+    break;
+
   default:
     abort();
   }
@@ -384,6 +568,11 @@ streaming_msg_free(streaming_message_t *sm)
       pktbuf_ref_dec(sm->sm_data);
     break;
 
+  case SMT_PACKET_BATCH:
+    if(sm->sm_data)
+      streaming_pkt_batch_free(sm->sm_data);
+    break;
+
   default:
     abort();
   }
@@ -391,13 +580,24 @@ streaming_msg_free(streaming_message_t *sm)
   free(sm);
 }
 
+/**
+ * Batches are filtered like the packets they carry
+ */
+static inline int
+streaming_msg_filter_mask(streaming_message_t *sm)
+{
+  if (sm->sm_type == SMT_PACKET_BATCH)
+    return SMT_TO_MASK(SMT_PACKET);
+  return SMT_TO_MASK(sm->sm_type);
+}
+
 /**
  *
  */
 void
 streaming_target_deliver2(streaming_target_t *st, streaming_message_t *sm)
 {
-  if (st->st_reject_filter & SMT_TO_MASK(sm->sm_type))
+  if (st->st_reject_filter & streaming_msg_filter_mask(sm))
     streaming_msg_free(sm);
   else
     streaming_target_deliver(st, sm);
@@ -414,7 +614,7 @@ streaming_pad_deliver(streaming_pad_t *sp, streaming_message_t *sm)
   for (st = LIST_FIRST(&sp->sp_targets); st; st = next) {
     next = LIST_NEXT(st, st_link);
     assert(next != st);
-    if (st->st_reject_filter & SMT_TO_MASK(sm->sm_type))
+    if (st->st_reject_filter & streaming_msg_filter_mask(sm))
       continue;
     if (run)
       streaming_target_deliver(run, streaming_msg_clone(sm));
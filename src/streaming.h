@@ -111,6 +111,7 @@ struct timeshift_status
   int64_t shift;
   int64_t pts_start;
   int64_t pts_end;
+  int64_t seek_time;
 };
 
 /**
@@ -254,6 +255,15 @@ enum streaming_message_type {
    */
   SMT_TIMESHIFT_STATUS,
 
+  /**
+   * Batch of packets with data.
+   *
+   * sm_data points to a streaming_pkt_batch struct. All th_pkts will
+   * be unref'ed when the message is destroyed. Targets without
+   * st_batch in their ops receive the packets as SMT_PACKET messages.
+   */
+  SMT_PACKET_BATCH,
+
 };
 
 #define SMT_TO_MASK(x) (1 << ((unsigned int)x))
@@ -330,6 +340,23 @@ struct streaming_message {
   };
 };
 
+/**
+ * Batch of packets (SMT_PACKET_BATCH), holds one reference per packet
+ */
+typedef struct streaming_pkt_batch {
+  int       spb_count;
+  int       spb_size;
+  th_pkt_t *spb_pkts[0];
+} streaming_pkt_batch_t;
+
+/**
+ * Collects the packets produced while one input message is processed
+ */
+typedef struct streaming_batch {
+  streaming_pkt_batch_t *sb_batch;
+  int                    sb_active;
+} streaming_batch_t;
+
 /**
  * A streaming target receives data.
  */
@@ -338,6 +365,7 @@ typedef void (st_callback_t)(void *opaque, streaming_message_t *sm);
 struct streaming_ops {
   st_callback_t *st_cb;
   htsmsg_t *(*st_info)(void *opaque, htsmsg_t *list);
+  int st_batch;            /* Target handles SMT_PACKET_BATCH */
 };
 
 typedef struct streaming_target {
@@ -355,14 +383,19 @@ struct streaming_queue {
 
   streaming_target_t sq_st;
 
-  tvh_mutex_t sq_mutex;    /* Protects sp_queue */
+  tvh_mutex_t sq_mutex;    /* Protects sq_queue */
   tvh_cond_t  sq_cond;     /* Condvar for signalling new packets */
 
   size_t      sq_maxsize;  /* Max queue size (bytes) */
-  size_t      sq_size;     /* Actual queue size (bytes) - only data */
+  int64_t     sq_size;     /* Actual queue size (bytes) - only data, atomic */
 
   struct streaming_message_queue sq_queue;
 
+  /* Lock-free producer side (newest first, linked via sm_link.tqe_next),
+   * moved to sq_queue by the consumer in streaming_queue_first() */
+  streaming_message_t * volatile sq_inbox;
+  int         sq_waiting;  /* Consumer is going to sleep on sq_cond */
+
 };
 
 streaming_component_type_t streaming_component_txt2type(const char *str);
@@ -435,6 +468,14 @@ void streaming_queue_deinit(streaming_queue_t *sq);
 
 void streaming_queue_remove(streaming_queue_t *sq, streaming_message_t *sm);
 
+streaming_message_t *streaming_queue_first(streaming_queue_t *sq);
+
+/* The consumer passes SMT_PACKET_BATCH messages to muxer_write_pkt() */
+static inline void streaming_queue_accept_batch(streaming_queue_t *sq)
+  { sq->sq_st.st_ops.st_batch = 1; }
+
+void streaming_queue_flush(streaming_queue_t *sq);
+
 void streaming_target_connect(streaming_pad_t *sp, streaming_target_t *st);
 
 void streaming_target_disconnect(streaming_pad_t *sp, streaming_target_t *st);
@@ -445,6 +486,8 @@ void streaming_service_deliver(struct service *t, streaming_message_t *sm);
 
 void streaming_msg_free(streaming_message_t *sm);
 
+size_t streaming_message_data_size(streaming_message_t *sm);
+
 streaming_message_t *streaming_msg_clone(streaming_message_t *src);
 
 streaming_message_t *streaming_msg_create(streaming_message_type_t type);
@@ -457,9 +500,27 @@ streaming_message_t *streaming_msg_create_code(streaming_message_type_t type,
 
 streaming_message_t *streaming_msg_create_pkt(th_pkt_t *pkt);
 
+static inline void streaming_batch_begin(streaming_batch_t *sb)
+  { sb->sb_active = 1; }
+
+void streaming_batch_deliver(streaming_batch_t *sb, streaming_target_t *st,
+                             th_pkt_t *pkt);
+
+void streaming_batch_end(streaming_batch_t *sb, streaming_target_t *st);
+
+void streaming_pkt_batch_free(streaming_pkt_batch_t *spb);
+
+void streaming_msg_unbatch(streaming_message_t *sm,
+                           st_callback_t *cb, void *opaque);
+
 static inline void
 streaming_target_deliver(streaming_target_t *st, streaming_message_t *sm)
-  { st->st_ops.st_cb(st->st_opaque, sm); }
+{
+  if (sm->sm_type == SMT_PACKET_BATCH && !st->st_ops.st_batch)
+    streaming_msg_unbatch(sm, st->st_ops.st_cb, st->st_opaque);
+  else
+    st->st_ops.st_cb(st->st_opaque, sm);
+}
 
 void streaming_target_deliver2(streaming_target_t *st, streaming_message_t *sm);
 
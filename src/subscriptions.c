@@ -78,11 +78,6 @@ subscription_link_service(th_subscription_t *s, service_t *t)
   subsetstate(s, SUBSCRIPTION_TESTING_SERVICE);
   s->ths_service = t;
 
-  if ((s->ths_flags & SUBSCRIPTION_TYPE_MASK) == SUBSCRIPTION_PACKET) {
-    assert(s->ths_parser == NULL);
-    s->ths_output = s->ths_parser = parser_create(s->ths_output, s);
-  }
-
   LIST_INSERT_HEAD(&t->s_subscriptions, s, ths_service_link);
 
   tvhtrace(LS_SUBSCRIPTION, "%04X: linking sub %p to svc %p type %i",
@@ -96,8 +91,14 @@ subscription_link_service(th_subscription_t *s, service_t *t)
     s->ths_start_message = streaming_msg_create_data(SMT_START, ss);
   }
 
-  // Link to service output
-  streaming_target_connect(&t->s_streaming_pad, &s->ths_input);
+  // Link to service output (packet subscriptions share the service parser)
+  if ((s->ths_flags & SUBSCRIPTION_TYPE_MASK) == SUBSCRIPTION_PACKET) {
+    assert(s->ths_parser == NULL);
+    s->ths_parser = parser_service_acquire(t);
+    streaming_target_connect(s->ths_parser, &s->ths_input);
+  } else {
+    streaming_target_connect(&t->s_streaming_pad, &s->ths_input);
+  }
 
   sm = streaming_msg_create_code(SMT_GRACE, s->ths_postpone + t->s_grace_delay);
   streaming_service_deliver(t, sm);
@@ -120,6 +121,21 @@ subscription_link_service(th_subscription_t *s, service_t *t)
   tvh_mutex_unlock(&t->s_stream_mutex);
 }
 
+/**
+ * Disconnect from the service output, s_stream_mutex must be held
+ */
+static void
+subscription_unlink_input(th_subscription_t *s, service_t *t)
+{
+  if (s->ths_parser) {
+    streaming_target_disconnect(s->ths_parser, &s->ths_input);
+    s->ths_parser = NULL;
+    parser_service_release(t);
+  } else {
+    streaming_target_disconnect(&t->s_streaming_pad, &s->ths_input);
+  }
+}
+
 /**
  * Called from service code
  */
@@ -135,7 +151,7 @@ subscription_unlink_service0(th_subscription_t *s, int reason, int resched)
 
   tvh_mutex_lock(&t->s_stream_mutex);
 
-  streaming_target_disconnect(&t->s_streaming_pad, &s->ths_input);
+  subscription_unlink_input(s, t);
 
   if(!resched && t->s_running) {
     // Send a STOP message to the subscription client
@@ -144,18 +160,10 @@ subscription_unlink_service0(th_subscription_t *s, int reason, int resched)
     t->s_running = 0;
   }
 
-  if (s->ths_parser)
-    s->ths_output = parser_output(s->ths_parser);
-
   tvh_mutex_unlock(&t->s_stream_mutex);
 
   LIST_REMOVE(s, ths_service_link);
 
-  if (s->ths_parser) {
-    parser_destroy(s->ths_parser);
-    s->ths_parser = NULL;
-  }
-
   if (!resched && (s->ths_flags & SUBSCRIPTION_ONESHOT) != 0)
     mtimer_arm_rel(&s->ths_remove_timer, subscription_unsubscribe_cb, s, 0);
 
@@ -540,6 +548,16 @@ subscription_input_direct(void *opauqe, streaming_message_t *sm)
     atomic_add(&s->ths_total_err, pkt->pkt_err);
     if (pkt->pkt_payload)
       subscription_add_bytes_in(s, pktbuf_len(pkt->pkt_payload));
+  } else if(sm->sm_type == SMT_PACKET_BATCH) {
+    streaming_pkt_batch_t *spb = sm->sm_data;
+    th_pkt_t *pkt;
+    int i;
+    for (i = 0; i < spb->spb_count; i++) {
+      pkt = spb->spb_pkts[i];
+      atomic_add(&s->ths_total_err, pkt->pkt_err);
+      if (pkt->pkt_payload)
+        subscription_add_bytes_in(s, pktbuf_len(pkt->pkt_payload));
+    }
   } else if(sm->sm_type == SMT_MPEGTS) {
     pktbuf_t *pb = sm->sm_data;
     atomic_add(&s->ths_total_err, pb->pb_err);
@@ -740,9 +758,10 @@ subscription_unsubscribe(th_subscription_t *s, int flags)
   mtimer_disarm(&s->ths_remove_timer);
   mtimer_disarm(&s->ths_ca_check_timer);
 
-  if (s->ths_parser) {
-    parser_destroy(s->ths_parser);
-    s->ths_parser = NULL;
+  if (s->ths_parser && t) {
+    tvh_mutex_lock(&t->s_stream_mutex);
+    subscription_unlink_input(s, t);
+    tvh_mutex_unlock(&t->s_stream_mutex);
   }
 
   if ((flags & UNSUBSCRIBE_FINAL) != 0 ||
@@ -109,7 +109,7 @@ typedef struct th_subscription {
   streaming_target_t ths_input;
 
   streaming_target_t *ths_output;
-  streaming_target_t *ths_parser;
+  streaming_pad_t    *ths_parser;
 
   int ths_flags;
   int ths_timeout;
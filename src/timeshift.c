@@ -46,13 +46,13 @@ memoryinfo_t timeshift_memoryinfo_ram = { .my_name = "Timeshift RAM buffer" };
  */
 void
 timeshift_packet_log0
-  ( const char *source, timeshift_t *ts, streaming_message_t *sm )
+  ( const char *source, int id, streaming_message_t *sm )
 {
   th_pkt_t *pkt = sm->sm_data;
   tvhtrace(LS_TIMESHIFT,
            "ts %d pkt %s - stream %d type %c pts %10"PRId64
            " dts %10"PRId64" dur %10d len %6zu time %14"PRId64,
-           ts->id, source,
+           id, source,
            pkt->pkt_componentindex,
            SCT_ISVIDEO(pkt->pkt_type) ? pkt_frametype_to_char(pkt->v.pkt_frametype) : '-',
            ts_rescale(pkt->pkt_pts, 1000000),
@@ -206,6 +206,18 @@ const idclass_t timeshift_conf_class = {
       .off    = offsetof(timeshift_conf_t, ondemand),
       .opts   = PO_EXPERT,
     },
+    {
+      .type   = PT_BOOL,
+      .id     = "shared",
+      .name   = N_("Shared buffers"),
+      .desc   = N_("Store the data only once for all HTSP clients "
+                   "watching the same channel with the same profile. "
+                   "Each client keeps its own position in the shared "
+                   "buffer. The buffer period is the longest period "
+                   "requested by the clients."),
+      .off    = offsetof(timeshift_conf_t, shared),
+      .opts   = PO_EXPERT,
+    },
     {
       .type   = PT_STR,
       .id     = "path",
@@ -402,6 +414,106 @@ static streaming_ops_t timeshift_input_ops = {
 };
 
 
+/*
+ * Receive data for the shared store (packet mode only)
+ */
+static void timeshift_store_input
+  ( void *opaque, streaming_message_t *sm )
+{
+  timeshift_store_t *st = opaque;
+  th_pkt_t *pkt;
+  int64_t time;
+
+  switch (sm->sm_type) {
+  case SMT_PACKET:
+    pkt = sm->sm_data;
+    /* same time base as timeshift_packet() */
+    if (pkt->pkt_pts != PTS_UNSET && pkt->pkt_type != SCT_TELETEXT) {
+      time = ts_rescale(pkt->pkt_pts, 1000000);
+      if (st->last_wr_time < time)
+        st->last_wr_time = time;
+    }
+    /* fall thru */
+  case SMT_START:
+  case SMT_SIGNAL_STATUS:
+    sm->sm_time = st->last_wr_time;
+    streaming_target_deliver2(&st->wr_queue.sq_st, sm);
+    break;
+  default:
+    streaming_msg_free(sm);
+    break;
+  }
+}
+
+static htsmsg_t *
+timeshift_store_input_info(void *opaque, htsmsg_t *list)
+{
+  htsmsg_add_str(list, NULL, "wtimeshift shared input");
+  return list;
+}
+
+static streaming_ops_t timeshift_store_input_ops = {
+  .st_cb   = timeshift_store_input,
+  .st_info = timeshift_store_input_info
+};
+
+/*
+ * Create the buffer store
+ */
+static timeshift_store_t *
+timeshift_store_create ( int shared, time_t max_time )
+{
+  timeshift_store_t *st = calloc(1, sizeof(timeshift_store_t));
+
+  memoryinfo_alloc(&timeshift_memoryinfo, sizeof(timeshift_store_t));
+
+  TAILQ_INIT(&st->files);
+  st->id       = timeshift_index++;
+  st->shared   = shared;
+  st->refcount = 1;
+  st->max_time = max_time;
+  st->dobuf    = !timeshift_conf.ondemand;
+  st->vididx   = -1;
+  tvh_mutex_init(&st->lock, NULL);
+
+  if (shared) {
+    streaming_queue_init(&st->wr_queue, 0, 0);
+    streaming_target_init(&st->input, &timeshift_store_input_ops, st, 0);
+    tvh_thread_create(&st->wr_thread, NULL, timeshift_store_writer, st, "tshift-swr");
+  }
+  return st;
+}
+
+/*
+ * Release the buffer store
+ */
+static void
+timeshift_store_release ( timeshift_store_t *st )
+{
+  lock_assert(&global_lock);
+
+  if (--st->refcount > 0)
+    return;
+
+  if (st->shared) {
+    streaming_target_deliver2(&st->wr_queue.sq_st, streaming_msg_create(SMT_EXIT));
+    pthread_join(st->wr_thread, NULL);
+    streaming_queue_deinit(&st->wr_queue);
+  }
+
+  /* Flush files */
+  timeshift_filemgr_flush(st, NULL);
+
+  if (st->smt_start)
+    streaming_start_unref(st->smt_start);
+
+  free(st->segs);
+  free(st->path);
+  tvh_mutex_destroy(&st->lock);
+  free(st);
+  memoryinfo_free(&timeshift_memoryinfo, sizeof(timeshift_store_t));
+}
+
 /**
  *
  */
@@ -434,14 +546,7 @@ timeshift_destroy(streaming_target_t *pad)
   close(ts->rd_pipe.rd);
   close(ts->rd_pipe.wr);
 
-  /* Flush files */
-  timeshift_filemgr_flush(ts, NULL);
-
-  if (ts->smt_start)
-    streaming_start_unref(ts->smt_start);
-
-  if (ts->path)
-    free(ts->path);
+  timeshift_store_release(ts->store);
 
   free(ts);
   memoryinfo_free(&timeshift_memoryinfo, sizeof(timeshift_t));
@@ -452,11 +557,17 @@ timeshift_destroy(streaming_target_t *pad)
  *
  * max_period of buffer in seconds (0 = unlimited)
  * max_size   of buffer in bytes   (0 = unlimited)
+ *
+ * If 'shared' is not NULL and the shared buffers are enabled, the data
+ * are stored once for all instances using the same 'shared' pointer.
+ * The caller feeds the shared store through *shared with the same data
+ * (packet mode) as the instance inputs.
  */
 streaming_target_t *timeshift_create
-  (streaming_target_t *out, time_t max_time)
+  (streaming_target_t *out, time_t max_time, streaming_target_t **shared)
 {
   timeshift_t *ts = calloc(1, sizeof(timeshift_t));
+  timeshift_store_t *st;
 
   memoryinfo_alloc(&timeshift_memoryinfo, sizeof(timeshift_t));
 
@@ -464,28 +575,42 @@ streaming_target_t *timeshift_create
   lock_assert(&global_lock);
 
   /* Setup structure */
-  TAILQ_INIT(&ts->files);
   ts->output     = out;
-  ts->path       = NULL;
-  ts->max_time   = max_time;
   ts->state      = TS_LIVE;
   ts->exit       = 0;
-  ts->full       = 0;
-  ts->vididx     = -1;
   ts->id         = timeshift_index;
   ts->ondemand   = timeshift_conf.ondemand;
-  ts->dobuf      = ts->ondemand ? 0 : 1;
   ts->packet_mode= 1;
   ts->last_wr_time = 0;
   ts->buf_time   = 0;
   ts->start_pts  = 0;
   ts->ref_time   = 0;
   ts->seek.file  = NULL;
-  ts->seek.frame = NULL;
-  ts->ram_segments = 0;
-  ts->file_segments = 0;
+  ts->seek.frame = -1;
+  ts->seek.rfd   = -1;
   tvh_mutex_init(&ts->state_mutex, NULL);
 
+  /* Buffer store */
+  if (shared && timeshift_conf.shared) {
+    if (*shared) {
+      st = (timeshift_store_t *)*shared;
+      st->refcount++;
+      tvh_mutex_lock(&st->lock);
+      if (max_time == 0 || (st->max_time && st->max_time < max_time))
+        st->max_time = max_time;
+      tvh_mutex_unlock(&st->lock);
+    } else {
+      st = timeshift_store_create(1, max_time);
+      *shared = &st->input;
+    }
+    ts->id = timeshift_index++;
+    tvhdebug(LS_TIMESHIFT, "ts %d uses shared buffer %d (%d users)",
+             ts->id, st->id, st->refcount);
+  } else {
+    st = timeshift_store_create(0, max_time);
+  }
+  ts->store = st;
+
   /* Initialise output */
   tvh_pipe(O_NONBLOCK, &ts->rd_pipe);
 
@@ -495,8 +620,5 @@ streaming_target_t *timeshift_create
   tvh_thread_create(&ts->wr_thread, NULL, timeshift_writer, ts, "tshift-wr");
   tvh_thread_create(&ts->rd_thread, NULL, timeshift_reader, ts, "tshift-rd");
 
-  /* Update index */
-  timeshift_index++;
-
   return &ts->input;
 }
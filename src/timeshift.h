@@ -27,6 +27,7 @@ typedef struct timeshift_conf {
   idnode_t  idnode;
   int       enabled;
   int       ondemand;
+  int       shared;
   char     *path;
   int       unlimited_period;
   uint32_t  max_period;
@@ -51,7 +52,7 @@ void timeshift_init ( void );
 void timeshift_term ( void );
 
 streaming_target_t *timeshift_create
-  (streaming_target_t *out, time_t max_period);
+  (streaming_target_t *out, time_t max_period, streaming_target_t **shared);
 
 void timeshift_destroy(streaming_target_t *pad);
 
@@ -22,19 +22,21 @@
 #define TIMESHIFT_PLAY_BUF         1000000 //< us to buffer in TX
 #define TIMESHIFT_FILE_PERIOD      60      //< number of secs in each buffer file
 #define TIMESHIFT_BACKLOG_MAX      16      //< maximum elementary streams
+#define TIMESHIFT_WBUF_SIZE        (256*1024) //< write-behind buffer size (file mode)
+#define TIMESHIFT_WBUF_TIME        sec2mono(1) //< max age of the unwritten data (checked on write)
+#define TIMESHIFT_WBUF_IOV         8       //< max iovec parts of one record
+
+#define TIMESHIFT_IFRAMES_MIN      32      //< initial I-frame index size
 
 /**
- * Indexes of import data in the stream
+ * Indexes of import data in the stream (array, sorted by time)
  */
 typedef struct timeshift_index_iframe
 {
   off_t                               pos;    ///< Position in the file
   int64_t                             time;   ///< Packet time
-  TAILQ_ENTRY(timeshift_index_iframe) link;   ///< List entry
 } timeshift_index_iframe_t;
 
-typedef TAILQ_HEAD(timeshift_index_iframe_list,timeshift_index_iframe) timeshift_index_iframe_list_t;
-
 /**
  * Indexes of import data in the stream
  */
@@ -53,40 +55,89 @@ typedef TAILQ_HEAD(timeshift_index_data_list,timeshift_index_data) timeshift_ind
 typedef struct timeshift_file
 {
   int                           wfd;      ///< Write descriptor
-  int                           rfd;      ///< Read descriptor
   char                          *path;    ///< Full path to file
 
   int64_t                       time;     ///< Files coarse timestamp
+  int64_t                       start;    ///< Time of the first packet
   size_t                        size;     ///< Current file size;
   int64_t                       last;     ///< Latest timestamp
-  off_t                         woff;     ///< Write offset
-  off_t                         roff;     ///< Read offset
+  off_t                         woff;     ///< Write offset (file: flushed bytes)
 
   uint8_t                      *ram;      ///< RAM area
   int64_t                       ram_size; ///< RAM area size in bytes
 
+  uint8_t                      *wbuf;     ///< Write-behind buffer (file mode)
+  size_t                        wbuf_len; ///< Bytes not yet written to the file
+  int64_t                       wbuf_time;///< Time of the oldest unwritten data
+
   uint8_t                       bad;      ///< File is broken
+  uint8_t                       detached; ///< Removed from the store, freed on last put
 
-  int                           refcount; ///< Reader ref count
+  int                           refcount; ///< Reader ref count (store lock)
 
-  timeshift_index_iframe_list_t iframes;  ///< I-frame indexing
+  timeshift_index_iframe_t     *iframes;  ///< I-frame indexing
+  int                           iframes_count; ///< Used I-frame entries
+  int                           iframes_alloc; ///< Allocated I-frame entries
   timeshift_index_data_list_t   sstart;   ///< Stream start messages
 
   TAILQ_ENTRY(timeshift_file) link;     ///< List entry
 
-  tvh_mutex_t               ram_lock; ///< Mutex for the ram array access
+  tvh_mutex_t               ram_lock; ///< Mutex for the ram array / wbuf access
 } timeshift_file_t;
 
 typedef TAILQ_HEAD(timeshift_file_list,timeshift_file) timeshift_file_list_t;
 
 /**
- *
+ * Read position (per reader)
  */
 typedef struct timeshift_seek {
   timeshift_file_t           *file;
-  timeshift_index_iframe_t   *frame;
+  int                         frame;      ///< I-frame index in file (-1 = none)
+  off_t                       roff;       ///< Read offset in file
+  int                         rfd;        ///< Read descriptor
 } timeshift_seek_t;
 
+/**
+ * Buffered data (files and indexes)
+ *
+ * Each timeshift instance owns one store unless the shared buffers
+ * are enabled. The shared store is fed once by the profile sharer and
+ * read by all attached instances, each with its own read position.
+ */
+typedef struct timeshift_store {
+  // Note: input MUST BE FIRST in struct
+  streaming_target_t          input;      ///< Input source (shared)
+
+  int                         id;         ///< Reference number
+  int                         shared;     ///< Fed by the profile sharer
+  int                         refcount;   ///< Attached instances (global lock)
+  char                        *path;      ///< Directory containing buffer
+  time_t                      max_time;   ///< Maximum period to shift
+  int                         dobuf;      ///< Buffer packets (store)
+  uint8_t                     full;       ///< Buffer is full
+  int64_t                     last_wr_time;///< Last write time in us (shared input)
+
+  tvh_mutex_t                 lock;       ///< Protect files, indexes and refcounts
+
+  streaming_queue_t           wr_queue;   ///< Writer queue (shared)
+  pthread_t                   wr_thread;  ///< Writer thread (shared)
+
+  timeshift_file_list_t       files;      ///< List of files
+  timeshift_file_t          **segs;       ///< Files in list order (time search)
+  int                         segs_count; ///< Used entries in segs
+  int                         segs_alloc; ///< Allocated entries in segs
+
+  int                         ram_segments;  ///< Count of segments in RAM
+  int                         file_segments; ///< Count of segments in files
+
+  int                         vididx;     ///< Index of (current) video stream
+  int                         audidx;     ///< Index of (current) audio stream
+
+  uint8_t                     audio_packet_counter; ///< Counter for audio packets in audio-only streams
+
+  streaming_start_t          *smt_start;  ///< Streaming start info
+} timeshift_store_t;
+
 /**
  *
  */
@@ -96,16 +147,15 @@ typedef struct timeshift {
   streaming_target_t          *output;    ///< Output dest
 
   int                         id;         ///< Reference number
-  char                        *path;      ///< Directory containing buffer
-  time_t                      max_time;   ///< Maximum period to shift
+  timeshift_store_t           *store;     ///< Buffered data
   int                         ondemand;   ///< Whether this is an on-demand timeshift
   int                         packet_mode;///< Packet mode (otherwise MPEG-TS data mode)
-  int                         dobuf;      ///< Buffer packets (store)
   int64_t                     last_wr_time;///< Last write time in us (PTS conversion)
   int64_t                     start_pts;  ///< Start time for packets (PTS)
   int64_t                     ref_time;   ///< Start time in us (monoclock)
   int64_t                     buf_time;   ///< Last buffered time in us (PTS conversion)
   int                         backlog_max;///< Maximum component index in backlog
+  int64_t                     seek_time;  ///< Duration of the last skip in us
 
   enum {
     TS_EXIT,
@@ -115,7 +165,7 @@ typedef struct timeshift {
   }                           state;       ///< Play state
   tvh_mutex_t             state_mutex; ///< Protect state changes
   uint8_t                     exit;        ///< Exit from the main input thread
-  uint8_t                     full;        ///< Buffer is full
+  uint8_t                     full;        ///< Reader lost buffered data (shared store)
 
   timeshift_seek_t            seek;       ///< Seek into buffered data
   
@@ -125,18 +175,6 @@ typedef struct timeshift {
   pthread_t                   rd_thread;  ///< Reader thread
   th_pipe_t                   rd_pipe;    ///< Message passing to reader
 
-  timeshift_file_list_t       files;      ///< List of files
-
-  int                         ram_segments;  ///< Count of segments in RAM
-  int                         file_segments; ///< Count of segments in files
-
-  int                         vididx;     ///< Index of (current) video stream
-  int                         audidx;     ///< Index of (current) audio stream
-  
-  uint8_t                         audio_packet_counter; ///< Counter for audio packets in audio-only streams
-
-  streaming_start_t          *smt_start;  ///< Streaming start info
-
 } timeshift_t;
 
 /*
@@ -146,13 +184,13 @@ extern uint64_t timeshift_total_size;
 extern uint64_t timeshift_total_ram_size;
 
 void timeshift_packet_log0
-  ( const char *prefix, timeshift_t *ts, streaming_message_t *sm );
+  ( const char *prefix, int id, streaming_message_t *sm );
 
 static inline void timeshift_packet_log
   ( const char *prefix, timeshift_t *ts, streaming_message_t *sm )
 {
   if (sm->sm_type == SMT_PACKET && tvhtrace_enabled())
-    timeshift_packet_log0(prefix, ts, sm);
+    timeshift_packet_log0(prefix, ts->id, sm);
 }
 
 /*
@@ -173,6 +211,12 @@ ssize_t timeshift_write_eof     ( timeshift_file_t *tsf );
  */
 void *timeshift_reader ( void *p );
 void *timeshift_writer ( void *p );
+void *timeshift_store_writer ( void *p );
+
+/*
+ * Store the message to the buffer (store lock)
+ */
+void timeshift_store_msg ( timeshift_store_t *st, streaming_message_t *sm );
 
 /*
  * File management
@@ -194,11 +238,14 @@ static inline void timeshift_file_get0 ( timeshift_file_t *tsf )
   tsf; \
 })
 
+void timeshift_filemgr_release ( timeshift_file_t *tsf );
+
 static inline void timeshift_file_put0 ( timeshift_file_t *tsf )
 {
   if (tsf) {
     assert(tsf->refcount > 0);
-    tsf->refcount--;
+    if (--tsf->refcount == 0 && tsf->detached)
+      timeshift_filemgr_release(tsf);
   }
 }
 
@@ -210,26 +257,28 @@ static inline void timeshift_file_put0 ( timeshift_file_t *tsf )
 })
 
 timeshift_file_t *timeshift_filemgr_get
-  ( timeshift_t *ts, int64_t start_time );
+  ( timeshift_store_t *st, int64_t start_time );
 timeshift_file_t *timeshift_filemgr_oldest
-  ( timeshift_t *ts );
+  ( timeshift_store_t *st );
 timeshift_file_t *timeshift_filemgr_newest
-  ( timeshift_t *ts );
+  ( timeshift_store_t *st );
+timeshift_file_t *timeshift_filemgr_find
+  ( timeshift_store_t *st, int64_t time );
 timeshift_file_t *timeshift_filemgr_prev
   ( timeshift_file_t *ts, int *end, int keep );
 timeshift_file_t *timeshift_filemgr_next
   ( timeshift_file_t *ts, int *end, int keep );
 void timeshift_filemgr_remove
-  ( timeshift_t *ts, timeshift_file_t *tsf, int force );
-void timeshift_filemgr_flush ( timeshift_t *ts, timeshift_file_t *end );
+  ( timeshift_store_t *st, timeshift_file_t *tsf, int force );
+void timeshift_filemgr_flush ( timeshift_store_t *st, timeshift_file_t *end );
 void timeshift_filemgr_close ( timeshift_file_t *tsf );
 
-void timeshift_filemgr_dump0 ( timeshift_t *ts );
+void timeshift_filemgr_dump0 ( timeshift_store_t *st );
 
-static inline void timeshift_filemgr_dump ( timeshift_t *ts )
+static inline void timeshift_filemgr_dump ( timeshift_store_t *st )
 {
   if (tvhtrace_enabled())
-    timeshift_filemgr_dump0(ts);
+    timeshift_filemgr_dump0(st);
 }
 
 #endif /* __TVH_TIMESHIFT_PRIVATE_H__ */
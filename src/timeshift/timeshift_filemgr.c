@@ -43,7 +43,6 @@ static void* timeshift_reaper_callback ( void *p )
 {
   char *dpath;
   timeshift_file_t *tsf;
-  timeshift_index_iframe_t *ti;
   timeshift_index_data_t *tid;
   streaming_message_t *sm;
   tvh_mutex_lock(&timeshift_reaper_lock);
@@ -73,10 +72,10 @@ static void* timeshift_reaper_callback ( void *p )
     }
 
     /* Free memory */
-    while ((ti = TAILQ_FIRST(&tsf->iframes))) {
-      TAILQ_REMOVE(&tsf->iframes, ti, link);
-      memoryinfo_free(&timeshift_memoryinfo, sizeof(*ti));
-      free(ti);
+    if (tsf->iframes) {
+      memoryinfo_free(&timeshift_memoryinfo,
+                      tsf->iframes_alloc * sizeof(timeshift_index_iframe_t));
+      free(tsf->iframes);
     }
     while ((tid = TAILQ_FIRST(&tsf->sstart))) {
       TAILQ_REMOVE(&tsf->sstart, tid, link);
@@ -86,6 +85,10 @@ static void* timeshift_reaper_callback ( void *p )
       free(tid);
     }
     free(tsf->path);
+    if (tsf->wbuf) {
+      memoryinfo_free(&timeshift_memoryinfo, TIMESHIFT_WBUF_SIZE);
+      free(tsf->wbuf);
+    }
     memoryinfo_free(&timeshift_memoryinfo_ram, tsf->ram_size);
     free(tsf->ram);
     memoryinfo_free(&timeshift_memoryinfo, sizeof(*tsf));
@@ -117,17 +120,17 @@ static void timeshift_reaper_remove ( timeshift_file_t *tsf )
  * *************************************************************************/
 
 void
-timeshift_filemgr_dump0 ( timeshift_t *ts )
+timeshift_filemgr_dump0 ( timeshift_store_t *st )
 {
   timeshift_file_t *tsf;
 
-  if (TAILQ_EMPTY(&ts->files)) {
-    tvhtrace(LS_TIMESHIFT, "ts %d file dump - EMPTY", ts->id);
+  if (TAILQ_EMPTY(&st->files)) {
+    tvhtrace(LS_TIMESHIFT, "ts %d file dump - EMPTY", st->id);
     return;
   }
-  TAILQ_FOREACH(tsf, &ts->files, link) {
+  TAILQ_FOREACH(tsf, &st->files, link) {
     tvhtrace(LS_TIMESHIFT, "ts %d (full=%d) file dump tsf %p time %4"PRId64" last %10"PRId64" bad %d refcnt %d",
-             ts->id, ts->full, tsf, tsf->time, tsf->last, tsf->bad, tsf->refcount);
+             st->id, st->full, tsf, tsf->time, tsf->last, tsf->bad, tsf->refcount);
   }
 }
 
@@ -164,6 +167,7 @@ int timeshift_filemgr_makedirs ( int index, char *buf, size_t len )
  */
 void timeshift_filemgr_close ( timeshift_file_t *tsf )
 {
+  timeshift_index_iframe_t *ti;
   uint8_t *ram;
   ssize_t r = timeshift_write_eof(tsf);
   if (r > 0) {
@@ -174,12 +178,32 @@ void timeshift_filemgr_close ( timeshift_file_t *tsf )
   }
   if (tsf->ram) {
     /* maintain unused memory block */
+    tvh_mutex_lock(&tsf->ram_lock);
     ram = realloc(tsf->ram, tsf->woff);
     if (ram) {
       memoryinfo_append(&timeshift_memoryinfo_ram, tsf->ram_size - tsf->woff);
       tsf->ram = ram;
       tsf->ram_size = tsf->woff;
     }
+    tvh_mutex_unlock(&tsf->ram_lock);
+  }
+  if (tsf->iframes_count > 0 && tsf->iframes_count < tsf->iframes_alloc) {
+    /* the index is complete now */
+    ti = realloc(tsf->iframes, tsf->iframes_count * sizeof(*ti));
+    if (ti) {
+      memoryinfo_remove(&timeshift_memoryinfo,
+                        (tsf->iframes_alloc - tsf->iframes_count) * sizeof(*ti));
+      tsf->iframes = ti;
+      tsf->iframes_alloc = tsf->iframes_count;
+    }
+  }
+  if (tsf->wbuf) {
+    tvh_mutex_lock(&tsf->ram_lock);
+    free(tsf->wbuf);
+    tsf->wbuf = NULL;
+    tsf->wbuf_len = 0;
+    tvh_mutex_unlock(&tsf->ram_lock);
+    memoryinfo_free(&timeshift_memoryinfo, TIMESHIFT_WBUF_SIZE);
   }
   if (tsf->wfd >= 0)
     close(tsf->wfd);
@@ -190,41 +214,62 @@ void timeshift_filemgr_close ( timeshift_file_t *tsf )
  * Remove file
  */
 void timeshift_filemgr_remove
-  ( timeshift_t *ts, timeshift_file_t *tsf, int force )
+  ( timeshift_store_t *st, timeshift_file_t *tsf, int force )
 {
+  int i;
+
   if (tsf->wfd >= 0)
     close(tsf->wfd);
-  assert(tsf->rfd < 0);
   if (tvhtrace_enabled()) {
     if (tsf->path)
-      tvhdebug(LS_TIMESHIFT, "ts %d remove %s (size %"PRId64")", ts->id, tsf->path, (int64_t)tsf->size);
+      tvhdebug(LS_TIMESHIFT, "ts %d remove %s (size %"PRId64")", st->id, tsf->path, (int64_t)tsf->size);
     else
       tvhdebug(LS_TIMESHIFT, "ts %d RAM segment remove time %"PRId64" (size %"PRId64", alloc size %"PRId64")",
-               ts->id, tsf->time, (int64_t)tsf->size, (int64_t)tsf->ram_size);
+               st->id, tsf->time, (int64_t)tsf->size, (int64_t)tsf->ram_size);
   }
-  TAILQ_REMOVE(&ts->files, tsf, link);
+  TAILQ_REMOVE(&st->files, tsf, link);
+  for (i = 0; i < st->segs_count; i++)
+    if (st->segs[i] == tsf) {
+      memmove(st->segs + i, st->segs + i + 1,
+              (st->segs_count - i - 1) * sizeof(timeshift_file_t *));
+      st->segs_count--;
+      break;
+    }
   if (tsf->path) {
-    assert(ts->file_segments > 0);
-    ts->file_segments--;
+    assert(st->file_segments > 0);
+    st->file_segments--;
   } else {
-    assert(ts->ram_segments > 0);
-    ts->ram_segments--;
+    assert(st->ram_segments > 0);
+    st->ram_segments--;
   }
   atomic_dec_u64(&timeshift_total_size, tsf->size);
   if (tsf->ram)
     atomic_dec_u64(&timeshift_total_ram_size, tsf->size);
+  if (tsf->refcount > 0) {
+    /* a reader still uses the data, free on the last put */
+    tsf->detached = 1;
+    return;
+  }
+  timeshift_reaper_remove(tsf);
+}
+
+/*
+ * Free the detached file (the last reference is gone)
+ */
+void timeshift_filemgr_release ( timeshift_file_t *tsf )
+{
   timeshift_reaper_remove(tsf);
 }
 
 /*
  * Flush all files
  */
-void timeshift_filemgr_flush ( timeshift_t *ts, timeshift_file_t *end )
+void timeshift_filemgr_flush ( timeshift_store_t *st, timeshift_file_t *end )
 {
   timeshift_file_t *tsf;
-  while ((tsf = TAILQ_FIRST(&ts->files))) {
+  while ((tsf = TAILQ_FIRST(&st->files))) {
     if (tsf == end) break;
-    timeshift_filemgr_remove(ts, tsf, 1);
+    timeshift_filemgr_remove(st, tsf, 1);
   }
 }
 
@@ -232,19 +277,23 @@ void timeshift_filemgr_flush ( timeshift_t *ts, timeshift_file_t *end )
  *
  */
 static timeshift_file_t * timeshift_filemgr_file_init
-  ( timeshift_t *ts, int64_t start_time )
+  ( timeshift_store_t *st, int64_t start_time )
 {
   timeshift_file_t *tsf;
 
   tsf = calloc(1, sizeof(timeshift_file_t));
   memoryinfo_alloc(&timeshift_memoryinfo, sizeof(*tsf));
   tsf->time     = mono2sec(start_time) / TIMESHIFT_FILE_PERIOD;
+  tsf->start    = start_time;
   tsf->last     = start_time;
   tsf->wfd      = -1;
-  tsf->rfd      = -1;
-  TAILQ_INIT(&tsf->iframes);
   TAILQ_INIT(&tsf->sstart);
-  TAILQ_INSERT_TAIL(&ts->files, tsf, link);
+  TAILQ_INSERT_TAIL(&st->files, tsf, link);
+  if (st->segs_count == st->segs_alloc) {
+    st->segs_alloc = MAX(16, st->segs_alloc * 2);
+    st->segs = realloc(st->segs, st->segs_alloc * sizeof(timeshift_file_t *));
+  }
+  st->segs[st->segs_count++] = tsf;
   tvh_mutex_init(&tsf->ram_lock, NULL);
   return tsf;
 }
@@ -252,29 +301,30 @@ static timeshift_file_t * timeshift_filemgr_file_init
 /*
  * Get current / new file
  */
-timeshift_file_t *timeshift_filemgr_get ( timeshift_t *ts, int64_t start_time )
+timeshift_file_t *timeshift_filemgr_get ( timeshift_store_t *st, int64_t start_time )
 {
   int fd;
   timeshift_file_t *tsf_tl, *tsf_hd, *tsf_tmp;
   timeshift_index_data_t *ti;
   streaming_message_t *sm;
   char path[PATH_MAX];
-  int64_t time;
+  uint8_t *ram;
+  int64_t time, ram_size;
 
   /* Return last file */
   if (start_time < 0)
-    return timeshift_filemgr_newest(ts);
+    return timeshift_filemgr_newest(st);
 
   /* No space */
-  if (ts->full)
+  if (st->full)
     return NULL;
 
   /* Store to file */
-  tsf_tl = TAILQ_LAST(&ts->files, timeshift_file_list);
+  tsf_tl = TAILQ_LAST(&st->files, timeshift_file_list);
   time = mono2sec(start_time) / TIMESHIFT_FILE_PERIOD;
   if (!tsf_tl || tsf_tl->time < time ||
       (tsf_tl->ram && tsf_tl->woff >= timeshift_conf.ram_segment_size)) {
-    tsf_hd = TAILQ_FIRST(&ts->files);
+    tsf_hd = TAILQ_FIRST(&st->files);
 
     /* Close existing */
     if (tsf_tl)
@@ -282,15 +332,16 @@ timeshift_file_t *timeshift_filemgr_get ( timeshift_t *ts, int64_t start_time )
 
     /* Check period */
     if (!timeshift_conf.unlimited_period &&
-        ts->max_time && tsf_hd && tsf_tl) {
+        st->max_time && tsf_hd && tsf_tl) {
       time_t d = (tsf_tl->time - tsf_hd->time) * TIMESHIFT_FILE_PERIOD;
-      if (d > (ts->max_time+5)) {
-        if (!tsf_hd->refcount) {
-          timeshift_filemgr_remove(ts, tsf_hd, 0);
+      if (d > (st->max_time+5)) {
+        /* the shared store is never stopped by a lagging reader */
+        if (!tsf_hd->refcount || st->shared) {
+          timeshift_filemgr_remove(st, tsf_hd, 0);
           tsf_hd = NULL;
         } else {
-          tvhdebug(LS_TIMESHIFT, "ts %d buffer full", ts->id);
-          ts->full = 1;
+          tvhdebug(LS_TIMESHIFT, "ts %d buffer full", st->id);
+          st->full = 1;
         }
       }
     }
@@ -300,46 +351,46 @@ timeshift_file_t *timeshift_filemgr_get ( timeshift_t *ts, int64_t start_time )
         atomic_pre_add_u64(&timeshift_conf.total_size, 0) >= timeshift_conf.max_size) {
 
       /* Remove the last file (if we can) */
-      if (tsf_hd && !tsf_hd->refcount) {
-        timeshift_filemgr_remove(ts, tsf_hd, 0);
+      if (tsf_hd && (!tsf_hd->refcount || st->shared)) {
+        timeshift_filemgr_remove(st, tsf_hd, 0);
 
       /* Full */
       } else {
-        tvhdebug(LS_TIMESHIFT, "ts %d buffer full", ts->id);
-        ts->full = 1;
+        tvhdebug(LS_TIMESHIFT, "ts %d buffer full", st->id);
+        st->full = 1;
       }
     }
 
     /* Create new file */
     tsf_tmp = NULL;
-    if (!ts->full) {
+    if (!st->full) {
 
       tvhtrace(LS_TIMESHIFT, "ts %d RAM total %"PRId64" requested %"PRId64" segment %"PRId64,
-                   ts->id, atomic_pre_add_u64(&timeshift_total_ram_size, 0),
+                   st->id, atomic_pre_add_u64(&timeshift_total_ram_size, 0),
                    timeshift_conf.ram_size, timeshift_conf.ram_segment_size);
       while (1) {
         if (timeshift_conf.ram_size >= 8*1024*1024 &&
             atomic_pre_add_u64(&timeshift_total_ram_size, 0) <
               timeshift_conf.ram_size + (timeshift_conf.ram_segment_size / 2)) {
-          tsf_tmp = timeshift_filemgr_file_init(ts, start_time);
-          tsf_tmp->ram_size = MIN(16*1024*1024, timeshift_conf.ram_segment_size);
-          tsf_tmp->ram = malloc(tsf_tmp->ram_size);
-          if (!tsf_tmp->ram) {
-            free(tsf_tmp);
-            tsf_tmp = NULL;
-          } else {
+          ram_size = MIN(16*1024*1024, timeshift_conf.ram_segment_size);
+          ram = malloc(ram_size);
+          if (ram) {
+            tsf_tmp = timeshift_filemgr_file_init(st, start_time);
+            tsf_tmp->ram_size = ram_size;
+            tsf_tmp->ram = ram;
             tvhtrace(LS_TIMESHIFT, "ts %d create RAM segment with %"PRId64" bytes (time %"PRId64")",
-                     ts->id, tsf_tmp->ram_size, start_time);
-            ts->ram_segments++;
+                     st->id, tsf_tmp->ram_size, start_time);
+            st->ram_segments++;
             memoryinfo_alloc(&timeshift_memoryinfo_ram, tsf_tmp->ram_size);
           }
           break;
         } else {
-          tsf_hd = TAILQ_FIRST(&ts->files);
-          if (timeshift_conf.ram_fit && tsf_hd && !tsf_hd->refcount &&
-              tsf_hd->ram && ts->file_segments == 0) {
-            tvhtrace(LS_TIMESHIFT, "ts %d remove RAM segment %"PRId64" (fit)", ts->id, tsf_hd->time);
-            timeshift_filemgr_remove(ts, tsf_hd, 0);
+          tsf_hd = TAILQ_FIRST(&st->files);
+          if (timeshift_conf.ram_fit && tsf_hd &&
+              (!tsf_hd->refcount || st->shared) &&
+              tsf_hd->ram && st->file_segments == 0) {
+            tvhtrace(LS_TIMESHIFT, "ts %d remove RAM segment %"PRId64" (fit)", st->id, tsf_hd->time);
+            timeshift_filemgr_remove(st, tsf_hd, 0);
           } else {
             break;
           }
@@ -348,43 +399,43 @@ timeshift_file_t *timeshift_filemgr_get ( timeshift_t *ts, int64_t start_time )
       
       if (!tsf_tmp && !timeshift_conf.ram_only) {
         /* Create directories */
-        if (!ts->path) {
-          if (timeshift_filemgr_makedirs(ts->id, path, sizeof(path)))
+        if (!st->path) {
+          if (timeshift_filemgr_makedirs(st->id, path, sizeof(path)))
             return NULL;
-          ts->path = strdup(path);
+          st->path = strdup(path);
         }
 
         /* Create File */
-        snprintf(path, sizeof(path), "%s/tvh-%"PRId64, ts->path, start_time);
-        tvhtrace(LS_TIMESHIFT, "ts %d create file %s", ts->id, path);
+        snprintf(path, sizeof(path), "%s/tvh-%"PRId64, st->path, start_time);
+        tvhtrace(LS_TIMESHIFT, "ts %d create file %s", st->id, path);
         if ((fd = tvh_open(path, O_WRONLY | O_CREAT, 0600)) > 0) {
-          tsf_tmp = timeshift_filemgr_file_init(ts, start_time);
+          tsf_tmp = timeshift_filemgr_file_init(st, start_time);
           tsf_tmp->wfd = fd;
           tsf_tmp->path = strdup(path);
-          ts->file_segments++;
+          st->file_segments++;
         }
       }
 
       if (tsf_tmp && tsf_tl) {
         /* Copy across last start message */
-        if ((ti = TAILQ_LAST(&tsf_tl->sstart, timeshift_index_data_list)) || ts->smt_start) {
+        if ((ti = TAILQ_LAST(&tsf_tl->sstart, timeshift_index_data_list)) || st->smt_start) {
           tvhtrace(LS_TIMESHIFT, "ts %d copy smt_start to new file%s",
-                   ts->id, ti ? " (from last file)" : "");
+                   st->id, ti ? " (from last file)" : "");
           timeshift_index_data_t *ti2 = calloc(1, sizeof(timeshift_index_data_t));
           if (ti) {
             memoryinfo_alloc(&timeshift_memoryinfo, sizeof(timeshift_index_data_t));
             sm = streaming_msg_clone(ti->data);
           } else {
             sm = streaming_msg_create(SMT_START);
-            streaming_start_ref(ts->smt_start);
-            sm->sm_data = ts->smt_start;
+            streaming_start_ref(st->smt_start);
+            sm->sm_data = st->smt_start;
           }
           ti2->data = sm;
           TAILQ_INSERT_TAIL(&tsf_tmp->sstart, ti2, link);
         }
       }
     }
-    timeshift_filemgr_dump(ts);
+    timeshift_filemgr_dump(st);
     tsf_tl = tsf_tmp;
   }
 
@@ -414,18 +465,38 @@ timeshift_file_t *timeshift_filemgr_prev
 /*
  * Get the oldest file
  */
-timeshift_file_t *timeshift_filemgr_oldest ( timeshift_t *ts )
+timeshift_file_t *timeshift_filemgr_oldest ( timeshift_store_t *st )
 {
-  timeshift_file_t *tsf = TAILQ_FIRST(&ts->files);
+  timeshift_file_t *tsf = TAILQ_FIRST(&st->files);
   return timeshift_file_get(tsf);
 }
 
+/*
+ * Get the last file started at or before the given time (binary search),
+ * the oldest file if the time precedes the buffer
+ */
+timeshift_file_t *timeshift_filemgr_find ( timeshift_store_t *st, int64_t time )
+{
+  int lo = 0, hi = st->segs_count, mid;
+
+  if (hi == 0)
+    return NULL;
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (st->segs[mid]->start <= time)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return timeshift_file_get(st->segs[lo > 0 ? lo - 1 : 0]);
+}
+
 /*
  * Get the newest file
  */
-timeshift_file_t *timeshift_filemgr_newest ( timeshift_t *ts )
+timeshift_file_t *timeshift_filemgr_newest ( timeshift_store_t *st )
 {
-  timeshift_file_t *tsf = TAILQ_LAST(&ts->files, timeshift_file_list);
+  timeshift_file_t *tsf = TAILQ_LAST(&st->files, timeshift_file_list);
   return timeshift_file_get(tsf);
 }
 
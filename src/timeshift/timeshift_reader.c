@@ -39,13 +39,19 @@
 
 /* **************************************************************************
  * Buffered position handling
+ *
+ * The store lock protects only the file list, the indexes and the file
+ * reference counts. The data are read through the per-reader descriptor
+ * and the file ram_lock, so the readers and the writer of a shared store
+ * do not serialize on the store lock.
  * *************************************************************************/
 
+/* store lock must be held */
 static timeshift_seek_t *_seek_reset ( timeshift_seek_t *seek )
 {
   timeshift_file_t *tsf = seek->file;
   seek->file  = NULL;
-  seek->frame = NULL;
+  seek->frame = -1;
   timeshift_file_put(tsf);
   return seek;
 }
@@ -54,17 +60,16 @@ static timeshift_seek_t *_seek_set_file
   ( timeshift_seek_t *seek, timeshift_file_t *tsf, off_t roff )
 {
   seek->file  = tsf;
-  seek->frame = NULL;
-  if (tsf)
-    tsf->roff = roff;
+  seek->frame = -1;
+  seek->roff  = roff;
   return seek;
 }
 
 static timeshift_seek_t *_read_close ( timeshift_seek_t *seek )
 {
-  if (seek->file && seek->file->rfd >= 0) {
-    close(seek->file->rfd);
-    seek->file->rfd = -1;
+  if (seek->rfd >= 0) {
+    close(seek->rfd);
+    seek->rfd = -1;
   }
   return _seek_reset(seek);
 }
@@ -73,23 +78,62 @@ static timeshift_seek_t *_read_close ( timeshift_seek_t *seek )
  * File Reading
  * *************************************************************************/
 
-static ssize_t _read_buf ( timeshift_file_t *tsf, int fd, void *buf, size_t size )
+static ssize_t _read_buf ( timeshift_seek_t *seek, int fd, void *buf, size_t size )
 {
+  timeshift_file_t *tsf = seek ? seek->file : NULL;
   ssize_t r;
   size_t ret;
+  off_t off;
 
   if (tsf && tsf->ram) {
-    if (tsf->roff == tsf->woff) return 0;
-    if (tsf->roff + size > tsf->woff) return -1;
     tvh_mutex_lock(&tsf->ram_lock);
-    memcpy(buf, tsf->ram + tsf->roff, size);
-    tsf->roff += size;
+    if (seek->roff == tsf->woff || seek->roff + size > tsf->woff) {
+      r = seek->roff == tsf->woff ? 0 : -1;
+      tvh_mutex_unlock(&tsf->ram_lock);
+      return r;
+    }
+    memcpy(buf, tsf->ram + seek->roff, size);
+    seek->roff += size;
     tvh_mutex_unlock(&tsf->ram_lock);
     return size;
+  } else if (tsf) {
+    /* The file data followed by the unwritten data from the writer */
+    off = seek->roff;
+    ret = 0;
+    while (size > 0) {
+      tvh_mutex_lock(&tsf->ram_lock);
+      if (off >= tsf->woff) {
+        if (off - tsf->woff >= tsf->wbuf_len) {
+          tvh_mutex_unlock(&tsf->ram_lock);
+          return 0;
+        }
+        r = MIN(size, tsf->woff + tsf->wbuf_len - off);
+        memcpy(buf, tsf->wbuf + (off - tsf->woff), r);
+        tvh_mutex_unlock(&tsf->ram_lock);
+      } else {
+        r = MIN(size, tsf->woff - off);
+        tvh_mutex_unlock(&tsf->ram_lock);
+        r = pread(seek->rfd, buf, r, off);
+        if (r < 0) {
+          if (ERRNO_AGAIN(errno))
+            continue;
+          tvhtrace(LS_TIMESHIFT, "read errno %d", errno);
+          return -1;
+        }
+        if (r == 0)
+          return 0;
+      }
+      size -= r;
+      ret += r;
+      buf += r;
+      off += r;
+    }
+    seek->roff = off;
+    return ret;
   } else {
     ret = 0;
     while (size > 0) {
-      r = read(tsf ? tsf->rfd : fd, buf, size);
+      r = read(fd, buf, size);
       if (r < 0) {
         if (ERRNO_AGAIN(errno))
           continue;
@@ -104,19 +148,17 @@ static ssize_t _read_buf ( timeshift_file_t *tsf, int fd, void *buf, size_t size
       if (r == 0)
         return 0;
     }
-    if (ret > 0 && tsf)
-      tsf->roff += ret;
     return ret;
   }
 }
 
-static ssize_t _read_pktbuf ( timeshift_file_t *tsf, int fd, pktbuf_t **pktbuf )
+static ssize_t _read_pktbuf ( timeshift_seek_t *seek, int fd, pktbuf_t **pktbuf )
 {
   ssize_t r, cnt = 0;
   size_t sz;
 
   /* Size */
-  r = _read_buf(tsf, fd, &sz, sizeof(sz));
+  r = _read_buf(seek, fd, &sz, sizeof(sz));
   if (r < 0) return -1;
   if (r != sizeof(sz)) return 0;
   cnt += r;
@@ -129,7 +171,7 @@ static ssize_t _read_pktbuf ( timeshift_file_t *tsf, int fd, pktbuf_t **pktbuf )
 
   /* Data */
   *pktbuf = pktbuf_alloc(NULL, sz);
-  r = _read_buf(tsf, fd, pktbuf_ptr(*pktbuf), sz);
+  r = _read_buf(seek, fd, pktbuf_ptr(*pktbuf), sz);
   if (r != sz) {
     pktbuf_destroy(*pktbuf);
     *pktbuf = NULL;
@@ -141,7 +183,7 @@ static ssize_t _read_pktbuf ( timeshift_file_t *tsf, int fd, pktbuf_t **pktbuf )
 }
 
 
-static ssize_t _read_msg ( timeshift_file_t *tsf, int fd, streaming_message_t **sm )
+static ssize_t _read_msg ( timeshift_seek_t *seek, int fd, streaming_message_t **sm )
 {
   ssize_t r, cnt = 0;
   size_t sz;
@@ -154,7 +196,7 @@ static ssize_t _read_msg ( timeshift_file_t *tsf, int fd, streaming_message_t **
   *sm = NULL;
 
   /* Size */
-  r = _read_buf(tsf, fd, &sz, sizeof(sz));
+  r = _read_buf(seek, fd, &sz, sizeof(sz));
   if (r < 0) return -1;
   if (r != sizeof(sz)) return 0;
   cnt += r;
@@ -169,13 +211,13 @@ static ssize_t _read_msg ( timeshift_file_t *tsf, int fd, streaming_message_t **
   }
 
   /* Type */
-  r = _read_buf(tsf, fd, &type, sizeof(type));
+  r = _read_buf(seek, fd, &type, sizeof(type));
   if (r < 0) return -1;
   if (r != sizeof(type)) return 0;
   cnt += r;
 
   /* Time */
-  r = _read_buf(tsf, fd, &time, sizeof(time));
+  r = _read_buf(seek, fd, &time, sizeof(time));
   if (r < 0) return -1;
   if (r != sizeof(time)) return 0;
   cnt += r;
@@ -201,7 +243,7 @@ static ssize_t _read_msg ( timeshift_file_t *tsf, int fd, streaming_message_t **
     case SMT_EXIT:
     case SMT_SPEED:
       if (sz != sizeof(code)) return -1;
-      r = _read_buf(tsf, fd, &code, sz);
+      r = _read_buf(seek, fd, &code, sz);
       if (r != sz) {
         if (r < 0) return -1;
         return 0;
@@ -215,7 +257,7 @@ static ssize_t _read_msg ( timeshift_file_t *tsf, int fd, streaming_message_t **
     case SMT_MPEGTS:
     case SMT_PACKET:
       data = malloc(sz);
-      r = _read_buf(tsf, fd, data, sz);
+      r = _read_buf(seek, fd, data, sz);
       if (r != sz) {
         free(data);
         if (r < 0) return -1;
@@ -226,13 +268,13 @@ static ssize_t _read_msg ( timeshift_file_t *tsf, int fd, streaming_message_t **
         pkt->pkt_payload  = pkt->pkt_meta = NULL;
         pkt->pkt_refcount = 0;
         *sm = streaming_msg_create_pkt(pkt);
-        r   = _read_pktbuf(tsf, fd, &pkt->pkt_meta);
+        r   = _read_pktbuf(seek, fd, &pkt->pkt_meta);
         if (r < 0) {
           streaming_msg_free(*sm);
           return r;
         }
         cnt += r;
-        r   = _read_pktbuf(tsf, fd, &pkt->pkt_payload);
+        r   = _read_pktbuf(seek, fd, &pkt->pkt_payload);
         if (r < 0) {
           streaming_msg_free(*sm);
           return r;
@@ -261,102 +303,89 @@ static int64_t _timeshift_first_time
 { 
   int64_t ret = 0;
   int end;
-  timeshift_index_iframe_t *tsi = NULL;
-  timeshift_file_t *tsf = timeshift_filemgr_oldest(ts);
-  while (tsf && !tsi) {
-    if (!(tsi = TAILQ_FIRST(&tsf->iframes)))
-      tsf = timeshift_filemgr_next(tsf, &end, 0);
-  }
-  if (tsi) {
+  timeshift_file_t *tsf;
+
+  tvh_mutex_lock(&ts->store->lock);
+  tsf = timeshift_filemgr_oldest(ts->store);
+  while (tsf && !tsf->iframes_count)
+    tsf = timeshift_filemgr_next(tsf, &end, 0);
+  if (tsf) {
     *active = 1;
-    ret = tsi->time;
+    ret = tsf->iframes[0].time;
   }
   timeshift_file_put(tsf);
+  tvh_mutex_unlock(&ts->store->lock);
   return ret;
 }
 
+/*
+ * Index of the first I-frame in the file with the time above 'time'
+ */
+static int _timeshift_frame_upper
+  ( timeshift_file_t *tsf, int64_t time )
+{
+  int lo = 0, hi = tsf->iframes_count, mid;
+
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (tsf->iframes[mid].time <= time)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* store lock must be held */
 static int _timeshift_skip
   ( timeshift_t *ts, int64_t req_time, int64_t cur_time,
     timeshift_seek_t *seek, timeshift_seek_t *nseek )
 {
-  timeshift_index_iframe_t *tsi  = seek->frame;
-  timeshift_file_t         *tsf  = seek->file, *tsf_last;
-  int64_t                   sec  = mono2sec(req_time) / TIMESHIFT_FILE_PERIOD;
+  timeshift_file_t         *tsf;
   int                       back = (req_time < cur_time) ? 1 : 0;
   int                       end  = 0;
+  int                       i    = -1;
 
-  /* Coarse search */
-  if (!tsi) {
-    while (tsf && !end) {
-      if (back) {
-        if ((tsf->time <= sec) &&
-            (tsi = TAILQ_LAST(&tsf->iframes, timeshift_index_iframe_list)))
-          break;
-        tsf = timeshift_filemgr_prev(tsf, &end, 1);
-      } else {
-        if ((tsf->time >= sec) &&
-            (tsi = TAILQ_FIRST(&tsf->iframes)))
-          break;
-        tsf = timeshift_filemgr_next(tsf, &end, 0);
-      }
-      tsi = NULL;
-    }
-  }
+  /* Coarse search (segment) */
+  tsf = timeshift_filemgr_find(ts->store, req_time);
 
-  /* Fine search */
+  /* Fine search (I-frame), continue in the neighbours if required */
   if (back) {
-    while (!end && tsf && tsi && (tsi->time > req_time)) {
-      tsi = TAILQ_PREV(tsi, timeshift_index_iframe_list, link);
-      while (!end && tsf && !tsi) {
-        if ((tsf = timeshift_filemgr_prev(tsf, &end, 1)))
-          tsi = TAILQ_LAST(&tsf->iframes, timeshift_index_iframe_list);
-      }
+    while (tsf) {
+      if ((i = _timeshift_frame_upper(tsf, req_time) - 1) >= 0)
+        break;
+      tsf = timeshift_filemgr_prev(tsf, &end, 0);
     }
   } else {
-    while (!end && tsf && tsi && (tsi->time < req_time)) {
-      tsi = TAILQ_NEXT(tsi, link);
-      while (!end && tsf && !tsi) {
-        if ((tsf = timeshift_filemgr_next(tsf, &end, 0)))
-          tsi = TAILQ_FIRST(&tsf->iframes);
-      }
+    while (tsf) {
+      if ((i = _timeshift_frame_upper(tsf, req_time - 1)) < tsf->iframes_count)
+        break;
+      tsf = timeshift_filemgr_next(tsf, &end, 0);
     }
   }
 
-  /* End */
-  if (!tsf || !tsi)
-    end = 1;
-
   /* Find start/end of buffer */
-  if (end) {
-    timeshift_file_put(tsf);
+  if (!tsf) {
+    end = 0;
     if (back) {
-      tsf = tsf_last = timeshift_filemgr_oldest(ts);
-      tsi = NULL;
-      while (tsf && !tsi) {
-        tsf_last = tsf;
-        if (!(tsi = TAILQ_FIRST(&tsf->iframes)))
-          tsf = timeshift_filemgr_next(tsf, &end, 0);
-      }
-      if (!tsf)
-        tsf = tsf_last;
+      tsf = timeshift_filemgr_oldest(ts->store);
+      while (tsf && !tsf->iframes_count && !end)
+        tsf = timeshift_filemgr_next(tsf, &end, 1);
+      i = (tsf && tsf->iframes_count) ? 0 : -1;
       end = -1;
     } else {
-      tsf = tsf_last = timeshift_filemgr_newest(ts);
-      tsi = NULL;
-      while (tsf && !tsi) {
-        tsf_last = tsf;
-        if (!(tsi = TAILQ_LAST(&tsf->iframes, timeshift_index_iframe_list)))
-          tsf = timeshift_filemgr_prev(tsf, &end, 0);
-      }
-      if (!tsf)
-        tsf = tsf_last;
+      tsf = timeshift_filemgr_newest(ts->store);
+      while (tsf && !tsf->iframes_count && !end)
+        tsf = timeshift_filemgr_prev(tsf, &end, 1);
+      i = (tsf && tsf->iframes_count) ? tsf->iframes_count - 1 : -1;
       end = 1;
     }
   }
 
   /* Done */
+  *nseek = *seek;
   nseek->file  = tsf;
-  nseek->frame = tsi;
+  nseek->frame = i;
   return end;
 }
 
@@ -365,21 +394,23 @@ static int _timeshift_skip
  */
 static int _timeshift_do_skip
   ( timeshift_t *ts, int64_t req_time, int64_t last_time,
-    timeshift_seek_t *seek )
+    timeshift_seek_t *seek, int64_t *frame_time )
 {
   timeshift_seek_t nseek;
+  int64_t mono_start;
   int end;
 
   tvhdebug(LS_TIMESHIFT, "ts %d skip to %"PRId64" from %"PRId64,
            ts->id, req_time, last_time);
 
-  timeshift_file_get(seek->file);
-
   /* Find */
+  tvh_mutex_lock(&ts->store->lock);
+  mono_start = getmonoclock();
   end = _timeshift_skip(ts, req_time, last_time, seek, &nseek);
-  if (nseek.frame)
-    tvhdebug(LS_TIMESHIFT, "ts %d skip found pkt @ %"PRId64,
-             ts->id, nseek.frame->time);
+  ts->seek_time = getmonoclock() - mono_start;
+  if (nseek.frame >= 0)
+    tvhdebug(LS_TIMESHIFT, "ts %d skip found pkt @ %"PRId64" (in %"PRId64"us)",
+             ts->id, nseek.file->iframes[nseek.frame].time, ts->seek_time);
 
   /* File changed (close) */
   if (nseek.file != seek->file)
@@ -388,15 +419,19 @@ static int _timeshift_do_skip
   timeshift_file_put(seek->file);
 
   /* Position */
+  nseek.rfd = seek->rfd;
   *seek = nseek;
   if (nseek.file != NULL) {
-    if (nseek.frame)
-      nseek.file->roff = nseek.frame->pos;
+    if (nseek.frame >= 0)
+      seek->roff = nseek.file->iframes[nseek.frame].pos;
     else
-      nseek.file->roff = req_time > last_time ? nseek.file->size : 0;
+      seek->roff = req_time > last_time ? nseek.file->size : 0;
     tvhtrace(LS_TIMESHIFT, "do skip seek->file %p roff %"PRId64,
-             nseek.file, (int64_t)nseek.file->roff);
+             nseek.file, (int64_t)seek->roff);
   }
+  if (frame_time && nseek.frame >= 0)
+    *frame_time = nseek.file->iframes[nseek.frame].time;
+  tvh_mutex_unlock(&ts->store->lock);
 
   return end;
 }
@@ -418,38 +453,46 @@ static int _timeshift_read
   if (tsf) {
 
     /* Open file */
-    if (tsf->rfd < 0 && !tsf->ram) {
-      tsf->rfd = tvh_open(tsf->path, O_RDONLY, 0);
-      tvhtrace(LS_TIMESHIFT, "ts %d open file %s (fd %i)", ts->id, tsf->path, tsf->rfd);
-      if (tsf->rfd < 0)
+    if (seek->rfd < 0 && !tsf->ram) {
+      seek->rfd = tvh_open(tsf->path, O_RDONLY, 0);
+      tvhtrace(LS_TIMESHIFT, "ts %d open file %s (fd %i)", ts->id, tsf->path, seek->rfd);
+      if (seek->rfd < 0)
         return -1;
     }
-    if (tsf->rfd >= 0)
-      if ((off = lseek(tsf->rfd, tsf->roff, SEEK_SET)) != tsf->roff)
-        tvherror(LS_TIMESHIFT, "ts %d seek to %s failed (off %"PRId64" != %"PRId64"): %s",
-                 ts->id, tsf->path, (int64_t)tsf->roff, (int64_t)off, strerror(errno));
+    off = seek->roff;
 
     /* Read msg */
-    r = _read_msg(tsf, -1, sm);
+    r = _read_msg(seek, -1, sm);
     if (r < 0) {
       streaming_message_t *e = streaming_msg_create_code(SMT_STOP, SM_CODE_UNDEFINED_ERROR);
       streaming_target_deliver2(ts->output, e);
-      tvhtrace(LS_TIMESHIFT, "ts %d seek to %jd (woff %jd) (fd %i)", ts->id, (intmax_t)off, (intmax_t)tsf->woff, tsf->rfd);
+      tvhtrace(LS_TIMESHIFT, "ts %d seek to %jd (woff %jd) (fd %i)", ts->id, (intmax_t)off, (intmax_t)tsf->woff, seek->rfd);
       tvherror(LS_TIMESHIFT, "ts %d could not read buffer", ts->id);
       return -1;
     }
     tvhtrace(LS_TIMESHIFT, "ts %d seek to %jd (fd %i) read msg %p/%"PRId64" (%"PRId64")",
-             ts->id, (intmax_t)off, tsf->rfd, *sm, *sm ? (*sm)->sm_time : -1, (int64_t)r);
+             ts->id, (intmax_t)off, seek->rfd, *sm, *sm ? (*sm)->sm_time : -1, (int64_t)r);
 
     /* Special case - EOF */
-    if (r <= sizeof(size_t) || tsf->roff > tsf->size || *sm == NULL) {
+    tvh_mutex_lock(&ts->store->lock);
+    if (r <= sizeof(size_t) || seek->roff > tsf->size || *sm == NULL) {
       timeshift_file_get(seek->file); /* _read_close decreases file reference */
       _read_close(seek);
-      _seek_set_file(seek, timeshift_filemgr_next(tsf, NULL, 0), 0);
+      if (tsf->detached) {
+        /* the shared store dropped the data after this file, continue
+           with the oldest data (the reader was too slow) */
+        timeshift_file_put(tsf);
+        _seek_set_file(seek, timeshift_filemgr_oldest(ts->store), 0);
+        ts->full = 1;
+        tvhdebug(LS_TIMESHIFT, "ts %d lost buffered data, continue with the oldest", ts->id);
+      } else {
+        _seek_set_file(seek, timeshift_filemgr_next(tsf, NULL, 0), 0);
+      }
       *wait     = 0;
       tvhtrace(LS_TIMESHIFT, "ts %d eof, seek->file %p (prev %p)", ts->id, seek->file, tsf);
-      timeshift_filemgr_dump(ts);
+      timeshift_filemgr_dump(ts->store);
     }
+    tvh_mutex_unlock(&ts->store->lock);
   }
   return 0;
 }
@@ -491,7 +534,8 @@ static void timeshift_fill_status
     if (current_time > end)
       current_time = end;
   }
-  status->full = ts->full;
+  status->full = ts->store->shared ? ts->full : ts->store->full;
+  status->seek_time = ts->seek_time;
   tvhtrace(LS_TIMESHIFT, "ts %d status start %"PRId64" end %"PRId64
                         " current %"PRId64" state %d",
            ts->id, start, end, current_time, ts->state);
@@ -583,7 +627,7 @@ void *timeshift_reader ( void *p )
           if (speed < -3200) speed = -3200;
 
           /* Ignore negative */
-          if (!ts->dobuf && (speed < 0))
+          if (!ts->store->dobuf && (speed < 0))
             speed = seek->file ? speed : 0;
 
           /* Process */
@@ -601,24 +645,26 @@ void *timeshift_reader ( void *p )
               /* Set position */
               } else {
                 tvhdebug(LS_TIMESHIFT, "ts %d enter timeshift mode", ts->id);
-                ts->dobuf = 1;
+                tvh_mutex_lock(&ts->store->lock);
+                ts->store->dobuf = 1;
                 _seek_reset(seek);
-                tmp_file = timeshift_filemgr_newest(ts);
+                tmp_file = timeshift_filemgr_newest(ts->store);
                 if (tmp_file != NULL) {
                   i64 = tmp_file->last;
                   timeshift_file_put(tmp_file);
                 } else {
                   i64 = ts->buf_time;
                 }
-                seek->file = timeshift_filemgr_get(ts, i64);
+                seek->file = timeshift_filemgr_get(ts->store, i64);
                 if (seek->file != NULL) {
-                  seek->file->roff = seek->file->size;
+                  seek->roff = seek->file->size;
                   pause_time       = seek->file->last;
                   last_time        = pause_time;
                 } else {
                   pause_time       = i64;
                   last_time        = pause_time;
                 }
+                tvh_mutex_unlock(&ts->store->lock);
               }
             }
 
@@ -628,7 +674,7 @@ void *timeshift_reader ( void *p )
               tvhdebug(LS_TIMESHIFT, "using keyframe mode? %s", keyframe ? "yes" : "no");
               keyframe_mode = keyframe;
               if (keyframe)
-                seek->frame = NULL;
+                seek->frame = -1;
             }
 
             /* Update */
@@ -662,11 +708,16 @@ void *timeshift_reader ( void *p )
               if (ts->state != TS_LIVE) {
 
                 /* Reset */
-                if (ts->full) {
-                  timeshift_filemgr_flush(ts, NULL);
-                  _seek_reset(seek);
+                tvh_mutex_lock(&ts->store->lock);
+                if (ts->store->shared) {
+                  /* the shared buffer is trimmed by the writer */
                   ts->full = 0;
+                } else if (ts->store->full) {
+                  timeshift_filemgr_flush(ts->store, NULL);
+                  _seek_reset(seek);
+                  ts->store->full = 0;
                 }
+                tvh_mutex_unlock(&ts->store->lock);
 
                 /* Release */
                 if (sm)
@@ -688,18 +739,20 @@ void *timeshift_reader ( void *p )
 
               /* Live playback (stage1) */
               if (ts->state == TS_LIVE) {
+                tvh_mutex_lock(&ts->store->lock);
                 _seek_reset(seek);
-                tmp_file = timeshift_filemgr_newest(ts);
+                tmp_file = timeshift_filemgr_newest(ts->store);
                 if (tmp_file) {
                   i64 = tmp_file->last;
                   timeshift_file_put(tmp_file);
                 }
-                if (tmp_file && (seek->file = timeshift_filemgr_get(ts, i64)) != NULL) {
-                  seek->file->roff = seek->file->size;
+                if (tmp_file && (seek->file = timeshift_filemgr_get(ts->store, i64)) != NULL) {
+                  seek->roff = seek->file->size;
                   last_time        = seek->file->last;
                 } else {
                   last_time        = ts->buf_time;
                 }
+                tvh_mutex_unlock(&ts->store->lock);
               }
 
               /* May have failed */
@@ -714,7 +767,9 @@ void *timeshift_reader ( void *p )
                   skip = NULL;
                 } else {
                   ts->state = TS_PLAY;
-                  ts->dobuf = 1;
+                  tvh_mutex_lock(&ts->store->lock);
+                  ts->store->dobuf = 1;
+                  tvh_mutex_unlock(&ts->store->lock);
                   tvhtrace(LS_TIMESHIFT, "reader - set TS_PLAY");
                 }
               }
@@ -722,10 +777,9 @@ void *timeshift_reader ( void *p )
               /* OK */
               if (skip) {
                 /* seek */
-                seek->frame = NULL;
-                end = _timeshift_do_skip(ts, skip_time, last_time, seek);
-                if (seek->frame) {
-                  pause_time = seek->frame->time;
+                seek->frame = -1;
+                end = _timeshift_do_skip(ts, skip_time, last_time, seek, &pause_time);
+                if (seek->frame >= 0) {
                   tvhtrace(LS_TIMESHIFT, "ts %d skip - play buffer from %"PRId64" last_time %"PRId64,
                            ts->id, pause_time, last_time);
 
@@ -796,7 +850,7 @@ void *timeshift_reader ( void *p )
         else
           req_time = skip_time;
 
-        end = _timeshift_do_skip(ts, req_time, last_time, seek);
+        end = _timeshift_do_skip(ts, req_time, last_time, seek, NULL);
       }
 
       /* Clear old message */
@@ -869,7 +923,10 @@ void *timeshift_reader ( void *p )
     if (!seek->file || end != 0) {
 
       /* Back to live (unless buffer is full) */
-      if ((end == 1 && !ts->full) || !seek->file) {
+      tvh_mutex_lock(&ts->store->lock);
+      i64 = ts->store->full;
+      tvh_mutex_unlock(&ts->store->lock);
+      if ((end == 1 && !i64) || !seek->file) {
         tvhdebug(LS_TIMESHIFT, "ts %d eob revert to live mode", ts->id);
         cur_speed = 100;
         ctrl      = streaming_msg_create_code(SMT_SPEED, cur_speed);
@@ -886,7 +943,9 @@ void *timeshift_reader ( void *p )
         ts->state = TS_LIVE;
 
         /* Close file (if open) */
+        tvh_mutex_lock(&ts->store->lock);
         _read_close(seek);
+        tvh_mutex_unlock(&ts->store->lock);
 
       /* Pause */
       } else {
@@ -899,7 +958,9 @@ void *timeshift_reader ( void *p )
           tvhtrace(LS_TIMESHIFT, "reader - set TS_PLAY");
           if (ts->state != TS_PLAY) {
             ts->state = TS_PLAY;
-            ts->dobuf = 1;
+            tvh_mutex_lock(&ts->store->lock);
+            ts->store->dobuf = 1;
+            tvh_mutex_unlock(&ts->store->lock);
             if (mono_play_time != mono_now)
               tvhtrace(LS_TIMESHIFT, "update play time (pause) - %"PRId64, mono_now);
             mono_play_time = mono_now;
@@ -919,7 +980,9 @@ void *timeshift_reader ( void *p )
 
   /* Cleanup */
   tvhpoll_destroy(pd);
+  tvh_mutex_lock(&ts->store->lock);
   _read_close(seek);
+  tvh_mutex_unlock(&ts->store->lock);
   if (sm)       streaming_msg_free(sm);
   if (ctrl)     streaming_msg_free(ctrl);
   tvhtrace(LS_TIMESHIFT, "ts %d exit reader thread", ts->id);
@@ -24,6 +24,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
@@ -34,32 +35,48 @@
  * *************************************************************************/
 
 /*
- * Write data (retry on EAGAIN)
+ * Flush the write-behind buffer together with the optional record
+ * (one writev call). Only the writer modifies wbuf, so the readers
+ * may keep copying from it while the data are written to the file.
  */
-static ssize_t _write_fd
-  ( int fd, const void *buf, size_t count )
+static ssize_t _write_flush
+  ( timeshift_file_t *tsf, struct iovec *rec, int reccnt, size_t reclen )
 {
-  ssize_t r;
-  size_t  n = 0;
-  while ( n < count ) {
-    r = write(fd, buf+n, count-n);
-    if (r == -1) {
-      if (ERRNO_AGAIN(errno))
-        continue;
-      else
-        return -1;
-    }
-    n += r;
+  struct iovec iov[TIMESHIFT_WBUF_IOV + 1];
+  int i, iovcnt = 0;
+  size_t len = tsf->wbuf_len + reclen;
+
+  if (len == 0)
+    return 0;
+  if (tsf->wbuf_len) {
+    iov[0].iov_base = tsf->wbuf;
+    iov[0].iov_len  = tsf->wbuf_len;
+    iovcnt++;
   }
-  return count == n ? n : -1;
+  for (i = 0; i < reccnt; i++)
+    iov[iovcnt++] = rec[i];
+  if (tvh_writev(tsf->wfd, iov, iovcnt))
+    return -1;
+  tvh_mutex_lock(&tsf->ram_lock);
+  tsf->woff += len;
+  tsf->wbuf_len = 0;
+  tvh_mutex_unlock(&tsf->ram_lock);
+  return len;
 }
 
-static ssize_t _write
-  ( timeshift_file_t *tsf, const void *buf, size_t count )
+/*
+ * Write one record (all parts are stored or none)
+ */
+static ssize_t _writev
+  ( timeshift_file_t *tsf, struct iovec *iov, int iovcnt )
 {
   uint8_t *ram;
-  size_t alloc;
-  ssize_t ret;
+  size_t alloc, count = 0;
+  int i;
+
+  for (i = 0; i < iovcnt; i++)
+    count += iov[i].iov_len;
+
   if (tsf->ram) {
     tvh_mutex_lock(&tsf->ram_lock);
     if (tsf->ram_size < tsf->woff + count) {
@@ -77,15 +94,66 @@ static ssize_t _write
       tsf->ram = ram;
       tsf->ram_size += alloc;
     }
-    memcpy(tsf->ram + tsf->woff, buf, count);
-    tsf->woff += count;
+    for (i = 0; i < iovcnt; i++) {
+      memcpy(tsf->ram + tsf->woff, iov[i].iov_base, iov[i].iov_len);
+      tsf->woff += iov[i].iov_len;
+    }
     tvh_mutex_unlock(&tsf->ram_lock);
     return count;
   }
-  ret = _write_fd(tsf->wfd, buf, count);
-  if (ret > 0)
-    tsf->woff += ret;
-  return ret;
+
+  /* Large record or full buffer - pass everything to the kernel */
+  if (tsf->wbuf_len + count > TIMESHIFT_WBUF_SIZE)
+    return _write_flush(tsf, iov, iovcnt, count) < 0 ? -1 : count;
+
+  if (tsf->wbuf == NULL) {
+    tsf->wbuf = malloc(TIMESHIFT_WBUF_SIZE);
+    memoryinfo_alloc(&timeshift_memoryinfo, TIMESHIFT_WBUF_SIZE);
+  }
+  tvh_mutex_lock(&tsf->ram_lock);
+  if (tsf->wbuf_len == 0)
+    tsf->wbuf_time = mclk();
+  for (i = 0; i < iovcnt; i++) {
+    memcpy(tsf->wbuf + tsf->wbuf_len, iov[i].iov_base, iov[i].iov_len);
+    tsf->wbuf_len += iov[i].iov_len;
+  }
+  tvh_mutex_unlock(&tsf->ram_lock);
+
+  /* the age is checked only here - the readers take the data from
+     wbuf, so a stalled input does not need a timer to flush it */
+  if (mclk() - tsf->wbuf_time >= TIMESHIFT_WBUF_TIME)
+    if (_write_flush(tsf, NULL, 0, 0) < 0)
+      return -1;
+  return count;
+}
+
+/*
+ * Build the message header
+ */
+typedef struct timeshift_msg_hdr {
+  size_t                   len;
+  streaming_message_type_t type;
+  int64_t                  time;
+} timeshift_msg_hdr_t;
+
+static int _msg_iov
+  ( struct iovec *iov, timeshift_msg_hdr_t *hdr,
+    streaming_message_type_t type, int64_t time, const void *buf, size_t len )
+{
+  hdr->len  = len + sizeof(hdr->type) + sizeof(hdr->time);
+  hdr->type = type;
+  hdr->time = time;
+  iov[0].iov_base = &hdr->len;
+  iov[0].iov_len  = sizeof(hdr->len);
+  iov[1].iov_base = &hdr->type;
+  iov[1].iov_len  = sizeof(hdr->type);
+  iov[2].iov_base = &hdr->time;
+  iov[2].iov_len  = sizeof(hdr->time);
+  if (len == 0)
+    return 3;
+  iov[3].iov_base = (void *)buf;
+  iov[3].iov_len  = len;
+  return 4;
 }
 
 /*
@@ -95,63 +163,36 @@ static ssize_t _write_msg
   ( timeshift_file_t *tsf, streaming_message_type_t type, int64_t time,
     const void *buf, size_t len )
 {
-  size_t len2 = len + sizeof(type) + sizeof(time);
-  ssize_t err, ret;
-  ret = err = _write(tsf, &len2, sizeof(len2));
-  if (err < 0) return err;
-  err = _write(tsf, &type, sizeof(type));
-  if (err < 0) return err;
-  ret += err;
-  err = _write(tsf, &time, sizeof(time));
-  if (err < 0) return err;
-  ret += err;
-  if (len) {
-    err = _write(tsf, buf, len);
-    if (err < 0) return err;
-    ret += err;
-  }
-  return ret;
+  struct iovec iov[4];
+  timeshift_msg_hdr_t hdr;
+  return _writev(tsf, iov, _msg_iov(iov, &hdr, type, time, buf, len));
 }
 
 static ssize_t _write_msg_fd
   ( int fd, streaming_message_type_t type, int64_t time,
     const void *buf, size_t len )
 {
-  size_t len2 = len + sizeof(type) + sizeof(time);
-  ssize_t err, ret;
-  ret = err = _write_fd(fd, &len2, sizeof(len2));
-  if (err < 0) return err;
-  err = _write_fd(fd, &type, sizeof(type));
-  if (err < 0) return err;
-  ret += err;
-  err = _write_fd(fd, &time, sizeof(time));
-  if (err < 0) return err;
-  ret += err;
-  if (len) {
-    err = _write_fd(fd, buf, len);
-    if (err < 0) return err;
-    ret += err;
-  }
-  return ret;
+  struct iovec iov[4];
+  timeshift_msg_hdr_t hdr;
+  int iovcnt = _msg_iov(iov, &hdr, type, time, buf, len);
+  return tvh_writev(fd, iov, iovcnt) ? -1 : hdr.len + sizeof(hdr.len);
 }
 
 /*
- * Write packet buffer
+ * Add packet buffer
  */
-static int _write_pktbuf ( timeshift_file_t *tsf, pktbuf_t *pktbuf )
+static int _pktbuf_iov ( struct iovec *iov, pktbuf_t *pktbuf, size_t *sz )
 {
-  ssize_t ret, err;
-  if (pktbuf) {
-    ret = err = _write(tsf, &pktbuf->pb_size, sizeof(pktbuf->pb_size));
-    if (err < 0) return err;
-    err = _write(tsf, pktbuf_ptr(pktbuf), pktbuf_len(pktbuf));
-    if (err < 0) return err;
-    ret += err;
-  } else {
-    size_t sz = 0;
-    ret = _write(tsf, &sz, sizeof(sz));
+  iov[0].iov_base = sz;
+  iov[0].iov_len  = sizeof(*sz);
+  if (pktbuf == NULL) {
+    *sz = 0;
+    return 1;
   }
-  return ret;
+  *sz = pktbuf->pb_size;
+  iov[1].iov_base = pktbuf_ptr(pktbuf);
+  iov[1].iov_len  = pktbuf_len(pktbuf);
+  return 2;
 }
 
 /*
@@ -165,20 +206,19 @@ ssize_t timeshift_write_sigstat
 }
 
 /*
- * Write packet
+ * Write packet (message, meta and payload as one record)
  */
 ssize_t timeshift_write_packet ( timeshift_file_t *tsf, int64_t time, th_pkt_t *pkt )
 {
-  ssize_t ret = 0, err;
-  ret = err = _write_msg(tsf, SMT_PACKET, time, pkt, sizeof(th_pkt_t));
-  if (err <= 0) return err;
-  err = _write_pktbuf(tsf, pkt->pkt_meta);
-  if (err <= 0) return err;
-  ret += err;
-  err = _write_pktbuf(tsf, pkt->pkt_payload);
-  if (err <= 0) return err;
-  ret += err;
-  return ret;
+  struct iovec iov[TIMESHIFT_WBUF_IOV];
+  timeshift_msg_hdr_t hdr;
+  size_t msz, psz;
+  int iovcnt;
+
+  iovcnt  = _msg_iov(iov, &hdr, SMT_PACKET, time, pkt, sizeof(th_pkt_t));
+  iovcnt += _pktbuf_iov(iov + iovcnt, pkt->pkt_meta, &msz);
+  iovcnt += _pktbuf_iov(iov + iovcnt, pkt->pkt_payload, &psz);
+  return _writev(tsf, iov, iovcnt);
 }
 
 /*
@@ -227,35 +267,43 @@ ssize_t timeshift_write_exit ( int fd )
  */
 ssize_t timeshift_write_eof ( timeshift_file_t *tsf )
 {
+  struct iovec iov;
   size_t sz = 0;
-  return _write(tsf, &sz, sizeof(sz));
+  ssize_t r;
+
+  iov.iov_base = &sz;
+  iov.iov_len  = sizeof(sz);
+  r = _writev(tsf, &iov, 1);
+  if (r > 0 && !tsf->ram && _write_flush(tsf, NULL, 0, 0) < 0)
+    return -1;
+  return r;
 }
 
 /*
  * Update smt_start
  */
-static void _update_smt_start ( timeshift_t *ts, streaming_start_t *ss )
+static void _update_smt_start ( timeshift_store_t *st, streaming_start_t *ss )
 {
   int i;
 
-  if (ts->smt_start)
-    streaming_start_unref(ts->smt_start);
+  if (st->smt_start)
+    streaming_start_unref(st->smt_start);
   streaming_start_ref(ss);
-  ts->smt_start = ss;
+  st->smt_start = ss;
 
-  ts->audio_packet_counter = 255;
+  st->audio_packet_counter = 255;
 
   /* Update video index */
   for (i = 0; i < ss->ss_num_components; i++)
     if (SCT_ISVIDEO(ss->ss_components[i].es_type)) {
-      ts->vididx = ss->ss_components[i].es_index;
+      st->vididx = ss->ss_components[i].es_index;
       break;
     }
 
   /* Update audio index */
   for (i = 0; i < ss->ss_num_components; i++)
     if (SCT_ISAUDIO(ss->ss_components[i].es_type)) {
-      ts->audidx = ss->ss_components[i].es_index;
+      st->audidx = ss->ss_components[i].es_index;
       break;
     }
 }
@@ -263,7 +311,7 @@ static void _update_smt_start ( timeshift_t *ts, streaming_start_t *ss )
 /*
  * Stream start handling
  */
-static void _handle_sstart ( timeshift_t *ts, timeshift_file_t *tsf, streaming_message_t *sm )
+static void _handle_sstart ( timeshift_file_t *tsf, streaming_message_t *sm )
 {
   timeshift_index_data_t *ti = calloc(1, sizeof(timeshift_index_data_t));
 
@@ -276,25 +324,33 @@ static void _handle_sstart ( timeshift_t *ts, timeshift_file_t *tsf, streaming_m
 /*
  * Index i-frames and every 100th audio frame
  */
-static void add_frame_to_index ( timeshift_t *ts, timeshift_file_t *tsf, streaming_message_t *sm )
+static void add_frame_to_index ( timeshift_store_t *st, timeshift_file_t *tsf, streaming_message_t *sm )
 {
   th_pkt_t *pkt = sm->sm_data;
 
   /* Index video iframes or audio frames for audio-only streams*/
-  if ((pkt->pkt_componentindex == ts->vididx && pkt->v.pkt_frametype == PKT_I_FRAME) ||
-      (ts->vididx == -1 && pkt->pkt_componentindex == ts->audidx)) {
-
-    if(ts->vididx != -1 || ts->audio_packet_counter > 100) {    
-      timeshift_index_iframe_t *ti = calloc(1, sizeof(timeshift_index_iframe_t));
-      memoryinfo_alloc(&timeshift_memoryinfo, sizeof(*ti));
+  if ((pkt->pkt_componentindex == st->vididx && pkt->v.pkt_frametype == PKT_I_FRAME) ||
+      (st->vididx == -1 && pkt->pkt_componentindex == st->audidx)) {
+
+    if(st->vididx != -1 || st->audio_packet_counter > 100) {    
+      timeshift_index_iframe_t *ti;
+      if (tsf->iframes_count == tsf->iframes_alloc) {
+        int n = MAX(TIMESHIFT_IFRAMES_MIN, tsf->iframes_alloc * 2);
+        ti = realloc(tsf->iframes, n * sizeof(*ti));
+        if (ti == NULL)
+          return;
+        memoryinfo_append(&timeshift_memoryinfo, (n - tsf->iframes_alloc) * sizeof(*ti));
+        tsf->iframes = ti;
+        tsf->iframes_alloc = n;
+      }
+      ti = &tsf->iframes[tsf->iframes_count++];
       ti->pos  = tsf->size;
       ti->time = sm->sm_time;
-      TAILQ_INSERT_TAIL(&tsf->iframes, ti, link);
-      if(ts->vididx == -1)
-        ts->audio_packet_counter = 0;
+      if(st->vididx == -1)
+        st->audio_packet_counter = 0;
     }
-    if(ts->vididx == -1)
-      ts->audio_packet_counter++;
+    if(st->vididx == -1)
+      st->audio_packet_counter++;
   }
 }
 
@@ -303,19 +359,19 @@ static void add_frame_to_index ( timeshift_t *ts, timeshift_file_t *tsf, streami
  * *************************************************************************/
 
 static inline ssize_t _process_msg0
-  ( timeshift_t *ts, timeshift_file_t *tsf, streaming_message_t *sm )
+  ( timeshift_store_t *st, timeshift_file_t *tsf, streaming_message_t *sm )
 {
   ssize_t err;
 
   if (sm->sm_type == SMT_START) {
     err = 0;
-    _handle_sstart(ts, tsf, streaming_msg_clone(sm));
+    _handle_sstart(tsf, streaming_msg_clone(sm));
   } else if (sm->sm_type == SMT_SIGNAL_STATUS) {
     err = timeshift_write_sigstat(tsf, sm->sm_time, sm->sm_data);
   } else if (sm->sm_type == SMT_PACKET) {
     err = timeshift_write_packet(tsf, sm->sm_time, sm->sm_data);
     if (err > 0) {
-      add_frame_to_index(ts, tsf, sm);
+      add_frame_to_index(st, tsf, sm);
     }
   } else if (sm->sm_type == SMT_MPEGTS) {
     err = timeshift_write_mpegts(tsf, sm->sm_time, sm->sm_data);
@@ -335,12 +391,47 @@ static inline ssize_t _process_msg0
   return err;
 }
 
+static inline int _is_teletext ( streaming_message_t *sm )
+{
+  th_pkt_t *pkt;
+
+  if (timeshift_conf.teletext && sm->sm_type == SMT_PACKET) {
+    pkt = sm->sm_data;
+    return pkt->pkt_type == SCT_TELETEXT;
+  }
+  return 0;
+}
+
+/*
+ * Store the message (START, SIGNAL_STATUS, PACKET or MPEGTS)
+ */
+void timeshift_store_msg ( timeshift_store_t *st, streaming_message_t *sm )
+{
+  timeshift_file_t *tsf;
+
+  if (sm->sm_type == SMT_START)
+    _update_smt_start(st, (streaming_start_t *)sm->sm_data);
+  /* do buffering, but without teletext packets */
+  if (st->dobuf && !_is_teletext(sm)) {
+    if ((tsf = timeshift_filemgr_get(st, sm->sm_time)) != NULL) {
+      if (tsf->wfd >= 0 || tsf->ram) {
+        if (_process_msg0(st, tsf, sm) < 0) {
+          timeshift_filemgr_close(tsf);
+          tsf->bad = 1;
+          st->full = 1; ///< Stop any more writing
+        } else if (sm->sm_type == SMT_PACKET && tvhtrace_enabled()) {
+          timeshift_packet_log0("sav", st->id, sm);
+        }
+      }
+      timeshift_file_put(tsf);
+    }
+  }
+}
+
 static void _process_msg
   ( timeshift_t *ts, streaming_message_t *sm, int *run )
 {
-  int err, teletext = 0;
-  timeshift_file_t *tsf;
-  th_pkt_t *pkt;
+  timeshift_store_t *st = ts->store;
 
   /* Process */
   switch (sm->sm_type) {
@@ -359,6 +450,10 @@ static void _process_msg
     case SMT_SPEED:
       break;
 
+    /* Split by streaming_target_deliver() */
+    case SMT_PACKET_BATCH:
+      break;
+
     /* Status */
     case SMT_GRACE:
     case SMT_NOSTART:
@@ -370,38 +465,22 @@ static void _process_msg
 
     /* Store */
     case SMT_PACKET:
-      if (timeshift_conf.teletext && sm->sm_type == SMT_PACKET) {
-        pkt = sm->sm_data;
-        teletext = pkt->pkt_type == SCT_TELETEXT;
-      }
-      /* fall thru */
     case SMT_SIGNAL_STATUS:
     case SMT_START:
     case SMT_MPEGTS:
       tvh_mutex_lock(&ts->state_mutex);
-      if (!teletext) /* do not use time from teletext packets */
+      if (!_is_teletext(sm)) /* do not use time from teletext packets */
         ts->buf_time = sm->sm_time;
       if (ts->state == TS_LIVE) {
         streaming_target_deliver2(ts->output, streaming_msg_clone(sm));
         if (sm->sm_type == SMT_PACKET)
           timeshift_packet_log("liv", ts, sm);
       }
-      if (sm->sm_type == SMT_START)
-        _update_smt_start(ts, (streaming_start_t *)sm->sm_data);
-      /* do buffering, but without teletext packets */
-      if (ts->dobuf && !teletext) {
-        if ((tsf = timeshift_filemgr_get(ts, sm->sm_time)) != NULL) {
-          if (tsf->wfd >= 0 || tsf->ram) {
-            if ((err = _process_msg0(ts, tsf, sm)) < 0) {
-              timeshift_filemgr_close(tsf);
-              tsf->bad = 1;
-              ts->full = 1; ///< Stop any more writing
-            } else {
-              timeshift_packet_log("sav", ts, sm);
-            }
-          }
-          timeshift_file_put(tsf);
-        }
+      /* the shared store is fed by its own writer */
+      if (!st->shared) {
+        tvh_mutex_lock(&st->lock);
+        timeshift_store_msg(st, sm);
+        tvh_mutex_unlock(&st->lock);
       }
       tvh_mutex_unlock(&ts->state_mutex);
       break;
@@ -432,7 +511,7 @@ void *timeshift_writer ( void *aux )
   while (run) {
 
     /* Get message */
-    sm = TAILQ_FIRST(&sq->sq_queue);
+    sm = streaming_queue_first(sq);
     if (sm == NULL) {
       tvh_cond_wait(&sq->sq_cond, &sq->sq_mutex);
       continue;
@@ -448,3 +527,49 @@ void *timeshift_writer ( void *aux )
   tvh_mutex_unlock(&sq->sq_mutex);
   return NULL;
 }
+
+/*
+ * Writer for the shared store (runs until the store is destroyed)
+ */
+void *timeshift_store_writer ( void *aux )
+{
+  int run = 1;
+  timeshift_store_t *st = aux;
+  streaming_queue_t *sq = &st->wr_queue;
+  streaming_message_t *sm;
+
+  tvh_mutex_lock(&sq->sq_mutex);
+
+  while (run) {
+
+    /* Get message */
+    sm = streaming_queue_first(sq);
+    if (sm == NULL) {
+      tvh_cond_wait(&sq->sq_cond, &sq->sq_mutex);
+      continue;
+    }
+    streaming_queue_remove(sq, sm);
+    tvh_mutex_unlock(&sq->sq_mutex);
+
+    switch (sm->sm_type) {
+      case SMT_EXIT:
+        run = 0;
+        break;
+      case SMT_PACKET:
+      case SMT_SIGNAL_STATUS:
+      case SMT_START:
+        tvh_mutex_lock(&st->lock);
+        timeshift_store_msg(st, sm);
+        tvh_mutex_unlock(&st->lock);
+        break;
+      default:
+        break;
+    }
+    streaming_msg_free(sm);
+
+    tvh_mutex_lock(&sq->sq_mutex);
+  }
+
+  tvh_mutex_unlock(&sq->sq_mutex);
+  return NULL;
+}
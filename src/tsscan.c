@@ -0,0 +1,157 @@
+/*
+ *  Tvheadend - MPEG-TS packet run scanner
+ *  Copyright (C) 2026 Tvheadend
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tvheadend.h"
+#include "tvh_endian.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define TSSCAN_X86 1
+#include <immintrin.h>
+#endif
+
+static inline uint32_t
+tsscan_word32 ( const uint8_t *tsb )
+{
+  uint32_t r;
+  memcpy(&r, tsb, sizeof(r));
+  return r;
+}
+
+/*
+ * Count the bytes of the leading run of packets with the same header
+ * bits selected by 'mask' (big-endian TS header word). The runs end
+ * at every PID change, they are short and the scalar loop is the
+ * fastest there.
+ */
+int
+mpegts_word_count ( const uint8_t *tsb, int len, uint32_t mask )
+{
+  uint32_t val;
+  int r = 0;
+
+  if (len < 188)
+    return 0;
+
+#if BYTE_ORDER == LITTLE_ENDIAN
+  mask = bswap_32(mask);
+#endif
+
+  val  = tsscan_word32(tsb) & mask;
+
+  while (len >= 188) {
+    if (len >= 4*188 &&
+        (tsscan_word32(tsb+0*188) & mask) == val &&
+        (tsscan_word32(tsb+1*188) & mask) == val &&
+        (tsscan_word32(tsb+2*188) & mask) == val &&
+        (tsscan_word32(tsb+3*188) & mask) == val) {
+      r   += 4*188;
+      len -= 4*188;
+      tsb += 4*188;
+    } else if ((tsscan_word32(tsb) & mask) == val) {
+      r   += 188;
+      len -= 188;
+      tsb += 188;
+    } else {
+      break;
+    }
+  }
+
+  return r;
+}
+
+/*
+ * Count the bytes of the leading run of packets starting with 0x47.
+ * This runs over the whole input buffer, the AVX2 variant is used
+ * when the CPU supports it.
+ */
+static int
+ts_sync_count_scalar ( const uint8_t *tsb, int len )
+{
+  const uint8_t *start = tsb;
+  while (len >= 188) {
+    if (len >= 1880 &&
+        tsb[0*188] == 0x47 && tsb[1*188] == 0x47 &&
+        tsb[2*188] == 0x47 && tsb[3*188] == 0x47 &&
+        tsb[4*188] == 0x47 && tsb[5*188] == 0x47 &&
+        tsb[6*188] == 0x47 && tsb[7*188] == 0x47 &&
+        tsb[8*188] == 0x47 && tsb[9*188] == 0x47) {
+      len -= 1880;
+      tsb += 1880;
+    } else if (*tsb == 0x47) {
+      len -= 188;
+      tsb += 188;
+    } else {
+      break;
+    }
+  }
+  return tsb - start;
+}
+
+#if TSSCAN_X86
+__attribute__((target("avx2")))
+static int
+ts_sync_count_avx2 ( const uint8_t *tsb, int len )
+{
+  const __m256i vidx  = _mm256_setr_epi32(0*188, 1*188, 2*188, 3*188,
+                                          4*188, 5*188, 6*188, 7*188);
+  const __m256i vmask = _mm256_set1_epi32(0xff);
+  const __m256i vval  = _mm256_set1_epi32(0x47);
+  __m256i w;
+  int r = 0, bits;
+
+  while (len >= 8*188) {
+    w = _mm256_i32gather_epi32((const int *)tsb, vidx, 1);
+    w = _mm256_cmpeq_epi32(_mm256_and_si256(w, vmask), vval);
+    bits = _mm256_movemask_ps(_mm256_castsi256_ps(w));
+    if (bits != 0xff)
+      return r + __builtin_ctz(~bits) * 188;
+    r   += 8*188;
+    len -= 8*188;
+    tsb += 8*188;
+  }
+
+  return r + ts_sync_count_scalar(tsb, len);
+}
+#endif
+
+static int (*ts_sync_count_fn)(const uint8_t *tsb, int len) = ts_sync_count_scalar;
+
+int
+ts_sync_count ( const uint8_t *tsb, int len )
+{
+  return ts_sync_count_fn(tsb, len);
+}
+
+/*
+ * Select the widest implementation supported by this CPU
+ */
+void
+tsscan_init ( void )
+{
+  const char *name = "scalar";
+
+#if TSSCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    ts_sync_count_fn = ts_sync_count_avx2;
+    name = "avx2";
+  }
+#endif
+  tvhdebug(LS_MAIN, "TS sync scanner: %s", name);
+}
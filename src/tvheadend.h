@@ -247,6 +247,9 @@ void tvh_pipe_close(th_pipe_t *pipe);
 
 int tvh_write(int fd, const void *buf, size_t len);
 
+struct iovec;
+int tvh_writev(int fd, struct iovec *iov, int iovcnt);
+
 int tvh_write_in_chunks(int fd, const void *buf, size_t len, size_t chunkSize);
 
 int tvh_nonblock_write(int fd, const void *buf, size_t len);
@@ -298,7 +301,14 @@ char to_hex(char code);
 char *url_encode(const char *str);
 void http_deescape(char *str);
 
+/* MPEG-TS packet run scanners (tsscan.c) */
+void tsscan_init(void);
 int mpegts_word_count(const uint8_t *tsb, int len, uint32_t mask);
+int ts_sync_count(const uint8_t *tsb, int len);
+
+/* Elementary stream start code scanner (parsers/startcode.c) */
+void startcode_init(void);
+const uint8_t *startcode_find(const uint8_t *p, const uint8_t *end);
 
 int deferred_unlink(const char *filename, const char *rootdir);
 void dvr_cutpoint_delete_files (const char *s);
@@ -129,7 +129,7 @@ udp_stream_thread ( void *aux )
 
   while(atomic_get(&us->us_running) && run && tvheadend_is_running()) {
     tvh_mutex_lock(&sq->sq_mutex);
-    sm = TAILQ_FIRST(&sq->sq_queue);
+    sm = streaming_queue_first(sq);
     if(sm == NULL) {
       mono = mclk() + sec2mono(1);
       do {
@@ -148,14 +148,10 @@ udp_stream_thread ( void *aux )
     switch(sm->sm_type) {
     case SMT_MPEGTS:
     case SMT_PACKET:
+    case SMT_PACKET_BATCH:
       if(started) {
-        pktbuf_t *pb;
         int len;
-        if (sm->sm_type == SMT_PACKET)
-          pb = ((th_pkt_t*)sm->sm_data)->pkt_payload;
-        else
-          pb = sm->sm_data;
-        subscription_add_bytes_out(us->us_subscript, len = pktbuf_len(pb));
+        subscription_add_bytes_out(us->us_subscript, len = streaming_message_data_size(sm));
         if (len > 0)
           lastpkt = mclk();
         muxer_write_pkt(mux, sm->sm_type, sm->sm_data);
@@ -833,49 +833,6 @@ http_deescape(char *s)
   *d = 0;
 }
 
-/*
- *
- */
-
-static inline uint32_t mpegts_word32( const uint8_t *tsb )
-{
-  //assert(((intptr_t)tsb & 3) == 0);
-  return *(uint32_t *)tsb;
-}
-
-int
-mpegts_word_count ( const uint8_t *tsb, int len, uint32_t mask )
-{
-  uint32_t val;
-  int r = 0;
-
-#if BYTE_ORDER == LITTLE_ENDIAN
-  mask = bswap_32(mask);
-#endif
-
-  val  = mpegts_word32(tsb) & mask;
-
-  while (len >= 188) {
-    if (len >= 4*188 &&
-        (mpegts_word32(tsb+0*188) & mask) == val &&
-        (mpegts_word32(tsb+1*188) & mask) == val &&
-        (mpegts_word32(tsb+2*188) & mask) == val &&
-        (mpegts_word32(tsb+3*188) & mask) == val) {
-      r   += 4*188;
-      len -= 4*188;
-      tsb += 4*188;
-    } else if ((mpegts_word32(tsb) & mask) == val) {
-      r   += 188;
-      len -= 188;
-      tsb += 188;
-    } else {
-      break;
-    }
-  }
-
-  return r;
-}
-
 static void
 deferred_unlink_cb(void *s, int dearmed)
 {
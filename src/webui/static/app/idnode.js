@@ -1747,6 +1747,8 @@ tvheadend.idnode_grid = function(panel, conf)
         if (conf.extraParams) conf.extraParams(params);
 
         if(!params['limit']) params['limit'] = tvheadend.page_size;
+        /* Read only the fields known to the model */
+        if(!params['list']) params['list'] = fields.join(',');
 
         groupReader = new Ext.data.JsonReader({
             totalProperty: 'total',
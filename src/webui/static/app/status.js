@@ -286,6 +286,8 @@ tvheadend.status_streams = function(panel, index)
         }
         r.data.subs = m.subs;
         r.data.weight = m.weight;
+        r.data.worker = m.worker;
+        r.data.load = m.load;
         r.data.pids = m.pids;
         r.data.signal = m.signal;
         r.data.ber = m.ber;
@@ -348,6 +350,8 @@ tvheadend.status_streams = function(panel, index)
                 { name: 'stream', sortType: stype },
                 { name: 'subs', sortType: stypei },
                 { name: 'weight', sortType: stypei },
+                { name: 'worker', sortType: stypei },
+                { name: 'load', sortType: stypei },
                 { name: 'pids' },
                 { name: 'signal', sortType: stypei },
                 { name: 'ber', sortType: stypei },
@@ -421,6 +425,25 @@ tvheadend.status_streams = function(panel, index)
                 dataIndex: 'weight',
                 sortable: true
             },
+            {
+                width: 50,
+                header: _("Thread"),
+                dataIndex: 'worker',
+                sortable: true,
+                hidden: true,
+                renderer: function(v) {
+                    return v + 1;
+                }
+            },
+            {
+                width: 50,
+                header: _("Thread load (%)"),
+                dataIndex: 'load',
+                sortable: true,
+                renderer: function(v) {
+                    return (v / 10).toFixed(1);
+                }
+            },
             {
                 width: 100,
                 id: 'pids',
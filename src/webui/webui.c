@@ -382,7 +382,7 @@ http_stream_run(http_connection_t *hc, profile_chain_t *prch,
 
   while(!hc->hc_shutdown && run && tvheadend_is_running()) {
     tvh_mutex_lock(&sq->sq_mutex);
-    sm = TAILQ_FIRST(&sq->sq_queue);
+    sm = streaming_queue_first(sq);
     if(sm == NULL) {
       mono = mclk() + sec2mono(1);
       do {
@@ -412,14 +412,10 @@ http_stream_run(http_connection_t *hc, profile_chain_t *prch,
     switch(sm->sm_type) {
     case SMT_MPEGTS:
     case SMT_PACKET:
+    case SMT_PACKET_BATCH:
       if(started) {
-        pktbuf_t *pb;
         int len;
-        if (sm->sm_type == SMT_PACKET)
-          pb = ((th_pkt_t*)sm->sm_data)->pkt_payload;
-        else
-          pb = sm->sm_data;
-        subscription_add_bytes_out(s, len = pktbuf_len(pb));
+        subscription_add_bytes_out(s, len = streaming_message_data_size(sm));
         if (len > 0)
           lastpkt = mclk();
         muxer_write_pkt(mux, sm->sm_type, sm->sm_data);
@@ -1187,6 +1183,7 @@ http_stream_service(http_connection_t *hc, service_t *service, int weight)
 
   profile_chain_init(&prch, pro, service, 1);
   if (!profile_chain_open(&prch, NULL, hints, 0, qsize)) {
+    streaming_queue_accept_batch(&prch.prch_sq);
 
     s = subscription_create_from_service(&prch, NULL, weight, "HTTP",
                                          prch.prch_flags | SUBSCRIPTION_STREAMING |
@@ -1296,6 +1293,7 @@ udp_stream_service(http_connection_t *hc, service_t *service, int weight)
 
   profile_chain_init(&ustream->us_prch, pro, service, 1);
   if (!profile_chain_open(&ustream->us_prch, NULL, hints, 0, qsize)) {
+    streaming_queue_accept_batch(&ustream->us_prch.prch_sq);
 
     s = subscription_create_from_service(&ustream->us_prch, NULL, weight ?: 100, "UDP",
                                          ustream->us_prch.prch_flags | SUBSCRIPTION_STREAMING |
@@ -1440,6 +1438,7 @@ http_stream_channel(http_connection_t *hc, channel_t *ch, int weight)
 
   profile_chain_init(&prch, pro, ch, 1);
   if (!profile_chain_open(&prch, NULL, hints, 0, qsize)) {
+    streaming_queue_accept_batch(&prch.prch_sq);
 
     s = subscription_create_from_channel(&prch,
                  NULL, weight, "HTTP",
@@ -1539,6 +1538,7 @@ udp_stream_channel(http_connection_t *hc, channel_t *ch, int weight)
 
   profile_chain_init(&ustream->us_prch, pro, ch, 1);
   if (!profile_chain_open(&ustream->us_prch, NULL, hints, 0, qsize)) {
+    streaming_queue_accept_batch(&ustream->us_prch.prch_sq);
 
     s = subscription_create_from_channel(&ustream->us_prch, NULL, weight ?: 100, "UDP",
                                          ustream->us_prch.prch_flags | SUBSCRIPTION_STREAMING,